@@ -0,0 +1,146 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file asset_pack.c
+ *
+ * @brief Asset pack partition mapping and lookup.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <string.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+#include "asset_pack.h"
+
+static const char *s_TAG = "ASSETS";
+
+struct driver_state {
+
+/* Mapping of the asset partition, NULL while no valid pack is mapped */
+  const uint8_t *pack;
+  esp_partition_mmap_handle_t handle;
+  const asset_pack_entry *index;
+  uint16_t count;
+};
+static struct driver_state s_d_state = {0};
+
+static esp_err_t s_Validate(const uint8_t *pack, size_t mapped) {
+
+  const asset_pack_header *header = (const asset_pack_header*) pack;
+  if (header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION) {
+    ESP_LOGW(s_TAG, "No asset pack, or unsupported version");
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  size_t index_end = sizeof(*header) + (size_t) header->count * sizeof(asset_pack_entry);
+  if (header->size > mapped || header->size < index_end) {
+    ESP_LOGE(s_TAG, "Bad asset pack size %" PRIu32, header->size);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+#ifdef CONFIG_ASSET_PACK_VERIFY_CRC
+  if (esp_rom_crc32_le(0, pack + sizeof(*header), header->size - sizeof(*header)) != header->crc32) {
+    ESP_LOGE(s_TAG, "Asset pack CRC mismatch");
+    return ESP_ERR_INVALID_CRC;
+  }
+#endif
+
+  const asset_pack_entry *index = (const asset_pack_entry*) (pack + sizeof(*header));
+  for (unsigned i = 0; i < header->count; i++) {
+    const asset_pack_entry *e = &index[i];
+    size_t frame_size = (size_t)((e->width + 7) / 8) * e->height;
+    if (!e->frames || e->size != frame_size * e->frames || e->offset < index_end ||
+        e->offset > header->size || e->size > header->size - e->offset ||
+        memchr(e->name, '\0', sizeof(e->name)) == NULL) {
+      ESP_LOGE(s_TAG, "Bad asset pack entry %u", i);
+      return ESP_ERR_INVALID_SIZE;
+    }
+  }
+  return ESP_OK;
+}
+
+esp_err_t AssetPackInit(void) {
+
+  AssetPackDeinit();
+
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                              ESP_PARTITION_SUBTYPE_ANY,
+                                                              CONFIG_ASSET_PACK_PARTITION_LABEL);
+  if (!partition) {
+    ESP_LOGW(s_TAG, "No %s partition", CONFIG_ASSET_PACK_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  const void *pack;
+  esp_partition_mmap_handle_t handle;
+  esp_err_t rc = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA,
+                                    &pack, &handle);
+  if (rc)
+    return rc;
+
+  if ((rc = s_Validate(pack, partition->size))) {
+    esp_partition_munmap(handle);
+    return rc;
+  }
+
+  s_d_state.pack = pack;
+  s_d_state.handle = handle;
+  s_d_state.index = (const asset_pack_entry*) (s_d_state.pack + sizeof(asset_pack_header));
+  s_d_state.count = ((const asset_pack_header*) pack)->count;
+  ESP_LOGI(s_TAG, "%u assets mapped", s_d_state.count);
+  return ESP_OK;
+}
+
+void AssetPackDeinit(void) {
+
+  if (!s_d_state.pack)
+    return;
+  s_d_state.pack = NULL;
+  s_d_state.index = NULL;
+  s_d_state.count = 0;
+  esp_partition_munmap(s_d_state.handle);
+}
+
+esp_err_t AssetFind(const char *name, asset_t *asset) {
+
+  if (!name || !asset)
+    return ESP_ERR_INVALID_ARG;
+
+  for (unsigned i = 0; i < s_d_state.count; i++) {
+    const asset_pack_entry *e = &s_d_state.index[i];
+    if (strncmp(e->name, name, sizeof(e->name)))
+      continue;
+    asset->name = e->name;
+    asset->width = e->width;
+    asset->height = e->height;
+    asset->frames = e->frames;
+    asset->frame_delay_ms = e->frame_delay_ms;
+    asset->data = s_d_state.pack + e->offset;
+    return ESP_OK;
+  }
+  return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,99 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file asset_pack.h
+ *
+ * @brief Display bitmaps and animations read in place from a flash partition.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * The pack is built by tools/mkassets.py and flashed to its own data
+ * partition, so artwork can change without rebuilding the firmware. The
+ * partition is memory mapped once; assets point straight into flash and are
+ * never copied to RAM.
+ *
+ * Layout, little endian: an asset_pack_header, count asset_pack_entry index
+ * records, then the bitmaps. Bitmaps are 1 bit per pixel, rows MSB first and
+ * padded to a byte, as ssd1306_bitmaps() expects; frames follow each other.
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASSET_PACK_MAGIC    (0x4b505341)  /* "ASPK" */
+#define ASSET_PACK_VERSION  (1)
+#define ASSET_NAME_MAX      (15)
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t size;    /* whole pack, header included */
+  uint32_t crc32;   /* of the bytes following the header */
+} asset_pack_header;
+
+typedef struct __attribute__((packed)) {
+  char name[ASSET_NAME_MAX + 1];
+  uint32_t offset;  /* from the start of the pack */
+  uint32_t size;
+  uint16_t width;
+  uint16_t height;
+  uint16_t frames;
+  uint16_t frame_delay_ms;
+} asset_pack_entry;
+
+typedef struct {
+  const char *name;
+  uint16_t width;
+  uint16_t height;
+  uint16_t frames;
+  uint16_t frame_delay_ms;
+  const uint8_t *data;  /* frames bitmaps, in mapped flash */
+} asset_t;
+
+/**
+ * @brief Map and validate the asset partition. Safe to call again after the
+ * partition was rewritten, e.g. by an asset update, to map the new pack.
+ */
+esp_err_t AssetPackInit(void);
+void AssetPackDeinit(void);
+esp_err_t AssetFind(const char *name, asset_t *asset);
+
+static inline size_t AssetFrameSize(const asset_t *asset) {
+  return (size_t)((asset->width + 7) / 8) * asset->height;
+}
+
+static inline const uint8_t *AssetFrame(const asset_t *asset, unsigned frame) {
+  return asset->data + (frame % asset->frames) * AssetFrameSize(asset);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
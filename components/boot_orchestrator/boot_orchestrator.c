@@ -0,0 +1,157 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file boot_orchestrator.c
+ *
+ * @brief Dependency driven boot stage runner.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "boot_orchestrator.h"
+
+static const char *s_TAG = "BOOT";
+
+#define BOOT_BAR_WIDTH (32)
+
+typedef struct {
+  boot_stage_t *stage;
+  EventGroupHandle_t done;
+  uint32_t bit;
+} stage_ctx;
+
+static void s_StageTask(void *args) {
+
+  stage_ctx *ctx = (stage_ctx*) args;
+  boot_stage_t *stage = ctx->stage;
+
+  stage->rc = stage->fn(stage->args);
+  stage->end_us = esp_timer_get_time();
+  xEventGroupSetBits(ctx->done, ctx->bit);
+  vTaskDelete(NULL);
+}
+
+esp_err_t BootRun(boot_stage_t *stages, unsigned count) {
+
+  if (!stages || !count || count > BOOT_MAX_STAGES)
+    return ESP_ERR_INVALID_ARG;
+
+  const uint32_t all = BOOT_DEP(count) - 1;
+  for (unsigned i = 0; i < count; i++) {
+    if (!stages[i].fn || (stages[i].deps & ~all) || (stages[i].deps & BOOT_DEP(i)))
+      return ESP_ERR_INVALID_ARG;
+    stages[i].start_us = stages[i].end_us = 0;
+    stages[i].rc = ESP_OK;
+  }
+
+  EventGroupHandle_t done = xEventGroupCreate();
+  if (!done)
+    return ESP_ERR_NO_MEM;
+
+  stage_ctx ctx[BOOT_MAX_STAGES];
+  uint32_t started = 0, finished = 0;
+  esp_err_t rc = ESP_OK;
+
+  while (finished != all) {
+    /* Launch every stage whose dependencies are satisfied, unless a stage
+     * already failed; then only drain the running ones. */
+    for (unsigned i = 0; i < count && rc == ESP_OK; i++) {
+      if ((started & BOOT_DEP(i)) || (stages[i].deps & ~finished))
+        continue;
+      ctx[i].stage = &stages[i];
+      ctx[i].done = done;
+      ctx[i].bit = BOOT_DEP(i);
+      stages[i].start_us = esp_timer_get_time();
+      uint32_t stack = stages[i].stack_size ? stages[i].stack_size : CONFIG_BOOT_STAGE_STACK_SIZE;
+      if (xTaskCreate(s_StageTask, stages[i].name, stack, &ctx[i], CONFIG_BOOT_STAGE_PRIORITY,
+                      NULL) != pdPASS) {
+        stages[i].rc = rc = ESP_ERR_NO_MEM;
+        break;
+      }
+      started |= BOOT_DEP(i);
+    }
+
+    uint32_t running = started & ~finished;
+    if (!running) {
+      /* Nothing left to wait for: either an error stopped the launches or
+       * the remaining stages depend on each other. */
+      if (rc == ESP_OK)
+        rc = ESP_ERR_INVALID_STATE;
+      break;
+    }
+
+    uint32_t bits = xEventGroupWaitBits(done, running, pdFALSE, pdFALSE, portMAX_DELAY);
+    for (unsigned i = 0; i < count; i++) {
+      if ((bits & running & BOOT_DEP(i)) && stages[i].rc != ESP_OK && rc == ESP_OK) {
+        ESP_LOGE(s_TAG, "Stage %s failed: %s", stages[i].name, esp_err_to_name(stages[i].rc));
+        rc = stages[i].rc;
+      }
+    }
+    finished |= bits & running;
+  }
+
+  vEventGroupDelete(done);
+#ifdef CONFIG_BOOT_TIMELINE_REPORT
+  BootReport(stages, count);
+#endif
+  return rc;
+}
+
+void BootReport(const boot_stage_t *stages, unsigned count) {
+
+  int64_t first = INT64_MAX, last = 0;
+
+  for (unsigned i = 0; i < count; i++) {
+    if (!stages[i].start_us)
+      continue;
+    if (stages[i].start_us < first)
+      first = stages[i].start_us;
+    if (stages[i].end_us > last)
+      last = stages[i].end_us;
+  }
+  if (last <= first)
+    return;
+
+  ESP_LOGI(s_TAG, "Boot timeline, %" PRIi64 " ms total, %" PRIi64 " ms since power on",
+           (last - first) / 1000, last / 1000);
+  for (unsigned i = 0; i < count; i++) {
+    char bar[BOOT_BAR_WIDTH + 1];
+    const boot_stage_t *s = &stages[i];
+    int from = s->start_us ? (s->start_us - first) * BOOT_BAR_WIDTH / (last - first) : BOOT_BAR_WIDTH;
+    int to = s->end_us ? (s->end_us - first) * BOOT_BAR_WIDTH / (last - first) : from;
+    for (int c = 0; c < BOOT_BAR_WIDTH; c++)
+      bar[c] = (c >= from && c <= to) ? '#' : '.';
+    bar[BOOT_BAR_WIDTH] = '\0';
+    ESP_LOGI(s_TAG, "%-10s |%s| %6" PRIi64 " ms +%6" PRIi64 " ms %s", s->name, bar,
+             s->start_us ? (s->start_us - first) / 1000 : 0,
+             s->end_us ? (s->end_us - s->start_us) / 1000 : 0,
+             s->end_us ? esp_err_to_name(s->rc) : "not run");
+  }
+}
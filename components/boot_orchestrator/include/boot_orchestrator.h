@@ -0,0 +1,69 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file boot_orchestrator.h
+ *
+ * @brief Runs board init stages concurrently following their dependencies.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_MAX_STAGES (24)
+#define BOOT_DEP(index) (1UL << (index))
+
+typedef esp_err_t (*boot_stage_fn)(void *args);
+
+typedef struct {
+/* Stage description, filled by the caller. */
+  const char *name;
+  boot_stage_fn fn;
+  void *args;
+  uint32_t deps;        /* BOOT_DEP() mask of stages which must finish first */
+  uint32_t stack_size;  /* 0 selects CONFIG_BOOT_STAGE_STACK_SIZE */
+
+/* Timeline, filled by BootRun(). Times are microseconds since power on. */
+  int64_t start_us;
+  int64_t end_us;
+  esp_err_t rc;
+} boot_stage_t;
+
+/**
+ * @brief Run all stages, each one in its own task as soon as its dependencies
+ * are done. Returns when every stage has finished, or with the first error
+ * once the stages already running have finished.
+ */
+esp_err_t BootRun(boot_stage_t *stages, unsigned count);
+void BootReport(const boot_stage_t *stages, unsigned count);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
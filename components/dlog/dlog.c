@@ -0,0 +1,164 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file dlog.c
+ *
+ * @brief Deferred logging ring and the task which empties it.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Writers claim a slot with an atomic increment and publish it by storing its
+ * sequence number last, so logging never takes a lock and works from ISRs.
+ * When the reader falls a whole ring behind, the oldest records are lost and
+ * counted.
+ *
+ */
+
+#include "dlog.h"
+
+#ifdef CONFIG_DLOG_ENABLE
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define DLOG_RING_MASK (CONFIG_DLOG_RING_RECORDS - 1)
+_Static_assert((CONFIG_DLOG_RING_RECORDS & DLOG_RING_MASK) == 0,
+               "CONFIG_DLOG_RING_RECORDS must be a power of two");
+
+#define DLOG_LINE_SIZE (160)
+
+typedef struct {
+  atomic_uint seq;        /* claim index + 1 once written, 0 never written */
+  uint32_t timestamp;
+  const char *fmt;
+  const char *tag;
+  uint8_t level;
+  uint8_t nargs;
+  uint32_t args[DLOG_MAX_ARGS];
+} dlog_record;
+
+static DRAM_ATTR dlog_record s_ring[CONFIG_DLOG_RING_RECORDS];
+static DRAM_ATTR atomic_uint s_head;
+static unsigned s_tail;
+static unsigned s_lost;
+static bool s_initialised;
+
+void DlogWrite(esp_log_level_t level, const char *tag, const char *fmt, unsigned nargs,
+               uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+
+  unsigned index = atomic_fetch_add_explicit(&s_head, 1, memory_order_relaxed);
+  dlog_record *r = &s_ring[index & DLOG_RING_MASK];
+
+  /* Mark the slot as being rewritten before touching its contents. */
+  atomic_store_explicit(&r->seq, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  r->timestamp = esp_log_timestamp();
+  r->fmt = fmt;
+  r->tag = tag;
+  r->level = level;
+  r->nargs = nargs;
+  r->args[0] = a0;
+  r->args[1] = a1;
+  r->args[2] = a2;
+  r->args[3] = a3;
+  atomic_store_explicit(&r->seq, index + 1, memory_order_release);
+}
+
+unsigned DlogLost(void) {
+
+  return s_lost;
+}
+
+static void s_Emit(const dlog_record *r) {
+
+  static const char s_letters[] = "NEWIDV";
+  char letter = r->level < sizeof(s_letters) - 1 ? s_letters[r->level] : '?';
+
+#ifdef CONFIG_DLOG_OUTPUT_BINARY
+  /* Raw record for tools/dlog_decode.py, the format pointer is its id. */
+  printf("DLOG %08" PRIx32 " %08" PRIx32 " %08" PRIx32 " %c", r->timestamp,
+         (uint32_t)(uintptr_t) r->fmt, (uint32_t)(uintptr_t) r->tag, letter);
+  for (unsigned i = 0; i < r->nargs && i < DLOG_MAX_ARGS; i++)
+    printf(" %" PRIx32, r->args[i]);
+  printf("\n");
+#else
+  char line[DLOG_LINE_SIZE];
+  /* Unused trailing arguments are ignored by snprintf. */
+  snprintf(line, sizeof(line), r->fmt, r->args[0], r->args[1], r->args[2], r->args[3]);
+  esp_log_write(r->level, r->tag, "%c (%" PRIu32 ") %s: %s\n", letter, r->timestamp, r->tag,
+                line);
+#endif
+}
+
+static void s_DlogTask(void *args) {
+
+  while (true) {
+    unsigned head = atomic_load_explicit(&s_head, memory_order_acquire);
+
+    if (head - s_tail > CONFIG_DLOG_RING_RECORDS) {
+      s_lost += head - s_tail - CONFIG_DLOG_RING_RECORDS;
+      s_tail = head - CONFIG_DLOG_RING_RECORDS;
+    }
+
+    while (s_tail != head) {
+      dlog_record *r = &s_ring[s_tail & DLOG_RING_MASK];
+      unsigned seq = atomic_load_explicit(&r->seq, memory_order_acquire);
+      if (seq == 0 || (int)(seq - (s_tail + 1)) < 0)
+        break;  /* Claimed but still being written, retry on the next pass. */
+
+      dlog_record copy;
+      copy.timestamp = r->timestamp;
+      copy.fmt = r->fmt;
+      copy.tag = r->tag;
+      copy.level = r->level;
+      copy.nargs = r->nargs;
+      for (int i = 0; i < DLOG_MAX_ARGS; i++)
+        copy.args[i] = r->args[i];
+      atomic_thread_fence(memory_order_acquire);
+
+      /* A writer lapped us, before or while copying: drop the record. */
+      if (seq != s_tail + 1 || atomic_load_explicit(&r->seq, memory_order_relaxed) != seq)
+        s_lost++;
+      else
+        s_Emit(&copy);
+      s_tail++;
+    }
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_DLOG_FLUSH_PERIOD_MS) ?: 1);
+  }
+}
+
+esp_err_t DlogInit(void) {
+
+  if (s_initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  if (xTaskCreate(s_DlogTask, "dlog", CONFIG_DLOG_TASK_STACK_SIZE, NULL,
+                  CONFIG_DLOG_TASK_PRIORITY, NULL) != pdPASS)
+    return ESP_ERR_NO_MEM;
+  s_initialised = true;
+  return ESP_OK;
+}
+
+#endif /* CONFIG_DLOG_ENABLE */
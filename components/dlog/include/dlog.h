@@ -0,0 +1,98 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file dlog.h
+ *
+ * @brief Deferred logging: records the format string pointer and raw
+ * arguments into a ring, formatting happens later in a low priority task or
+ * on the host.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Up to DLOG_MAX_ARGS integer or pointer arguments are supported. Format
+ * strings must be literals and %s arguments must point to strings which stay
+ * valid, e.g. literals or static tables, since they are read when the record
+ * is formatted, not when it is logged. No 64 bit or floating point arguments.
+ *
+ * Define DLOG_LOCAL_LEVEL before including this header to compile out the
+ * records of a source file below that level, like LOG_LOCAL_LEVEL.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DLOG_MAX_ARGS (4)
+
+#ifdef CONFIG_DLOG_ENABLE
+
+#ifndef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL CONFIG_DLOG_DEFAULT_LEVEL
+#endif
+
+esp_err_t DlogInit(void);
+void DlogWrite(esp_log_level_t level, const char *tag, const char *fmt, unsigned nargs,
+               uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+unsigned DlogLost(void);
+
+#define DLOG_CAST(x) ((uint32_t)(uintptr_t)(x))
+#define DLOG_ARGS0()            0, 0, 0, 0, 0
+#define DLOG_ARGS1(a)           1, DLOG_CAST(a), 0, 0, 0
+#define DLOG_ARGS2(a, b)        2, DLOG_CAST(a), DLOG_CAST(b), 0, 0
+#define DLOG_ARGS3(a, b, c)     3, DLOG_CAST(a), DLOG_CAST(b), DLOG_CAST(c), 0
+#define DLOG_ARGS4(a, b, c, d)  4, DLOG_CAST(a), DLOG_CAST(b), DLOG_CAST(c), DLOG_CAST(d)
+#define DLOG_SELECT(_0, _1, _2, _3, _4, name, ...) name
+#define DLOG_ARGS(...) \
+  DLOG_SELECT(_0, ##__VA_ARGS__, DLOG_ARGS4, DLOG_ARGS3, DLOG_ARGS2, DLOG_ARGS1, DLOG_ARGS0)(__VA_ARGS__)
+
+#define DLOG_LEVEL(level, tag, fmt, ...) do {                            \
+    if ((level) <= DLOG_LOCAL_LEVEL)                                      \
+      DlogWrite((level), (tag), (fmt), DLOG_ARGS(__VA_ARGS__));           \
+  } while (0)
+
+#else
+
+static inline esp_err_t DlogInit(void) { return ESP_OK; }
+static inline unsigned DlogLost(void) { return 0; }
+
+/* Without the ring, fall back to regular logging. */
+#define DLOG_LEVEL(level, tag, fmt, ...) ESP_LOG_LEVEL_LOCAL((level), (tag), fmt, ##__VA_ARGS__)
+
+#endif /* CONFIG_DLOG_ENABLE */
+
+#define DLOGE(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#define DLOGV(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,342 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ha_rules.cpp
+ *
+ * @brief Local rules interpreter, storage and configuration topic.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "mqtt_manager.h"
+#include "ha_switch.h"
+#include "ha_rules.h"
+#include "rules_bytecode.h"
+
+static const char *s_TAG = "HA_RULES";
+static const char *s_nvs_namespace = "ha_rules";
+static const char *s_nvs_key = "source";
+
+/* An action of a matched rule, run by the rules task */
+struct rule_action {
+  uint8_t op;
+  uint8_t entity;
+  uint8_t depth;          /* Chaining depth of the event which matched it */
+  uint32_t ms;
+};
+
+struct driver_state {
+
+/* Is driver initialised? */
+  bool initialised;
+
+/* Guards the program against a reload while an event is matched */
+  SemaphoreHandle_t lock;
+
+/* Actions are run by task, never on the task raising the event: that may be
+ * the MQTT task dispatching a command, and actions publish. */
+  QueueHandle_t actions;
+  TaskHandle_t task;
+
+/* Active program */
+  uint8_t program[CONFIG_HA_RULES_MAX_PROGRAM];
+  int program_len;
+  uint32_t source_hash;
+
+/* Chaining depth of the action task is running */
+  unsigned depth;
+
+/* Configuration larger than the MQTT buffer, gathered from its parts */
+  char *config;
+  int config_len;
+};
+static driver_state s_d_state = {};
+
+static uint32_t s_Hash(const char *data, int len) {
+
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < len; i++)
+    hash = (hash ^ (uint8_t) data[i]) * 16777619u;
+  return hash;
+}
+
+/*
+ * @brief Check the conditions of one rule and queue its actions, stopping at
+ * the first condition which does not hold. Called with the lock held.
+ */
+static void s_MatchBody(const uint8_t *code, int len, unsigned depth) {
+
+  int pc = 0;
+  while (pc + 2 <= len) {
+    const uint8_t op = code[pc];
+    const uint8_t entity = code[pc + 1];
+    uint32_t ms = 0;
+    pc += 2;
+    if (op == OP_PULSE || op == OP_AUTO_OFF) {
+      if (pc + 4 > len)
+        return;
+      ms = code[pc] | code[pc + 1] << 8 | code[pc + 2] << 16 | (uint32_t) code[pc + 3] << 24;
+      pc += 4;
+    }
+
+    switch (op) {
+      case OP_IF_ON :
+      case OP_IF_OFF : {
+        HaSwitch *target = HaSwitch::Find(entity);
+        if (!target || target->get() != (op == OP_IF_ON))
+          return;
+        break;
+      }
+      case OP_SET :
+      case OP_RESET :
+      case OP_TOGGLE :
+      case OP_PULSE :
+      case OP_AUTO_OFF : {
+        rule_action action = { op, entity, (uint8_t) depth, ms };
+        if (xQueueSend(s_d_state.actions, &action, 0) != pdTRUE)
+          ESP_LOGW(s_TAG, "Action queue full, action on s_%u dropped", entity);
+        break;
+      }
+      default :
+        return;
+    }
+  }
+}
+
+static void s_EventHook(HaSwitch *switch_p) {
+
+  /* Events raised by an action continue its chain, any other starts one. */
+  const unsigned depth = xTaskGetCurrentTaskHandle() == s_d_state.task ? s_d_state.depth + 1 : 1;
+  if (depth > CONFIG_HA_RULES_MAX_DEPTH) {
+    ESP_LOGW(s_TAG, "Rule chain too deep at s_%u, stopping", switch_p->index());
+    return;
+  }
+
+  const unsigned index = switch_p->index();
+  const bool state = switch_p->get();
+  const uint8_t *program = s_d_state.program;
+  int pc = 0;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  while (pc + c_rules_header_size <= s_d_state.program_len) {
+    const uint8_t entity = program[pc + 1];
+    const uint8_t edge = program[pc + 2];
+    const int body = pc + c_rules_header_size;
+    pc = body + program[pc + 3];
+    if (entity != index)
+      continue;
+    if ((edge == EDGE_ON && !state) || (edge == EDGE_OFF && state))
+      continue;
+    s_MatchBody(program + body, program[body - 1], depth);
+  }
+  xSemaphoreGive(s_d_state.lock);
+}
+
+/*
+ * @brief Run queued actions, outside of any lock: they publish through the
+ * MQTT client and may raise further events.
+ */
+static void s_RulesTask(void *args) {
+
+  rule_action action;
+
+  for (;;) {
+    xQueueReceive(s_d_state.actions, &action, portMAX_DELAY);
+    HaSwitch *target = HaSwitch::Find(action.entity);
+    if (!target)
+      continue;
+    s_d_state.depth = action.depth;
+    switch (action.op) {
+      case OP_SET :
+        target->set();
+        break;
+      case OP_RESET :
+        target->reset();
+        break;
+      case OP_TOGGLE :
+        target->toggle();
+        break;
+      case OP_PULSE :
+        target->pulse(action.ms);
+        break;
+      case OP_AUTO_OFF :
+        target->autoOff(action.ms);
+        break;
+    }
+  }
+}
+
+static void s_ConfigStatus(esp_err_t rc) {
+
+  char status[64];
+  if (rc == ESP_OK)
+    snprintf(status, sizeof(status), "OK %d bytes", s_d_state.program_len);
+  else
+    snprintf(status, sizeof(status), "ERROR");
+  MqttPublishLane(MQTT_LANE_DIAG, CONFIG_HA_RULES_STATUS_TOPIC, status, 0, 0, 0);
+}
+
+/*
+ * @brief Load a configuration once it has arrived whole. Only the source as a
+ * whole is compiled and stored, never a part of it.
+ */
+static void s_ConfigCallback(const char *data, int data_len, int offset, int total_len,
+                             void *user_ctx) {
+
+  if (total_len > CONFIG_HA_RULES_MAX_SOURCE) {
+    if (!offset)
+      s_ConfigStatus(ESP_ERR_INVALID_SIZE);
+    return;
+  }
+  if (data_len == total_len) {
+    s_ConfigStatus(HaRulesLoad(data, data_len, true));
+    return;
+  }
+
+  if (!offset) {
+    free(s_d_state.config);
+    s_d_state.config = (char*) malloc(total_len);
+    s_d_state.config_len = 0;
+  }
+  /* A part is missing, e.g. after a reconnection: the rest is useless. */
+  if (!s_d_state.config || offset != s_d_state.config_len || data_len > total_len - offset) {
+    if (s_d_state.config || !offset)
+      s_ConfigStatus(s_d_state.config ? ESP_ERR_INVALID_SIZE : ESP_ERR_NO_MEM);
+    free(s_d_state.config);
+    s_d_state.config = nullptr;
+    return;
+  }
+  memcpy(s_d_state.config + offset, data, data_len);
+  s_d_state.config_len += data_len;
+  if (s_d_state.config_len < total_len)
+    return;
+
+  s_ConfigStatus(HaRulesLoad(s_d_state.config, total_len, true));
+  free(s_d_state.config);
+  s_d_state.config = nullptr;
+}
+
+static esp_err_t s_LoadStored() {
+
+  nvs_handle_t handle;
+  esp_err_t rc;
+  size_t len = CONFIG_HA_RULES_MAX_SOURCE;
+
+  if ((rc = nvs_open(s_nvs_namespace, NVS_READONLY, &handle)))
+    return rc == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : rc;
+
+  char *source = (char*) malloc(len);
+  if (!source) {
+    nvs_close(handle);
+    return ESP_ERR_NO_MEM;
+  }
+
+  rc = nvs_get_blob(handle, s_nvs_key, source, &len);
+  nvs_close(handle);
+  if (rc == ESP_OK)
+    rc = HaRulesLoad(source, len, false);
+  else if (rc == ESP_ERR_NVS_NOT_FOUND)
+    rc = ESP_OK;
+  free(source);
+  return rc;
+}
+
+static esp_err_t s_Store(const char *source, int len) {
+
+  nvs_handle_t handle;
+  esp_err_t rc;
+
+  if ((rc = nvs_open(s_nvs_namespace, NVS_READWRITE, &handle)))
+    return rc;
+  if (!(rc = nvs_set_blob(handle, s_nvs_key, source, len)))
+    rc = nvs_commit(handle);
+  nvs_close(handle);
+  return rc;
+}
+
+esp_err_t HaRulesInit() {
+
+  esp_err_t rc;
+
+  if (s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  s_d_state.lock = xSemaphoreCreateMutex();
+  s_d_state.actions = xQueueCreate(CONFIG_HA_RULES_QUEUE_DEPTH, sizeof(rule_action));
+  if (!s_d_state.lock || !s_d_state.actions)
+    return ESP_ERR_NO_MEM;
+  if (xTaskCreate(s_RulesTask, "ha_rules", CONFIG_HA_RULES_TASK_STACK_SIZE, nullptr,
+                  CONFIG_HA_RULES_TASK_PRIORITY, &s_d_state.task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+  s_d_state.initialised = true;
+
+  if ((rc = s_LoadStored()))
+    ESP_LOGW(s_TAG, "Stored rules not loaded: %s", esp_err_to_name(rc));
+
+  HaSwitch::SetEventHook(s_EventHook);
+  return MqttSubscribeFragments(CONFIG_HA_RULES_TOPIC, 1, s_ConfigCallback, nullptr);
+}
+
+esp_err_t HaRulesLoad(const char *source, int len, bool persist) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (len < 0 || len > CONFIG_HA_RULES_MAX_SOURCE)
+    return ESP_ERR_INVALID_SIZE;
+
+  uint8_t *program = (uint8_t*) malloc(CONFIG_HA_RULES_MAX_PROGRAM);
+  if (!program)
+    return ESP_ERR_NO_MEM;
+
+  rules_error err;
+  int program_len = RulesCompile(source, len, program, CONFIG_HA_RULES_MAX_PROGRAM, &err);
+  if (program_len < 0) {
+    ESP_LOGE(s_TAG, "Rules line %d: %s", err.line, err.msg);
+    free(program);
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  memcpy(s_d_state.program, program, program_len);
+  s_d_state.program_len = program_len;
+  xSemaphoreGive(s_d_state.lock);
+  free(program);
+  ESP_LOGI(s_TAG, "Loaded %d bytes of rules", program_len);
+
+  uint32_t hash = s_Hash(source, len);
+  if (persist && hash != s_d_state.source_hash) {
+    esp_err_t rc = s_Store(source, len);
+    if (rc)
+      ESP_LOGW(s_TAG, "Rules not stored: %s", esp_err_to_name(rc));
+  }
+  s_d_state.source_hash = hash;
+  return ESP_OK;
+}
@@ -0,0 +1,58 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ha_rules.h
+ *
+ * @brief Local automation rules evaluated on HaSwitch events.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Rules are plain text, one per line, and compiled to a compact bytecode:
+ *
+ *   on <entity> [changed|on|off] [if <entity> is on|off [and ...]] do <action>[, <action>...]
+ *
+ * where <entity> is s_<index> and <action> is one of set, reset or toggle
+ * followed by an entity, or pulse or autooff followed by an entity and a time
+ * in milliseconds. Lines starting with # are comments. For example:
+ *
+ *   on s_1 do toggle s_6
+ *   on s_2 if s_6 is off do pulse s_6 500
+ *
+ */
+
+#pragma once
+
+#include "esp_err.h"
+
+/**
+ * @brief Load the rules stored in NVS, hook into HaSwitch events and subscribe
+ * to CONFIG_HA_RULES_TOPIC. Call after MqttInit().
+ */
+esp_err_t HaRulesInit();
+
+/**
+ * @brief Compile and activate rules, optionally storing them in NVS.
+ *
+ * @return ESP_ERR_INVALID_ARG if the rules do not compile, in which case the
+ * active rules are kept.
+ */
+esp_err_t HaRulesLoad(const char *source, int len, bool persist);
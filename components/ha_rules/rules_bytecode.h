@@ -0,0 +1,70 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file rules_bytecode.h
+ *
+ * @brief Bytecode shared by the rules compiler and interpreter.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * A program is a sequence of rules. Every rule starts with OP_RULE, followed
+ * by the trigger entity, the trigger edge and the length of the rule body.
+ * The body is a straight list of conditions and actions; there are no jumps,
+ * so a program runs in time linear in its size.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+enum rules_op : uint8_t {
+  OP_RULE = 1,    /* entity, edge, body length */
+  OP_IF_ON,       /* entity */
+  OP_IF_OFF,      /* entity */
+  OP_SET,         /* entity */
+  OP_RESET,       /* entity */
+  OP_TOGGLE,      /* entity */
+  OP_PULSE,       /* entity, milliseconds (u32 little endian) */
+  OP_AUTO_OFF     /* entity, milliseconds (u32 little endian) */
+};
+
+enum rules_edge : uint8_t {
+  EDGE_CHANGED = 0,
+  EDGE_ON,
+  EDGE_OFF
+};
+
+constexpr int c_rules_header_size = 4;
+
+struct rules_error {
+  int line;
+  const char *msg;
+};
+
+/**
+ * @brief Compile rules source into bytecode.
+ *
+ * @return size of the program, or -1 with err filled in.
+ */
+int RulesCompile(const char *source, int len, uint8_t *program, int program_size,
+                 rules_error *err);
@@ -0,0 +1,235 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file rules_compiler.cpp
+ *
+ * @brief Compiles rules text to bytecode.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include "rules_bytecode.h"
+
+namespace {
+
+struct token {
+  const char *p;
+  int len;
+};
+
+/* Tokens of a single line, separated by blanks or commas. */
+class Lexer {
+public:
+  Lexer(const char *line, int len) : m_p(line), m_end(line + len) {}
+
+  bool next(token *t) {
+    while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == ',' || *m_p == '\r'))
+      m_p++;
+    if (m_p == m_end)
+      return false;
+    t->p = m_p;
+    while (m_p < m_end && *m_p != ' ' && *m_p != '\t' && *m_p != ',' && *m_p != '\r')
+      m_p++;
+    t->len = m_p - t->p;
+    return true;
+  }
+
+private:
+  const char *m_p;
+  const char *m_end;
+};
+
+bool s_Is(const token &t, const char *word) {
+
+  int len = strlen(word);
+  return t.len == len && !strncmp(t.p, word, len);
+}
+
+bool s_Number(const token &t, uint32_t max, uint32_t *value) {
+
+  uint32_t v = 0;
+  if (!t.len || t.len > 10)
+    return false;
+  for (int i = 0; i < t.len; i++) {
+    if (t.p[i] < '0' || t.p[i] > '9')
+      return false;
+    v = v * 10 + (t.p[i] - '0');
+  }
+  if (v > max)
+    return false;
+  *value = v;
+  return true;
+}
+
+bool s_Entity(const token &t, uint8_t *index) {
+
+  uint32_t v;
+  if (t.len < 3 || strncmp(t.p, "s_", 2))
+    return false;
+  if (!s_Number({t.p + 2, t.len - 2}, UINT8_MAX, &v) || !v)
+    return false;
+  *index = v;
+  return true;
+}
+
+class Emitter {
+public:
+  Emitter(uint8_t *out, int size) : m_out(out), m_size(size), m_len(0) {}
+
+  bool put(uint8_t b) {
+    if (m_len >= m_size)
+      return false;
+    m_out[m_len++] = b;
+    return true;
+  }
+
+  bool put32(uint32_t v) {
+    return put(v) && put(v >> 8) && put(v >> 16) && put(v >> 24);
+  }
+
+  int len() const { return m_len; }
+  uint8_t *at(int offset) { return m_out + offset; }
+
+private:
+  uint8_t *m_out;
+  const int m_size;
+  int m_len;
+};
+
+/* Returns nullptr on success, the error message otherwise. */
+const char *s_CompileLine(Lexer &lex, Emitter &out) {
+
+  token t;
+  uint8_t entity;
+
+  if (!lex.next(&t) || !s_Is(t, "on"))
+    return "expected 'on'";
+  if (!lex.next(&t) || !s_Entity(t, &entity))
+    return "expected trigger entity";
+
+  int start = out.len();
+  if (!out.put(OP_RULE) || !out.put(entity) || !out.put(EDGE_CHANGED) || !out.put(0))
+    return "program too large";
+
+  if (!lex.next(&t))
+    return "expected 'do'";
+  if (s_Is(t, "changed") || s_Is(t, "on") || s_Is(t, "off")) {
+    *out.at(start + 2) = s_Is(t, "on") ? EDGE_ON : s_Is(t, "off") ? EDGE_OFF : EDGE_CHANGED;
+    if (!lex.next(&t))
+      return "expected 'do'";
+  }
+
+  if (s_Is(t, "if")) {
+    do {
+      token is, state;
+      if (!lex.next(&t) || !s_Entity(t, &entity))
+        return "expected condition entity";
+      if (!lex.next(&is) || !s_Is(is, "is") || !lex.next(&state))
+        return "expected 'is on' or 'is off'";
+      if (!s_Is(state, "on") && !s_Is(state, "off"))
+        return "expected 'is on' or 'is off'";
+      if (!out.put(s_Is(state, "on") ? OP_IF_ON : OP_IF_OFF) || !out.put(entity))
+        return "program too large";
+      if (!lex.next(&t))
+        return "expected 'do'";
+    } while (s_Is(t, "and"));
+  }
+
+  if (!s_Is(t, "do"))
+    return "expected 'do'";
+
+  int actions = 0;
+  while (lex.next(&t)) {
+    rules_op op;
+    bool timed = false;
+    if (s_Is(t, "set")) {
+      op = OP_SET;
+    } else if (s_Is(t, "reset")) {
+      op = OP_RESET;
+    } else if (s_Is(t, "toggle")) {
+      op = OP_TOGGLE;
+    } else if (s_Is(t, "pulse")) {
+      op = OP_PULSE;
+      timed = true;
+    } else if (s_Is(t, "autooff")) {
+      op = OP_AUTO_OFF;
+      timed = true;
+    } else {
+      return "unknown action";
+    }
+
+    if (!lex.next(&t) || !s_Entity(t, &entity))
+      return "expected action entity";
+    if (!out.put(op) || !out.put(entity))
+      return "program too large";
+    if (timed) {
+      uint32_t ms;
+      if (!lex.next(&t) || !s_Number(t, UINT32_MAX, &ms))
+        return "expected time in milliseconds";
+      if (!out.put32(ms))
+        return "program too large";
+    }
+    actions++;
+  }
+  if (!actions)
+    return "expected action";
+
+  int body = out.len() - start - c_rules_header_size;
+  if (body > UINT8_MAX)
+    return "rule too long";
+  *out.at(start + 3) = body;
+  return nullptr;
+}
+
+} // namespace
+
+int RulesCompile(const char *source, int len, uint8_t *program, int program_size,
+                 rules_error *err) {
+
+  Emitter out(program, program_size);
+  const char *end = source + len;
+  int line = 0;
+
+  while (source < end) {
+    const char *eol = (const char*) memchr(source, '\n', end - source);
+    if (!eol)
+      eol = end;
+    line++;
+
+    const char *p = source;
+    while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r'))
+      p++;
+    if (p < eol && *p != '#') {
+      Lexer lex(p, eol - p);
+      if (const char *msg = s_CompileLine(lex, out)) {
+        err->line = line;
+        err->msg = msg;
+        return -1;
+      }
+    }
+    source = eol + 1;
+  }
+  return out.len();
+}
@@ -0,0 +1,272 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file discovery_cache.cpp
+ *
+ * @brief Discovery config cache implementation.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "mqtt_manager.h"
+#include "discovery_cache.h"
+
+static const char *s_TAG = "HA_DISCOVERY";
+
+#ifdef CONFIG_HA_DISCOVERY_CACHE
+
+static const char *s_namespace = "ha_discovery";
+
+constexpr int c_topic_max {96};
+constexpr uint32_t c_ack_timeout_ms {30000};
+
+/* NVS blob, keyed by the hex hash of the topic. */
+struct discovery_entry {
+  uint32_t hash;
+  char topic[c_topic_max];
+};
+
+/* A published config whose hash is stored once the broker acknowledged it */
+struct pending_store {
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  uint32_t payload_hash;
+  size_t size;
+  discovery_entry entry;
+};
+
+struct cache_state {
+  SemaphoreHandle_t lock;
+  nvs_handle_t handle;
+  bool opened;
+
+/* Topics published since boot, kept by the sweep */
+  uint32_t seen[CONFIG_HA_DISCOVERY_MAX_CONFIGS];
+  unsigned num_seen;
+  bool overflow;
+};
+
+static uint32_t s_Fnv1a(const char *data) {
+
+  uint32_t hash = 2166136261u;
+  for (const char *c = data; *c; c++)
+    hash = (hash ^ (uint8_t) *c) * 16777619u;
+  return hash;
+}
+
+/*
+ * @brief Hash of a config as held by the active broker: after failover to
+ * another one, every config is sent again.
+ */
+static uint32_t s_BrokerHash(uint32_t payload_hash) {
+
+  mqtt_failover_stats stats = {};
+  MqttGetFailoverStats(&stats);
+  return (payload_hash ^ stats.active_broker) * 16777619u;
+}
+
+static cache_state &s_State() {
+
+  static cache_state state = { xSemaphoreCreateMutex() };
+  return state;
+}
+
+static bool s_Open(cache_state &state) {
+
+  if (!state.opened)
+    state.opened = nvs_open(s_namespace, NVS_READWRITE, &state.handle) == ESP_OK;
+  return state.opened;
+}
+
+static void s_MarkSeen(cache_state &state, uint32_t topic_hash) {
+
+  for (unsigned i = 0; i < state.num_seen; i++) {
+    if (state.seen[i] == topic_hash)
+      return;
+  }
+  if (state.num_seen < CONFIG_HA_DISCOVERY_MAX_CONFIGS)
+    state.seen[state.num_seen++] = topic_hash;
+  else
+    state.overflow = true;
+}
+
+/*
+ * @brief Store the hash of a config the broker acknowledged. Lost or refused
+ * configs keep the old hash, so the next boot sends them again.
+ */
+static void s_Acked(esp_err_t result, void *user_ctx) {
+
+  cache_state &state = s_State();
+  pending_store *pending = (pending_store*) user_ctx;
+
+  if (result == ESP_OK) {
+    pending->entry.hash = s_BrokerHash(pending->payload_hash);
+    xSemaphoreTake(state.lock, portMAX_DELAY);
+    if (nvs_set_blob(state.handle, pending->key, &pending->entry, pending->size) ||
+        nvs_commit(state.handle))
+      ESP_LOGW(s_TAG, "Failed to store the hash of %s", pending->entry.topic);
+    xSemaphoreGive(state.lock);
+  } else {
+    ESP_LOGW(s_TAG, "%s not acknowledged: %s", pending->entry.topic, esp_err_to_name(result));
+  }
+  free(pending);
+}
+
+esp_err_t DiscoveryPublish(const char *topic, const char *payload, bool force) {
+
+  cache_state &state = s_State();
+  const uint32_t topic_hash = s_Fnv1a(topic);
+  const uint32_t payload_hash = s_Fnv1a(payload);
+  const uint32_t hash = s_BrokerHash(payload_hash);
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  discovery_entry entry;
+  size_t size = sizeof(entry);
+
+  if (!state.lock)
+    return ESP_ERR_NO_MEM;
+  snprintf(key, sizeof(key), "%08" PRIx32, topic_hash);
+
+  xSemaphoreTake(state.lock, portMAX_DELAY);
+  s_MarkSeen(state, topic_hash);
+
+  bool opened = s_Open(state);
+  if (!force && opened && nvs_get_blob(state.handle, key, &entry, &size) == ESP_OK &&
+      size > offsetof(discovery_entry, topic) && entry.hash == hash &&
+      !strncmp(entry.topic, topic, sizeof(entry.topic))) {
+    xSemaphoreGive(state.lock);
+    ESP_LOGD(s_TAG, "%s unchanged", topic);
+    return ESP_OK;
+  }
+
+  /* Queuing only hands the config to the bulk lane: its hash is stored once
+   * the broker acknowledged it, never before. */
+  size_t topic_len = strlen(topic) + 1;
+  pending_store *pending = nullptr;
+  if (opened && topic_len <= sizeof(entry.topic) &&
+      (pending = (pending_store*) malloc(sizeof(pending_store)))) {
+    strcpy(pending->key, key);
+    pending->payload_hash = payload_hash;
+    pending->size = offsetof(discovery_entry, topic) + topic_len;
+    memcpy(pending->entry.topic, topic, topic_len);
+  }
+  xSemaphoreGive(state.lock);
+
+  esp_err_t rc;
+  if (pending) {
+    rc = MqttPublishLaneAsync(MQTT_LANE_BULK, topic, payload, 0, 1, 1, c_ack_timeout_ms, s_Acked,
+                              pending);
+    if (rc)
+      free(pending);
+  } else {
+    rc = MqttPublishLane(MQTT_LANE_BULK, topic, payload, 0, 1, 1);
+  }
+  return rc;
+}
+
+/*
+ * @brief Find one stored config not published since boot.
+ */
+static bool s_FindStale(cache_state &state, char *key, discovery_entry *entry) {
+
+  nvs_iterator_t it = nullptr;
+  bool found = false;
+
+  esp_err_t rc = nvs_entry_find(NVS_DEFAULT_PART_NAME, s_namespace, NVS_TYPE_BLOB, &it);
+  while (rc == ESP_OK && !found) {
+    nvs_entry_info_t info;
+    nvs_entry_info(it, &info);
+    uint32_t topic_hash = strtoul(info.key, nullptr, 16);
+
+    found = true;
+    for (unsigned i = 0; i < state.num_seen && found; i++)
+      found = state.seen[i] != topic_hash;
+
+    if (found) {
+      size_t size = sizeof(*entry);
+      strcpy(key, info.key);
+      if (nvs_get_blob(state.handle, key, entry, &size) != ESP_OK ||
+          size <= offsetof(discovery_entry, topic))
+        entry->topic[0] = '\0';
+      entry->topic[sizeof(entry->topic) - 1] = '\0';
+    } else {
+      rc = nvs_entry_next(&it);
+    }
+  }
+  nvs_release_iterator(it);
+  return found;
+}
+
+esp_err_t DiscoverySweep() {
+
+  cache_state &state = s_State();
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  discovery_entry entry;
+  esp_err_t rc = ESP_OK;
+
+  if (!state.lock)
+    return ESP_ERR_NO_MEM;
+
+  xSemaphoreTake(state.lock, portMAX_DELAY);
+  if (state.overflow) {
+    /* Not every published topic is known, clearing could remove live ones. */
+    ESP_LOGW(s_TAG, "More than %d configs, not sweeping", CONFIG_HA_DISCOVERY_MAX_CONFIGS);
+  } else if (s_Open(state)) {
+    while (!rc && s_FindStale(state, key, &entry)) {
+      /* An empty retained config removes the entity from Home Assistant. */
+      if (entry.topic[0]) {
+        ESP_LOGI(s_TAG, "Clearing %s", entry.topic);
+        rc = MqttPublishLane(MQTT_LANE_BULK, entry.topic, "", 0, 1, 1);
+      }
+      if (!rc)
+        rc = nvs_erase_key(state.handle, key);
+    }
+    if (!rc)
+      rc = nvs_commit(state.handle);
+  }
+  xSemaphoreGive(state.lock);
+  return rc;
+}
+
+#else
+
+esp_err_t DiscoveryPublish(const char *topic, const char *payload, bool force) {
+
+  return MqttPublishLane(MQTT_LANE_BULK, topic, payload, 0, 1, 1);
+}
+
+esp_err_t DiscoverySweep() {
+
+  ESP_LOGD(s_TAG, "Discovery cache disabled");
+  return ESP_OK;
+}
+
+#endif
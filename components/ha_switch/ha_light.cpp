@@ -0,0 +1,379 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ha_light.cpp
+ *
+ * @brief ha_light Class implementation.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "mqtt_manager.h"
+#include "discovery_cache.h"
+#include "light_fade.h"
+#include "ha_light.h"
+
+static const char *s_t_config  = "homeassistant/light/franzininho-wifi/%s/config";
+static const char *s_t_command = "franzininho-wifi/%s/set";
+static const char *s_t_state   = "franzininho-wifi/%s/state";
+static const char *s_config_light = "{\"name\":\"Franzininho-WiFi %s\",\"availability_topic\":\"franzininho-wifi/status\",\"command_topic\":\"franzininho-wifi/%s/set\",\"device\":{\"name\":\"franzininho-wifi\",\"identifiers\":[\"615830010\"]},\"platform\":\"light\",\"schema\":\"json\",\"supported_color_modes\":[\"brightness\"],\"state_topic\":\"franzininho-wifi/%s/state\"}";
+static const char *s_state_on  = "{\"state\":\"ON\",\"brightness\":%u,\"color_mode\":\"brightness\"}";
+static const char *s_state_off = "{\"state\":\"OFF\"}";
+
+constexpr ledc_mode_t c_mode {LEDC_LOW_SPEED_MODE};
+constexpr int c_queue_len {8};
+
+/* Lights whose fade ended, handed from the LEDC interrupt to the light task. */
+static QueueHandle_t s_queue = nullptr;
+
+HaLight *HaLight::s_m_head = nullptr;
+unsigned HaLight::s_m_count = 1;
+
+/*
+ * @brief Start of the value of "key" in a flat JSON object, or nullptr.
+ */
+static const char *s_JsonValue(const char *json, const char *key) {
+
+  constexpr int pattern_size = 16;
+  char pattern[pattern_size];
+
+  int temp = snprintf(pattern, pattern_size, "\"%s\"", key);
+  if (temp >= pattern_size || temp < 0)
+    return nullptr;
+
+  const char *value = strstr(json, pattern);
+  if (!value)
+    return nullptr;
+  value += temp;
+  while (*value == ' ')
+    value++;
+  if (*value++ != ':')
+    return nullptr;
+  while (*value == ' ')
+    value++;
+  return value;
+}
+
+HaLight::HaLight(const ha_light_config &config) : m_config(config),
+                                                  m_index(s_m_count),
+                                                  m_configured(false),
+                                                  m_brightness(0),
+                                                  m_on_brightness(light_fade::c_brightness_max),
+                                                  m_target_duty(0),
+                                                  m_next(s_m_head) {
+
+  s_m_head = this;
+  s_m_count++;
+}
+
+HaLight::~HaLight() {
+
+  if (m_configured) {
+    ledc_cbs_t callbacks = {};
+    ledc_cb_register(c_mode, m_config.channel, &callbacks, nullptr);
+    ledc_fade_stop(c_mode, m_config.channel);
+  }
+
+  for (HaLight **link = &s_m_head; *link; link = &(*link)->m_next) {
+    if (*link == this) {
+      *link = m_next;
+      break;
+    }
+  }
+}
+
+esp_err_t HaLight::mConfigure() {
+
+  static bool s_fade_installed = false;
+  esp_err_t rc;
+
+  if (!s_queue) {
+    s_queue = xQueueCreate(c_queue_len, sizeof(HaLight*));
+    if (!s_queue)
+      return ESP_ERR_NO_MEM;
+    if (xTaskCreate(mTask, "ha_light", CONFIG_HA_LIGHT_TASK_STACK_SIZE, nullptr,
+                    CONFIG_HA_LIGHT_TASK_PRIORITY, nullptr) != pdPASS)
+      return ESP_ERR_NO_MEM;
+  }
+
+  ledc_timer_config_t timer = {
+    .speed_mode = c_mode,
+    .duty_resolution = (ledc_timer_bit_t) CONFIG_HA_LIGHT_DUTY_RESOLUTION,
+    .timer_num = m_config.timer,
+    .freq_hz = CONFIG_HA_LIGHT_PWM_FREQ_HZ,
+    .clk_cfg = LEDC_AUTO_CLK,
+  };
+  if ((rc = ledc_timer_config(&timer)))
+    return rc;
+
+  ledc_channel_config_t channel = {
+    .gpio_num = m_config.gpio,
+    .speed_mode = c_mode,
+    .channel = m_config.channel,
+    .intr_type = LEDC_INTR_DISABLE,
+    .timer_sel = m_config.timer,
+    .duty = 0,
+    .hpoint = 0,
+  };
+  if ((rc = ledc_channel_config(&channel)))
+    return rc;
+
+  if (!s_fade_installed) {
+    if ((rc = ledc_fade_func_install(0)))
+      return rc;
+    s_fade_installed = true;
+  }
+
+  ledc_cbs_t callbacks = { .fade_cb = mFadeEnd };
+  if ((rc = ledc_cb_register(c_mode, m_config.channel, &callbacks, this)))
+    return rc;
+
+  m_configured = true;
+  return rc;
+}
+
+esp_err_t HaLight::Connect() {
+
+  constexpr int command_size  =  30;
+  constexpr int instance_size =  12;
+
+  esp_err_t rc;
+  char command_buffer[command_size];
+  char instance[instance_size];
+
+  if (!m_configured && (rc = mConfigure()))
+    return rc;
+
+  snprintf(instance, instance_size, "light_%u", m_index);
+
+  int temp = snprintf(command_buffer, command_size, s_t_command, instance);
+  if (temp > command_size || temp < 0)
+    return ESP_FAIL;
+
+  if ((rc = MqttSubscribe(command_buffer, 0, mCallback, this)))
+    return rc;
+
+  if ((rc = PublishConfig(false)))
+    return rc;
+  return rc = PublishState();
+}
+
+esp_err_t HaLight::Republish(bool force) {
+
+  esp_err_t rc;
+  if ((rc = PublishConfig(force)))
+    return rc;
+  return rc = PublishState();
+}
+
+esp_err_t HaLight::RepublishNth(unsigned n) {
+
+  for (HaLight *light = s_m_head; light; light = light->m_next) {
+    if (!n--)
+      return light->Republish(true);
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t HaLight::RepublishAll(bool force) {
+
+  esp_err_t rc = ESP_OK;
+  for (HaLight *light = s_m_head; light; light = light->m_next) {
+    if (light->Republish(force))
+      rc = ESP_FAIL;
+  }
+  return rc;
+}
+
+bool HaLight::get() {
+
+  return m_brightness;
+}
+
+uint8_t HaLight::brightness() {
+
+  return m_brightness;
+}
+
+esp_err_t HaLight::set(uint8_t brightness, uint32_t transition_ms) {
+
+  esp_err_t rc;
+
+  if (!m_configured)
+    return ESP_ERR_INVALID_STATE;
+
+  /* A fade still running is stopped where it is, the new one starts there. */
+  ledc_fade_stop(c_mode, m_config.channel);
+
+  const uint32_t from = ledc_get_duty(c_mode, m_config.channel);
+  const uint32_t to = light_fade::BrightnessToDuty(brightness, CONFIG_HA_LIGHT_DUTY_RESOLUTION);
+  const uint32_t fade_ms = light_fade::FadeTime(from, to, transition_ms, CONFIG_HA_LIGHT_PWM_FREQ_HZ,
+                                                CONFIG_HA_LIGHT_MAX_TRANSITION_MS);
+
+  m_brightness = brightness;
+  if (brightness)
+    m_on_brightness = brightness;
+  m_target_duty = to;
+
+  if (!fade_ms) {
+    if ((rc = ledc_set_duty_and_update(c_mode, m_config.channel, to, 0)))
+      return rc;
+    return rc = PublishState();
+  }
+
+  /* The state is published by the light task once the fade ends. */
+  if ((rc = ledc_set_fade_with_time(c_mode, m_config.channel, to, fade_ms)))
+    return rc;
+  return rc = ledc_fade_start(c_mode, m_config.channel, LEDC_FADE_NO_WAIT);
+}
+
+esp_err_t HaLight::turnOn(uint32_t transition_ms) {
+
+  return set(m_on_brightness, transition_ms);
+}
+
+esp_err_t HaLight::turnOff(uint32_t transition_ms) {
+
+  return set(0, transition_ms);
+}
+
+/*
+ * @brief Handles Home Assistant JSON schema commands, e.g.
+ * {"state":"ON","brightness":128,"transition":2.5}
+ */
+void HaLight::mCallback(const char *data, int data_len, void *user_ctx) {
+
+  constexpr int command_size = 128;
+  char command[command_size];
+
+  if (!user_ctx || data_len <= 0 || data_len >= command_size)
+    return;
+  memcpy(command, data, data_len);
+  command[data_len] = '\0';
+
+  HaLight *light = (HaLight*) user_ctx;
+  const char *value;
+
+  if (!(value = s_JsonValue(command, "state")))
+    return;
+  bool on = !strncmp(value, "\"ON\"", 4);
+  if (!on && strncmp(value, "\"OFF\"", 5))
+    return;
+
+  uint32_t transition_ms = CONFIG_HA_LIGHT_DEFAULT_TRANSITION_MS;
+  if ((value = s_JsonValue(command, "transition"))) {
+    float seconds = strtof(value, nullptr);
+    transition_ms = seconds > 0 ? seconds * 1000 : 0;
+  }
+
+  if (!on) {
+    light->turnOff(transition_ms);
+  } else if ((value = s_JsonValue(command, "brightness"))) {
+    long brightness = strtol(value, nullptr, 10);
+    if (brightness < 0)
+      brightness = 0;
+    if (brightness > light_fade::c_brightness_max)
+      brightness = light_fade::c_brightness_max;
+    light->set(brightness, transition_ms);
+  } else {
+    light->turnOn(transition_ms);
+  }
+}
+
+bool HaLight::mFadeEnd(const ledc_cb_param_t *param, void *user_arg) {
+
+  BaseType_t woken = pdFALSE;
+  if (param->event == LEDC_FADE_END_EVT && user_arg)
+    xQueueSendFromISR(s_queue, &user_arg, &woken);
+  return woken == pdTRUE;
+}
+
+void HaLight::mTask(void *args) {
+
+  HaLight *light;
+  while (true) {
+    if (xQueueReceive(s_queue, &light, portMAX_DELAY) != pdTRUE)
+      continue;
+    /* Skip fades superseded by a newer command, that one publishes. */
+    if (ledc_get_duty(c_mode, light->m_config.channel) == light->m_target_duty)
+      light->PublishState();
+  }
+}
+
+esp_err_t HaLight::PublishConfig(bool force) {
+
+  constexpr int config_size   = 500;
+  constexpr int instance_size =  12;
+
+  char config_buffer[config_size];
+  char instance[instance_size];
+
+  snprintf(instance, instance_size, "light_%u", m_index);
+
+  int temp, offset, newsize;
+
+  temp = snprintf(config_buffer, config_size, s_t_config, instance);
+  if (temp > config_size || temp < 0)
+    return ESP_FAIL;
+
+  offset = temp + 1;
+  newsize = config_size - offset;
+  temp = snprintf(config_buffer + offset, newsize, s_config_light,
+                  m_config.name ? m_config.name : instance, instance, instance);
+  if (temp > newsize || temp < 0)
+      return ESP_FAIL;
+
+  return DiscoveryPublish(config_buffer, config_buffer+offset, force);
+}
+
+esp_err_t HaLight::PublishState() {
+
+  constexpr int topic_size    =  30;
+  constexpr int state_size    =  64;
+  constexpr int instance_size =  12;
+
+  char topic_buffer[topic_size];
+  char state_buffer[state_size];
+  char instance[instance_size];
+
+  snprintf(instance, instance_size, "light_%u", m_index);
+
+  int temp = snprintf(topic_buffer, topic_size, s_t_state, instance);
+  if (temp > topic_size || temp < 0)
+    return ESP_FAIL;
+
+  if (m_brightness)
+    temp = snprintf(state_buffer, state_size, s_state_on, m_brightness);
+  else
+    temp = snprintf(state_buffer, state_size, "%s", s_state_off);
+  if (temp > state_size || temp < 0)
+    return ESP_FAIL;
+
+  return MqttPublish(topic_buffer, state_buffer, 0, 0, 1);
+}
@@ -0,0 +1,173 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * @file ha_rediscovery.cpp
+ *
+ * @brief Paced republish on the Home Assistant birth message.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "mqtt_manager.h"
+#include "timer_wheel.h"
+#include "ha_switch.h"
+#include "ha_sensor.h"
+#include "ha_light.h"
+#include "ha_rediscovery.h"
+
+static const char *s_TAG = "HA_REDISCOVERY";
+static const char *s_t_birth = "homeassistant/status";
+static const char *s_t_availability = "franzininho-wifi/status";
+
+/* Republish steps, in order; entity steps run once per entity. */
+enum rediscovery_phase {
+  PHASE_AVAILABILITY,
+  PHASE_SWITCHES,
+  PHASE_SENSORS,
+  PHASE_LIGHTS,
+  PHASE_APP,
+  PHASE_DONE
+};
+
+struct rediscovery_state {
+
+/* Is driver initialised? */
+  bool initialised;
+
+  rediscovery_cb callback;
+  void *user_ctx;
+
+/* Last birth payload was "online". Retained ones are not delivered: they
+ * restate an old birth, and the connected callback republishes anyway */
+  bool ha_online;
+
+/* Set by HaRediscoveryStart(), the next step starts over */
+  std::atomic<bool> restart;
+
+/* Next step, only touched by the timer wheel task; each step arms the
+ * one shot timer for the next one */
+  rediscovery_phase phase;
+  unsigned entity;
+  timer_wheel_node timer;
+};
+static rediscovery_state s_d_state = {};
+
+/*
+ * @brief Republish the next entity of the current phase, moving on to the
+ * next phase when the current one has none left.
+ */
+static void s_Step(void *user_ctx) {
+
+  if (s_d_state.restart.exchange(false)) {
+    s_d_state.phase = PHASE_AVAILABILITY;
+    s_d_state.entity = 0;
+  }
+
+  esp_err_t rc = ESP_ERR_NOT_FOUND;
+  while (rc == ESP_ERR_NOT_FOUND && s_d_state.phase != PHASE_DONE) {
+    switch (s_d_state.phase) {
+    case PHASE_AVAILABILITY:
+      rc = MqttPublish(s_t_availability, "online", 0, 0, 1);
+      break;
+    case PHASE_SWITCHES:
+      rc = HaSwitch::RepublishNth(s_d_state.entity);
+      break;
+    case PHASE_SENSORS:
+      rc = HaSensor::RepublishNth(s_d_state.entity);
+      break;
+    case PHASE_LIGHTS:
+      rc = HaLight::RepublishNth(s_d_state.entity);
+      break;
+    case PHASE_APP:
+      if (s_d_state.callback)
+        s_d_state.callback(s_d_state.user_ctx);
+      rc = ESP_OK;
+      break;
+    case PHASE_DONE:
+      break;
+    }
+
+    if (rc == ESP_ERR_NOT_FOUND || s_d_state.phase == PHASE_AVAILABILITY ||
+        s_d_state.phase == PHASE_APP) {
+      s_d_state.phase = (rediscovery_phase) (s_d_state.phase + 1);
+      s_d_state.entity = 0;
+    } else {
+      s_d_state.entity++;
+    }
+    if (rc && rc != ESP_ERR_NOT_FOUND)
+      ESP_LOGW(s_TAG, "Republish step failed: %s", esp_err_to_name(rc));
+  }
+
+  if (s_d_state.phase != PHASE_DONE)
+    TimerWheelStart(&s_d_state.timer, CONFIG_HA_REDISCOVERY_PACE_MS, 0, s_Step, nullptr);
+  else
+    ESP_LOGI(s_TAG, "Republish done");
+}
+
+static void s_BirthCallback(const char *data, int data_len, void *user_ctx) {
+
+  bool online = data_len == 6 && !strncmp(data, "online", 6);
+  if (online && !s_d_state.ha_online) {
+    ESP_LOGI(s_TAG, "Home Assistant is online");
+    HaRediscoveryStart(CONFIG_HA_REDISCOVERY_JITTER_MS);
+  }
+  s_d_state.ha_online = online;
+}
+
+esp_err_t HaRediscoveryInit(rediscovery_cb callback, void *user_ctx) {
+
+  if (s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  s_d_state.callback = callback;
+  s_d_state.user_ctx = user_ctx;
+  s_d_state.phase = PHASE_DONE;
+  s_d_state.initialised = true;
+
+  esp_err_t rc;
+  if ((rc = MqttSubscribeLive(s_t_birth, 1, s_BirthCallback, nullptr)))
+    s_d_state.initialised = false;
+  return rc;
+}
+
+esp_err_t HaRediscoveryStart(uint32_t jitter_ms) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  s_d_state.restart = true;
+  uint32_t delay_ms = jitter_ms ? esp_random() % jitter_ms : 0;
+  ESP_LOGI(s_TAG, "Republishing in %" PRIu32 " ms", delay_ms);
+  return TimerWheelStart(&s_d_state.timer, delay_ms, 0, s_Step, nullptr);
+}
+
+bool HaRediscoveryRunning() {
+
+  return TimerWheelIsPending(&s_d_state.timer);
+}
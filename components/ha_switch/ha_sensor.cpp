@@ -0,0 +1,320 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ha_sensor.cpp
+ *
+ * @brief ha_sensor Class implementation.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cmath>
+#include <cstdio>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "mqtt_manager.h"
+#include "discovery_cache.h"
+#include "ha_sensor.h"
+
+static const char *s_t_config = "homeassistant/sensor/franzininho-wifi/%s/config";
+static const char *s_t_state  = "franzininho-wifi/%s/state";
+static const char *s_config_sensor = "{\"name\":\"Franzininho-WiFi %s\",\"availability_topic\":\"franzininho-wifi/status\",\"device\":{\"name\":\"franzininho-wifi\",\"identifiers\":[\"615830010\"]},\"platform\":\"sensor\",\"state_topic\":\"franzininho-wifi/%s/state\",\"value_template\":\"{{ value_json.mean }}\",\"json_attributes_topic\":\"franzininho-wifi/%s/state\",\"state_class\":\"measurement\"%s%s}";
+static const char *s_state_sensor  = "{\"mean\":%.3f,\"min\":%.3f,\"max\":%.3f,\"samples\":%u}";
+
+/* A full sample buffer handed from the esp_timer task to the sensor task. */
+struct sensor_batch {
+  HaSensor *sensor;
+  unsigned buffer;
+};
+
+static QueueHandle_t s_queue = nullptr;
+
+HaSensor *HaSensor::s_m_head = nullptr;
+unsigned HaSensor::s_m_count = 1;
+
+HaSensor::HaSensor(const ha_sensor_config &config, sensor_read_cb read_callback, void *user_ctx) :
+                   m_config(config),
+                   m_read_callback(read_callback),
+                   m_user_ctx(user_ctx),
+                   m_index(s_m_count),
+                   m_timer(nullptr),
+                   m_samples{},
+                   m_busy{},
+                   m_fill(0),
+                   m_count(0),
+                   m_overruns(0),
+                   m_published(false),
+                   m_last_mean(NAN),
+                   m_last_publish_us(0),
+                   m_interval_samples(0),
+                   m_interval_min(0),
+                   m_interval_max(0),
+                   m_next(s_m_head) {
+
+  if (!m_config.batch_size)
+    m_config.batch_size = 1;
+  if (m_config.batch_size > CONFIG_HA_SENSOR_MAX_BATCH)
+    m_config.batch_size = CONFIG_HA_SENSOR_MAX_BATCH;
+  s_m_head = this;
+  s_m_count++;
+}
+
+HaSensor::~HaSensor() {
+
+  if (m_timer) {
+    esp_timer_stop(m_timer);
+    esp_timer_delete(m_timer);
+  }
+  /* Let the sensor task finish with any batch still queued. */
+  while (m_busy[0] || m_busy[1])
+    vTaskDelay(1);
+
+  for (HaSensor **link = &s_m_head; *link; link = &(*link)->m_next) {
+    if (*link == this) {
+      *link = m_next;
+      break;
+    }
+  }
+}
+
+esp_err_t HaSensor::Connect() {
+
+  esp_err_t rc;
+
+  if (!m_read_callback || !m_config.sample_period_us)
+    return ESP_ERR_INVALID_ARG;
+
+  if (!s_queue) {
+    s_queue = xQueueCreate(CONFIG_HA_SENSOR_QUEUE_LEN, sizeof(sensor_batch));
+    if (!s_queue)
+      return ESP_ERR_NO_MEM;
+    if (xTaskCreate(mTask, "ha_sensor", CONFIG_HA_SENSOR_TASK_STACK_SIZE, nullptr,
+                    CONFIG_HA_SENSOR_TASK_PRIORITY, nullptr) != pdPASS)
+      return ESP_ERR_NO_MEM;
+  }
+
+  if ((rc = PublishConfig(false)))
+    return rc;
+
+  if (m_timer)
+    return ESP_OK;
+
+  const esp_timer_create_args_t args = {
+    .callback = mSample,
+    .arg = this,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "ha_sensor",
+    .skip_unhandled_events = true,
+  };
+  if ((rc = esp_timer_create(&args, &m_timer)))
+    return rc;
+  return esp_timer_start_periodic(m_timer, m_config.sample_period_us);
+}
+
+esp_err_t HaSensor::Republish(bool force) {
+
+  esp_err_t rc;
+  if ((rc = PublishConfig(force)))
+    return rc;
+  if (!m_published)
+    return ESP_OK;
+  return PublishState(m_last_mean, 0);
+}
+
+esp_err_t HaSensor::RepublishNth(unsigned n) {
+
+  for (HaSensor *sensor = s_m_head; sensor; sensor = sensor->m_next) {
+    if (!n--)
+      return sensor->Republish(true);
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t HaSensor::RepublishAll(bool force) {
+
+  esp_err_t rc = ESP_OK;
+  for (HaSensor *sensor = s_m_head; sensor; sensor = sensor->m_next) {
+    if (sensor->Republish(force))
+      rc = ESP_FAIL;
+  }
+  return rc;
+}
+
+float HaSensor::get() {
+
+  return m_last_mean;
+}
+
+unsigned HaSensor::overruns() {
+
+  return m_overruns;
+}
+
+/*
+ * @brief Runs in the esp_timer task, keep it short. Fills one buffer while the
+ * sensor task reduces the other; if the sensor task falls a whole batch
+ * behind, the batch just sampled is dropped and counted as an overrun.
+ */
+void HaSensor::mSample(void *user_ctx) {
+
+  HaSensor *sensor = (HaSensor*) user_ctx;
+  unsigned fill = sensor->m_fill;
+
+  sensor->m_samples[fill][sensor->m_count++] = sensor->m_read_callback(sensor->m_user_ctx);
+  if (sensor->m_count < sensor->m_config.batch_size)
+    return;
+  sensor->m_count = 0;
+
+  if (sensor->m_busy[fill ^ 1]) {
+    sensor->m_overruns++;
+    return;
+  }
+
+  sensor_batch batch = {sensor, fill};
+  sensor->m_busy[fill] = true;
+  if (xQueueSend(s_queue, &batch, 0) != pdTRUE) {
+    sensor->m_busy[fill] = false;
+    sensor->m_overruns++;
+    return;
+  }
+  sensor->m_fill = fill ^ 1;
+}
+
+void HaSensor::mTask(void *args) {
+
+  sensor_batch batch;
+  while (true) {
+    if (xQueueReceive(s_queue, &batch, portMAX_DELAY) == pdTRUE)
+      batch.sensor->mProcess(batch.buffer);
+  }
+}
+
+void HaSensor::mProcess(unsigned buffer) {
+
+  const float *samples = m_samples[buffer];
+  const unsigned count = m_config.batch_size;
+
+  float sum = 0, min = samples[0], max = samples[0];
+  for (unsigned i = 0; i < count; i++) {
+    sum += samples[i];
+    if (samples[i] < min)
+      min = samples[i];
+    if (samples[i] > max)
+      max = samples[i];
+  }
+  m_busy[buffer] = false;
+
+  const float mean = sum / count;
+
+  /* min and max cover every sample since the last publish, so short spikes
+   * inside suppressed batches still reach Home Assistant. */
+  if (!m_interval_samples || min < m_interval_min)
+    m_interval_min = min;
+  if (!m_interval_samples || max > m_interval_max)
+    m_interval_max = max;
+  m_interval_samples += count;
+
+  /* Publishing against the last published mean, rather than the previous
+   * batch, gives the deadband its hysteresis: slow drifts still get through
+   * once they add up to the deadband, noise around a value does not. */
+  const int64_t now = esp_timer_get_time();
+  const int64_t since_ms = (now - m_last_publish_us) / 1000;
+  bool due;
+  if (!m_published)
+    due = true;
+  else if (m_config.max_interval_ms && since_ms >= m_config.max_interval_ms)
+    due = true;
+  else
+    due = since_ms >= m_config.min_interval_ms && fabsf(mean - m_last_mean) >= m_config.deadband;
+
+  if (!due)
+    return;
+
+  if (PublishState(mean, m_interval_samples))
+    return;
+  m_published = true;
+  m_last_mean = mean;
+  m_last_publish_us = now;
+  m_interval_samples = 0;
+}
+
+esp_err_t HaSensor::PublishConfig(bool force) {
+
+  constexpr int config_size   = 600;
+  constexpr int extra_size    =  64;
+  constexpr int instance_size =  12;
+
+  char config_buffer[config_size];
+  char instance[instance_size];
+  char unit[extra_size] = "";
+  char device_class[extra_size] = "";
+
+  snprintf(instance, instance_size, "sensor_%u", m_index);
+  if (m_config.unit)
+    snprintf(unit, extra_size, ",\"unit_of_measurement\":\"%s\"", m_config.unit);
+  if (m_config.device_class)
+    snprintf(device_class, extra_size, ",\"device_class\":\"%s\"", m_config.device_class);
+
+  int temp, offset, newsize;
+
+  temp = snprintf(config_buffer, config_size, s_t_config, instance);
+  if (temp > config_size || temp < 0)
+    return ESP_FAIL;
+
+  offset = temp + 1;
+  newsize = config_size - offset;
+  temp = snprintf(config_buffer + offset, newsize, s_config_sensor,
+                  m_config.name ? m_config.name : instance, instance, instance, unit, device_class);
+  if (temp > newsize || temp < 0)
+      return ESP_FAIL;
+
+  return DiscoveryPublish(config_buffer, config_buffer+offset, force);
+}
+
+esp_err_t HaSensor::PublishState(float mean, unsigned samples) {
+
+  constexpr int topic_size    =  40;
+  constexpr int state_size    =  96;
+  constexpr int instance_size =  12;
+
+  char topic_buffer[topic_size];
+  char state_buffer[state_size];
+  char instance[instance_size];
+
+  snprintf(instance, instance_size, "sensor_%u", m_index);
+
+  int temp = snprintf(topic_buffer, topic_size, s_t_state, instance);
+  if (temp > topic_size || temp < 0)
+    return ESP_FAIL;
+
+  if (samples)
+    temp = snprintf(state_buffer, state_size, s_state_sensor, mean, m_interval_min,
+                    m_interval_max, samples);
+  else
+    temp = snprintf(state_buffer, state_size, s_state_sensor, mean, mean, mean, 0);
+  if (temp > state_size || temp < 0)
+    return ESP_FAIL;
+
+  return MqttPublish(topic_buffer, state_buffer, 0, 0, 1);
+}
@@ -28,23 +28,44 @@
  *
  */
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
 #include "mqtt_device_trigger.h"
 #include "mqtt_switch.h"
 #include "ha_switch.h"
 
+static const char *s_TAG = "HA_SWITCH";
+
 unsigned HaSwitch::s_m_count = 1;
+HaSwitch *HaSwitch::s_m_registry[CONFIG_HA_SWITCH_MAX_ENTITIES + 1] = {};
+event_hook HaSwitch::s_m_hook = nullptr;
+SemaphoreHandle_t HaSwitch::s_m_restored = nullptr;
 
-HaSwitch::HaSwitch(bool gui_switch, user_cb user_callback) : m_user_callback(user_callback),
-                                                             m_switch_p(nullptr) {
+HaSwitch::HaSwitch(bool gui_switch, user_cb user_callback) : m_user_callback(std::move(user_callback)),
+                                                             m_index(s_m_count),
+                                                             m_switch_p(nullptr),
+                                                             m_timer{},
+                                                             m_restore(RESTORE_IDLE) {
 
   if (gui_switch)
-    m_switch_p = new MqttSwitch(s_m_count);
+    m_switch_p = new MqttSwitch(m_index);
   else
-    m_switch_p = new MqttDeviceTrigger(s_m_count);
+    m_switch_p = new MqttDeviceTrigger(m_index);
+#ifdef CONFIG_HA_SWITCH_RESTORE_STATE
+  /* Held back until RestoreAll() read the retained state. */
+  if (m_switch_p->restorable())
+    m_restore = RESTORE_PENDING;
+#endif
+  if (m_index <= CONFIG_HA_SWITCH_MAX_ENTITIES)
+    s_m_registry[m_index] = this;
   s_m_count++;
 }
 
 HaSwitch::~HaSwitch() {
+  TimerWheelCancel(&m_timer);
+  if (m_index <= CONFIG_HA_SWITCH_MAX_ENTITIES && s_m_registry[m_index] == this)
+    s_m_registry[m_index] = nullptr;
   if (m_switch_p)
     delete m_switch_p;
 }
@@ -56,6 +77,86 @@ esp_err_t HaSwitch::Connect() {
   return ESP_FAIL;
 }
 
+esp_err_t HaSwitch::Republish(bool force) {
+
+  if (!m_switch_p)
+    return ESP_FAIL;
+  /* The connection may come up before RestoreAll() subscribed: publishing
+   * the state now would overwrite the retained one it is about to read. */
+  if (m_restore == RESTORE_PENDING)
+    return m_switch_p->RepublishConfig(force);
+  return m_switch_p->Republish(force);
+}
+
+esp_err_t HaSwitch::RepublishAll(bool force) {
+
+  esp_err_t rc = ESP_OK;
+  for (unsigned i = 1; i <= CONFIG_HA_SWITCH_MAX_ENTITIES; i++) {
+    if (s_m_registry[i] && s_m_registry[i]->Republish(force))
+      rc = ESP_FAIL;
+  }
+  return rc;
+}
+
+esp_err_t HaSwitch::RepublishNth(unsigned n) {
+
+  for (unsigned i = 1; i <= CONFIG_HA_SWITCH_MAX_ENTITIES; i++) {
+    if (s_m_registry[i] && !n--)
+      return s_m_registry[i]->Republish(true);
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t HaSwitch::RestoreAll(uint32_t timeout_ms) {
+
+  /* Given by HaVirtualSwitch::mRestore() for each switch restored. */
+  if (!s_m_restored)
+    s_m_restored = xSemaphoreCreateCounting(CONFIG_HA_SWITCH_MAX_ENTITIES, 0);
+  if (!s_m_restored)
+    return ESP_ERR_NO_MEM;
+  while (xSemaphoreTake(s_m_restored, 0) == pdTRUE) {}
+
+  /* All subscriptions go out at once, so the retained states come back
+   * within one round trip. Switches already changed, e.g. by a rule, keep
+   * their state. */
+  unsigned pending = 0, restored = 0;
+  for (unsigned i = 1; i <= CONFIG_HA_SWITCH_MAX_ENTITIES; i++) {
+    HaSwitch *s = s_m_registry[i];
+    if (!s || !s->m_switch_p || !s->m_switch_p->restorable() || s->m_restore != RESTORE_PENDING)
+      continue;
+    if (!s->m_switch_p->SubscribeRestore(s)) {
+      pending++;
+    } else if (s->m_restore.exchange(RESTORE_IDLE) == RESTORE_PENDING) {
+      s->m_switch_p->RestoreExpired(s);
+    }
+  }
+
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+  while (restored < pending) {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed >= timeout || xSemaphoreTake(s_m_restored, timeout - elapsed) != pdTRUE)
+      break;
+    restored++;
+  }
+
+  for (unsigned i = 1; i <= CONFIG_HA_SWITCH_MAX_ENTITIES; i++) {
+    HaSwitch *s = s_m_registry[i];
+    if (!s || !s->m_switch_p || !s->m_switch_p->restorable())
+      continue;
+    /* Nothing retained by now, e.g. the first boot: start off and say so,
+     * but keep listening as HaVirtualSwitch::mRestore() explains. */
+    uint8_t restore = RESTORE_PENDING;
+    if (s->m_restore.compare_exchange_strong(restore, RESTORE_LATE))
+      s->m_switch_p->RestoreExpired(s);
+    else
+      s->m_switch_p->UnsubscribeRestore();
+  }
+  ESP_LOGI(s_TAG, "Restored %u of %u switches in %" PRIu32 " ms", restored, pending,
+           (uint32_t) pdTICKS_TO_MS(xTaskGetTickCount() - start));
+  return ESP_OK;
+}
+
 bool HaSwitch::get() {
 
   if (m_switch_p)
@@ -65,6 +166,7 @@ bool HaSwitch::get() {
 
 esp_err_t HaSwitch::set() {
 
+  mCancelRestore();
   if (m_switch_p)
     return m_switch_p->set(this);
   return ESP_FAIL;
@@ -72,6 +174,7 @@ esp_err_t HaSwitch::set() {
 
 esp_err_t HaSwitch::reset() {
 
+  mCancelRestore();
   if (m_switch_p)
     return m_switch_p->reset(this);
   return ESP_FAIL;
@@ -79,8 +182,83 @@ esp_err_t HaSwitch::reset() {
 
 esp_err_t HaSwitch::toggle() {
 
+  mCancelRestore();
   if (m_switch_p)
     return m_switch_p->toggle(this);
   return ESP_FAIL;
 }
 
+esp_err_t HaSwitch::longPress() {
+
+  if (m_switch_p)
+    return m_switch_p->longPress(this);
+  return ESP_FAIL;
+}
+
+unsigned HaSwitch::index() const {
+
+  return m_index;
+}
+
+HaSwitch *HaSwitch::Find(unsigned index) {
+
+  if (index > CONFIG_HA_SWITCH_MAX_ENTITIES)
+    return nullptr;
+  return s_m_registry[index];
+}
+
+void HaSwitch::SetEventHook(event_hook hook) {
+
+  s_m_hook = hook;
+}
+
+void HaSwitch::mNotify() {
+
+  if (m_user_callback)
+    m_user_callback(this);
+  if (s_m_hook)
+    s_m_hook(this);
+}
+
+/* A command, a rule or a button changed the switch: that is newer than any
+ * retained state still on its way. */
+void HaSwitch::mCancelRestore() {
+
+  if (m_restore.exchange(RESTORE_IDLE) == RESTORE_PENDING && s_m_restored)
+    xSemaphoreGive(s_m_restored);
+}
+
+esp_err_t HaSwitch::autoOff(uint32_t delay_ms) {
+
+  return TimerWheelStart(&m_timer, delay_ms, 0, mTimerReset, this);
+}
+
+esp_err_t HaSwitch::pulse(uint32_t width_ms) {
+
+  esp_err_t rc;
+  if ((rc = set()))
+    return rc;
+  return autoOff(width_ms);
+}
+
+esp_err_t HaSwitch::schedule(uint32_t period_ms) {
+
+  if (!period_ms)
+    return ESP_ERR_INVALID_ARG;
+  return TimerWheelStart(&m_timer, period_ms, period_ms, mTimerToggle, this);
+}
+
+esp_err_t HaSwitch::cancelTimer() {
+
+  return TimerWheelCancel(&m_timer);
+}
+
+void HaSwitch::mTimerReset(void *user_ctx) {
+
+  ((HaSwitch*) user_ctx)->reset();
+}
+
+void HaSwitch::mTimerToggle(void *user_ctx) {
+
+  ((HaSwitch*) user_ctx)->toggle();
+}
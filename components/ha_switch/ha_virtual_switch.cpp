@@ -28,14 +28,23 @@
  *
  */
 
+#include <cstdio>
 #include <cstring>
+#include "esp_log.h"
+#include "mqtt_manager.h"
+#include "trace.h"
+#include "switch_command.h"
 #include "ha_virtual_switch.h"
 
+static const char *s_TAG = "HA_SWITCH";
+
 const char* HaVirtualSwitch::s_t_action = "franzininho-wifi/%s/action";
 const char* HaVirtualSwitch::s_t_state   = "franzininho-wifi/%s/state";
 const char* HaVirtualSwitch::s_on = "ON";
 const char* HaVirtualSwitch::s_off = "OFF";
 const char* HaVirtualSwitch::s_press = "PRESS";
+bool HaVirtualSwitch::s_m_action_routed = false;
+bool HaVirtualSwitch::s_m_state_routed = false;
 
 bool HaVirtualSwitch::get() {
 
@@ -44,23 +53,198 @@ bool HaVirtualSwitch::get() {
 
 esp_err_t HaVirtualSwitch::toggle(HaSwitch *ha_switch_p) {
 
+  TRACE_BEGIN(SWITCH_TOGGLE, m_index);
   m_state = !m_state;
-  if (ha_switch_p->m_user_callback)
-    ha_switch_p->m_user_callback(ha_switch_p);
-  return PublishState();
+  mNotify(ha_switch_p);
+  esp_err_t rc = PublishState();
+  TRACE_END(SWITCH_TOGGLE, m_index);
+  return rc;
+}
+
+esp_err_t HaVirtualSwitch::longPress(HaSwitch *ha_switch_p) {
+
+  return toggle(ha_switch_p);
 }
 
 void HaVirtualSwitch::mCallback(const char *data, int data_len, void *user_ctx) {
 
   if (user_ctx) {
     HaSwitch *ha_switch_p = (HaSwitch*) user_ctx;
-    if (!strncmp(s_on, data, data_len)) {
-      ha_switch_p->set();
+    TRACE_BEGIN(SWITCH_COMMAND, data_len);
+    /* Only commands changing the state are dispatched, set(), reset() and
+     * toggle() notify the user callback; repeated or malformed ones are
+     * dropped here without touching the GPIOs or publishing. */
+    switch (SwitchCommandParse(data, data_len)) {
+    case SWITCH_COMMAND_ON:
+      if (!ha_switch_p->get())
+        ha_switch_p->set();
+      break;
+    case SWITCH_COMMAND_OFF:
+      if (ha_switch_p->get())
+        ha_switch_p->reset();
+      break;
+    case SWITCH_COMMAND_TOGGLE:
+      ha_switch_p->toggle();
+      break;
+    default:
+      break;
     }
-    if (!strncmp(s_off, data, data_len)) {
-      ha_switch_p->reset();
+    TRACE_END(SWITCH_COMMAND, data_len);
+  }
+}
+
+esp_err_t HaVirtualSwitch::SubscribeCommand(HaSwitch *ha_switch_p) {
+
+  constexpr int topic_size    =  30;
+  constexpr int instance_size =   8;
+
+  esp_err_t rc;
+  char topic_buffer[topic_size];
+  char instance[instance_size];
+  const char *topic = commandTopic();
+
+#ifdef CONFIG_HA_SWITCH_WILDCARD_SUBSCRIPTIONS
+  /* The device publishes on every state topic, so without no local that
+   * wildcard would bring back each of its own states; it is only shared
+   * with MQTT 5. */
+#ifdef CONFIG_MQTT_MANAGER_PROTOCOL_V5
+  const bool wildcard = true;
+#else
+  const bool wildcard = topic == s_t_action;
+#endif
+  if (wildcard) {
+    /* A broker may send one copy per matching subscription, so an entity
+     * with its own subscription under the wildcard would get each command
+     * twice: entities past the lookup table cannot be routed. */
+    if (HaSwitch::Find(m_index) != ha_switch_p) {
+      ESP_LOGE(s_TAG, "Entity %u past CONFIG_HA_SWITCH_MAX_ENTITIES", m_index);
+      return ESP_ERR_NO_MEM;
     }
-    if (ha_switch_p->m_user_callback)
-      ha_switch_p->m_user_callback((HaSwitch*)user_ctx);
+    bool &routed = topic == s_t_action ? s_m_action_routed : s_m_state_routed;
+    if (routed)
+      return ESP_OK;
+    snprintf(topic_buffer, topic_size, topic, "+");
+    if ((rc = MqttSubscribeFilter(topic_buffer, 0, mRoute, (void*) topic)))
+      return rc;
+    routed = true;
+    return ESP_OK;
+  }
+#endif
+
+  snprintf(instance, instance_size, "s_%u", m_index);
+
+  int temp = snprintf(topic_buffer, topic_size, topic, instance);
+  if (temp > topic_size || temp < 0)
+    return ESP_FAIL;
+
+  return rc = MqttSubscribe(topic_buffer, 0, mCallback, ha_switch_p);
+}
+
+void HaVirtualSwitch::mRoute(const char *topic, int topic_len, const char *data, int data_len,
+                             void *user_ctx) {
+
+  /* The filter fixed every level but the instance, "s_<index>". */
+  static constexpr char prefix[] = "franzininho-wifi/s_";
+  constexpr int prefix_len = sizeof(prefix) - 1;
+
+  if (topic_len <= prefix_len || strncmp(topic, prefix, prefix_len))
+    return;
+  unsigned index = 0;
+  int i = prefix_len;
+  for (; i < topic_len && topic[i] >= '0' && topic[i] <= '9'; i++) {
+    index = index * 10 + (topic[i] - '0');
+    if (index > CONFIG_HA_SWITCH_MAX_ENTITIES)
+      return;
+  }
+  if (i == prefix_len || i == topic_len || topic[i] != '/')
+    return;
+
+  /* Switches take commands on action and triggers on state; anything else
+   * is another entity's traffic, e.g. our own echoed without MQTT 5. */
+  HaSwitch *ha_switch_p = HaSwitch::Find(index);
+  if (!ha_switch_p || !ha_switch_p->m_switch_p || ha_switch_p->m_switch_p->commandTopic() != user_ctx)
+    return;
+  mCallback(data, data_len, ha_switch_p);
+}
+
+int HaVirtualSwitch::StateTopic(char *buffer, int size) const {
+
+  constexpr int instance_size =   8;
+
+  char instance[instance_size];
+  snprintf(instance, instance_size, "s_%u", m_index);
+
+  int temp = snprintf(buffer, size, s_t_state, instance);
+  if (temp >= size || temp < 0)
+    return -1;
+  return temp;
+}
+
+esp_err_t HaVirtualSwitch::SubscribeRestore(HaSwitch *ha_switch_p) {
+
+  constexpr int topic_size    =  30;
+
+  char topic_buffer[topic_size];
+  if (StateTopic(topic_buffer, topic_size) < 0)
+    return ESP_FAIL;
+  return MqttSubscribe(topic_buffer, 0, mRestore, ha_switch_p);
+}
+
+esp_err_t HaVirtualSwitch::UnsubscribeRestore() {
+
+  constexpr int topic_size    =  30;
+
+  char topic_buffer[topic_size];
+  if (StateTopic(topic_buffer, topic_size) < 0)
+    return ESP_FAIL;
+  return MqttUnsubscribe(topic_buffer);
+}
+
+void HaVirtualSwitch::mRestore(const char *data, int data_len, void *user_ctx) {
+
+  HaSwitch *ha_switch_p = (HaSwitch*) user_ctx;
+  switch_command command = SwitchCommandParse(data, data_len);
+  if (command != SWITCH_COMMAND_ON && command != SWITCH_COMMAND_OFF)
+    return;
+
+  HaVirtualSwitch *switch_p = ha_switch_p->m_switch_p;
+  bool state = command == SWITCH_COMMAND_ON;
+
+  /* The first retained state restores the switch. It came from the broker,
+   * so it is not published back; RestoreAll() unsubscribes. */
+  uint8_t restore = HaSwitch::RESTORE_PENDING;
+  if (ha_switch_p->m_restore.compare_exchange_strong(restore, HaSwitch::RESTORE_IDLE)) {
+    switch_p->m_state = state;
+    mNotify(ha_switch_p);
+    xSemaphoreGive(HaSwitch::s_m_restored);
+    return;
   }
+
+  /* RestoreAll() gave up and published the reset state. The broker sends a
+   * retained state it already had ahead of the echo of that publish, so the
+   * first state arriving now settles it: the echo, or the retained state,
+   * which wins and is published again over the reset one. Unless a command
+   * changed the switch meanwhile, which cancelled the restore. */
+  if (restore == HaSwitch::RESTORE_LATE &&
+      ha_switch_p->m_restore.compare_exchange_strong(restore, HaSwitch::RESTORE_IDLE) &&
+      state != switch_p->m_state) {
+    if (state)
+      switch_p->set(ha_switch_p);
+    else
+      switch_p->reset(ha_switch_p);
+  }
+  switch_p->UnsubscribeRestore();
+}
+
+esp_err_t HaVirtualSwitch::RestoreExpired(HaSwitch *ha_switch_p) {
+
+  /* The current state, not a reset: a late retained state may already have
+   * been applied by mRestore(). */
+  mNotify(ha_switch_p);
+  return PublishState();
+}
+
+void HaVirtualSwitch::mNotify(HaSwitch *ha_switch_p) {
+
+  ha_switch_p->mNotify();
 }
@@ -0,0 +1,53 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file discovery_cache.h
+ *
+ * @brief Publishes Home Assistant discovery configs only when they changed.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Configs go out at QoS 1 and a hash of each one is kept in NVS with its
+ * topic once the broker acknowledged it; a config lost on the way is sent
+ * again on the next boot. Configs matching the stored hash, on the broker
+ * they were acknowledged by, are not sent again, and DiscoverySweep() clears
+ * the retained configs of entities which no longer exist.
+ *
+ */
+
+#pragma once
+
+#include "esp_err.h"
+
+/**
+ * @brief Publish a retained discovery config on the bulk lane, at QoS 1.
+ *
+ * @param force publish even if unchanged, e.g. for a Home Assistant which
+ * asked for discovery again.
+ */
+esp_err_t DiscoveryPublish(const char *topic, const char *payload, bool force);
+
+/**
+ * @brief Clear the configs stored by a previous boot which were not published
+ * on this one. Call it once every entity is connected.
+ */
+esp_err_t DiscoverySweep();
@@ -0,0 +1,81 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ha_light.h
+ *
+ * @brief ha_light Class, Home Assistant MQTT dimmable light on an LEDC channel.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Home Assistant sends one JSON command with the target brightness and the
+ * transition time; the fade runs in the LEDC hardware and only the final
+ * state is published, when the fade ends.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "driver/ledc.h"
+
+struct ha_light_config {
+  const char *name;
+  int gpio;
+  ledc_channel_t channel;
+  ledc_timer_t timer;       /* may be shared by several lights */
+};
+
+class HaLight {
+public:
+  HaLight(const ha_light_config &config);
+  ~HaLight();
+  esp_err_t Connect();
+  esp_err_t Republish(bool force);
+  static esp_err_t RepublishAll(bool force);
+  static esp_err_t RepublishNth(unsigned n);
+  bool get();
+  uint8_t brightness();
+  esp_err_t set(uint8_t brightness, uint32_t transition_ms = CONFIG_HA_LIGHT_DEFAULT_TRANSITION_MS);
+  esp_err_t turnOn(uint32_t transition_ms = CONFIG_HA_LIGHT_DEFAULT_TRANSITION_MS);
+  esp_err_t turnOff(uint32_t transition_ms = CONFIG_HA_LIGHT_DEFAULT_TRANSITION_MS);
+
+private:
+  const ha_light_config m_config;
+  const unsigned m_index;
+  bool m_configured;
+  uint8_t m_brightness;     /* target of the last command, 0 is off */
+  uint8_t m_on_brightness;  /* restored by turnOn() */
+  uint32_t m_target_duty;
+
+  HaLight *m_next;
+  static HaLight *s_m_head;
+  static unsigned s_m_count;
+
+  esp_err_t mConfigure();
+  static void mCallback(const char *data, int data_len, void *user_ctx);
+  static bool mFadeEnd(const ledc_cb_param_t *param, void *user_arg);
+  static void mTask(void *args);
+  esp_err_t PublishConfig(bool force);
+  esp_err_t PublishState();
+};
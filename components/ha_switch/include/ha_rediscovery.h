@@ -0,0 +1,57 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * @file ha_rediscovery.h
+ *
+ * @brief Republishes every entity when Home Assistant comes back online.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Home Assistant announces itself with "online" on homeassistant/status when
+ * it starts, and may have lost the retained discovery configs meanwhile. The
+ * availability, then every switch, sensor and light, then whatever the
+ * application registered are republished one per tick of
+ * CONFIG_HA_REDISCOVERY_PACE_MS, after a random delay of up to
+ * CONFIG_HA_REDISCOVERY_JITTER_MS, so a fleet of devices does not answer the
+ * same birth message at the same instant.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "esp_err.h"
+
+typedef void (*rediscovery_cb)(void *user_ctx);
+
+/**
+ * @brief Subscribe to the Home Assistant birth message.
+ *
+ * @param callback called from the timer wheel task after the entities, to
+ * republish what the application owns; may be nullptr.
+ */
+esp_err_t HaRediscoveryInit(rediscovery_cb callback, void *user_ctx);
+
+/* Start a paced republish after up to jitter_ms, restarting a running one. */
+esp_err_t HaRediscoveryStart(uint32_t jitter_ms);
+bool HaRediscoveryRunning();
@@ -0,0 +1,100 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ha_sensor.h
+ *
+ * @brief ha_sensor Class, Home Assistant MQTT Sensor with on-device filtering.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Samples are taken at a high rate from an esp_timer into a double buffer and
+ * aggregated per batch. Aggregates are only published when they moved more
+ * than the deadband since the last publish, no sooner than min_interval_ms,
+ * and at least every max_interval_ms. The published JSON carries the batch
+ * mean plus the min and max of every sample since the previous publish.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+typedef float (*sensor_read_cb)(void *user_ctx);
+
+struct ha_sensor_config {
+  const char *name;
+  const char *unit;              /* unit_of_measurement, may be nullptr */
+  const char *device_class;      /* may be nullptr */
+  uint32_t sample_period_us;
+  unsigned batch_size;           /* samples per aggregate, up to CONFIG_HA_SENSOR_MAX_BATCH */
+  float deadband;                /* minimum change of the mean to publish */
+  uint32_t min_interval_ms;
+  uint32_t max_interval_ms;      /* 0 publishes only on change */
+};
+
+class HaSensor {
+public:
+  HaSensor(const ha_sensor_config &config, sensor_read_cb read_callback, void *user_ctx = nullptr);
+  ~HaSensor();
+  esp_err_t Connect();
+  esp_err_t Republish(bool force);
+  static esp_err_t RepublishAll(bool force);
+  static esp_err_t RepublishNth(unsigned n);
+  float get();
+  unsigned overruns();
+
+private:
+  ha_sensor_config m_config;
+  const sensor_read_cb m_read_callback;
+  void *const m_user_ctx;
+  const unsigned m_index;
+  esp_timer_handle_t m_timer;
+
+/* Sampling double buffer, filled by the esp_timer task */
+  float m_samples[2][CONFIG_HA_SENSOR_MAX_BATCH];
+  std::atomic<bool> m_busy[2];
+  unsigned m_fill;
+  unsigned m_count;
+  std::atomic<unsigned> m_overruns;
+
+/* Aggregation state, owned by the sensor task */
+  bool m_published;
+  float m_last_mean;
+  int64_t m_last_publish_us;
+  unsigned m_interval_samples;
+  float m_interval_min;
+  float m_interval_max;
+
+  HaSensor *m_next;
+  static HaSensor *s_m_head;
+  static unsigned s_m_count;
+
+  static void mSample(void *user_ctx);
+  static void mTask(void *args);
+  void mProcess(unsigned buffer);
+  esp_err_t PublishConfig(bool force);
+  esp_err_t PublishState(float mean, unsigned samples);
+};
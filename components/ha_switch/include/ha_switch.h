@@ -30,11 +30,21 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include "sdkconfig.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "timer_wheel.h"
+#include "inplace_function.h"
 
 class HaSwitch;
 class HaVirtualSwitch;
-typedef void (*user_cb)(HaSwitch *user_ctx);
+/* A function pointer or a lambda capturing up to CONFIG_HA_SWITCH_CALLBACK_SIZE
+ * bytes, stored inside the switch without any allocation. */
+using user_cb = InplaceFunction<void(HaSwitch*), CONFIG_HA_SWITCH_CALLBACK_SIZE>;
+typedef void (*event_hook)(HaSwitch *switch_p);
 
 class HaSwitch {
 public:
@@ -45,9 +55,55 @@ public:
   esp_err_t set();
   esp_err_t reset();
   esp_err_t toggle();
+  esp_err_t longPress();
   esp_err_t Connect();
+  /* Publish discovery config and state again, e.g. on reconnection. force
+   * sends the config even if the discovery cache holds it. */
+  esp_err_t Republish(bool force);
+  static esp_err_t RepublishAll(bool force);
+  /* Republish the nth entity, forced, ESP_ERR_NOT_FOUND past the last one. */
+  static esp_err_t RepublishNth(unsigned n);
+
+  /**
+   * @brief Resume the state of the switches from their retained state topics,
+   * e.g. after a reboot, instead of resetting it. Restored switches notify
+   * their callbacks without publishing; those without a retained state by
+   * timeout_ms, for all together, are reset and publish it, and a retained
+   * state arriving after that still wins unless the switch changed since.
+   * Call once, after Connect(); with CONFIG_HA_SWITCH_RESTORE_STATE the
+   * state of restorable switches is not republished until then.
+   */
+  static esp_err_t RestoreAll(uint32_t timeout_ms);
+
+  /* On-device timed actions, run by the timer wheel without a round trip
+   * to Home Assistant. Starting one replaces any pending action. */
+  esp_err_t autoOff(uint32_t delay_ms);
+  esp_err_t pulse(uint32_t width_ms);
+  esp_err_t schedule(uint32_t period_ms);
+  esp_err_t cancelTimer();
+
+  unsigned index() const;
+  static HaSwitch *Find(unsigned index);
+  /* Called after the user callback whenever an entity changes state. */
+  static void SetEventHook(event_hook hook);
 
 private:
+  friend class HaVirtualSwitch;
+  const unsigned m_index;
   HaVirtualSwitch *m_switch_p;
+  timer_wheel_node m_timer;
+  enum restore_state : uint8_t {
+    RESTORE_IDLE,
+    RESTORE_PENDING,    /* RestoreAll() waits for the retained state */
+    RESTORE_LATE,       /* reset by the timeout, the next state settles it */
+  };
+  std::atomic<uint8_t> m_restore;
   static unsigned s_m_count;
+  static HaSwitch *s_m_registry[CONFIG_HA_SWITCH_MAX_ENTITIES + 1];
+  static event_hook s_m_hook;
+  static SemaphoreHandle_t s_m_restored;
+  void mNotify();
+  void mCancelRestore();
+  static void mTimerReset(void *user_ctx);
+  static void mTimerToggle(void *user_ctx);
 };
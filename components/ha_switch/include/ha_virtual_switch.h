@@ -39,18 +39,42 @@ public:
   virtual ~HaVirtualSwitch() {}
   bool get();
   esp_err_t toggle(HaSwitch *ha_switch_p);
+  /* A held button; plain switches just toggle. */
+  virtual esp_err_t longPress(HaSwitch *ha_switch_p);
   virtual esp_err_t set(HaSwitch *ha_switch_p) = 0;
   virtual esp_err_t reset(HaSwitch *ha_switch_p) = 0;
   virtual esp_err_t Connect(HaSwitch *ha_switch_p) = 0;
+  /* force sends the config even if the discovery cache holds it. */
+  virtual esp_err_t Republish(bool force) = 0;
+  esp_err_t RepublishConfig(bool force) { return PublishConfig(force); }
+  /* Entities whose state is retained on the broker and can be restored. */
+  virtual bool restorable() const { return false; }
+  esp_err_t SubscribeRestore(HaSwitch *ha_switch_p);
+  esp_err_t UnsubscribeRestore();
+  /* No retained state came in time: notify and publish the current state. */
+  esp_err_t RestoreExpired(HaSwitch *ha_switch_p);
 
 protected:
   bool m_state;
   const unsigned m_index;
   virtual esp_err_t PublishState() = 0;
+  virtual esp_err_t PublishConfig(bool force) = 0;
+  /* Format of the topic the entity takes commands on, s_t_action or s_t_state. */
+  virtual const char *commandTopic() const = 0;
+  esp_err_t SubscribeCommand(HaSwitch *ha_switch_p);
   static void mCallback(const char *data, int data_len, void *user_ctx);
+  static void mRoute(const char *topic, int topic_len, const char *data, int data_len,
+                     void *user_ctx);
+  static void mNotify(HaSwitch *ha_switch_p);
+  static void mRestore(const char *data, int data_len, void *user_ctx);
+  int StateTopic(char *buffer, int size) const;
   static const char *s_t_action;
   static const char *s_t_state;
   static const char *s_on;
   static const char *s_off;
   static const char *s_press;
+
+private:
+  static bool s_m_action_routed;
+  static bool s_m_state_routed;
 };
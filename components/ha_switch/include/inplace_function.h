@@ -0,0 +1,140 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file inplace_function.h
+ *
+ * @brief InplaceFunction, a std::function like callable which never allocates.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * The callable is stored in a fixed buffer inside the object; one that does
+ * not fit is a compile error instead of a heap fallback. Invoking it costs an
+ * indirect call, like a function pointer with a context.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 2 * sizeof(void*)>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+  InplaceFunction() noexcept : m_ops(nullptr) {}
+  InplaceFunction(std::nullptr_t) noexcept : m_ops(nullptr) {}
+
+  template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction>>>
+  InplaceFunction(F &&callable) : m_ops(nullptr) {
+
+    using Stored = std::decay_t<F>;
+    static_assert(std::is_invocable_r_v<R, Stored&, Args...>, "callable has the wrong signature");
+    static_assert(sizeof(Stored) <= Capacity, "callable too large, increase the capacity");
+    static_assert(alignof(Stored) <= alignof(std::max_align_t), "callable over aligned");
+
+    /* A null function pointer makes an empty InplaceFunction, like std::function. */
+    if constexpr (std::is_pointer_v<std::remove_reference_t<F>> ||
+                  std::is_member_pointer_v<std::remove_reference_t<F>>) {
+      if (!callable)
+        return;
+    }
+    new (m_storage) Stored(std::forward<F>(callable));
+    m_ops = &s_m_ops<Stored>;
+  }
+
+  InplaceFunction(const InplaceFunction &other) : m_ops(other.m_ops) {
+
+    if (m_ops)
+      m_ops->copy(m_storage, other.m_storage);
+  }
+
+  InplaceFunction(InplaceFunction &&other) noexcept : m_ops(other.m_ops) {
+
+    if (m_ops)
+      m_ops->move(m_storage, other.m_storage);
+  }
+
+  InplaceFunction &operator=(const InplaceFunction &other) {
+
+    if (this != &other) {
+      reset();
+      if (other.m_ops)
+        other.m_ops->copy(m_storage, other.m_storage);
+      m_ops = other.m_ops;
+    }
+    return *this;
+  }
+
+  InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+
+    if (this != &other) {
+      reset();
+      if (other.m_ops)
+        other.m_ops->move(m_storage, other.m_storage);
+      m_ops = other.m_ops;
+    }
+    return *this;
+  }
+
+  ~InplaceFunction() { reset(); }
+
+  explicit operator bool() const noexcept { return m_ops; }
+
+  R operator()(Args... args) const {
+
+    return m_ops->invoke(const_cast<unsigned char*>(m_storage), std::forward<Args>(args)...);
+  }
+
+private:
+  struct ops {
+    R (*invoke)(void *storage, Args&&... args);
+    void (*copy)(void *to, const void *from);
+    void (*move)(void *to, void *from);
+    void (*destroy)(void *storage);
+  };
+
+  template <typename Stored>
+  static constexpr ops s_m_ops = {
+    [](void *storage, Args&&... args) -> R {
+      return std::invoke(*static_cast<Stored*>(storage), std::forward<Args>(args)...);
+    },
+    [](void *to, const void *from) { new (to) Stored(*static_cast<const Stored*>(from)); },
+    [](void *to, void *from) { new (to) Stored(std::move(*static_cast<Stored*>(from))); },
+    [](void *storage) { static_cast<Stored*>(storage)->~Stored(); },
+  };
+
+  void reset() {
+
+    if (m_ops)
+      m_ops->destroy(m_storage);
+    m_ops = nullptr;
+  }
+
+  const ops *m_ops;
+  alignas(std::max_align_t) unsigned char m_storage[Capacity];
+};
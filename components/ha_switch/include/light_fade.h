@@ -0,0 +1,130 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file light_fade.h
+ *
+ * @brief Brightness to PWM duty mapping and fade planning for HaLight.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Plain integer math without ESP-IDF dependencies, so it can be compiled and
+ * checked on the host.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace light_fade {
+
+constexpr uint8_t c_brightness_max = 255;
+
+constexpr uint32_t DutyMax(unsigned resolution_bits) {
+
+  return (1UL << resolution_bits) - 1;
+}
+
+/*
+ * @brief Perceptual brightness to duty, following the CIE 1976 lightness
+ * curve so that equal brightness steps look like equal steps to the eye.
+ * Y = L / 903.3 below L = 8, ((L + 16) / 116)^3 above, with L = 100 * b / 255.
+ */
+constexpr uint32_t BrightnessToDuty(uint8_t brightness, unsigned resolution_bits) {
+
+  const uint64_t max = DutyMax(resolution_bits);
+  if (!brightness)
+    return 0;
+  if (brightness == c_brightness_max)
+    return max;
+
+  /* L scaled by 255: L * 255 = 100 * b. L = 8 is b = 20.4. */
+  const uint64_t l255 = 100ULL * brightness;
+  if (l255 <= 8ULL * 255) {
+    /* Y = l255 / (255 * 903.3), rounded, at least 1 so "on" is never dark */
+    uint64_t duty = (l255 * max * 10 + 255 * 9033 / 2) / (255ULL * 9033);
+    return duty ? duty : 1;
+  }
+  /* (L + 16) / 116 = (l255 + 16 * 255) / (116 * 255) */
+  const uint64_t num = l255 + 16ULL * 255;
+  const uint64_t den = 116ULL * 255;
+  return (num * num * num * max + den * den * den / 2) / (den * den * den);
+}
+
+/*
+ * @brief Inverse of BrightnessToDuty(): the largest brightness whose duty does
+ * not exceed duty. Used to report where an interrupted fade stopped.
+ */
+constexpr uint8_t DutyToBrightness(uint32_t duty, unsigned resolution_bits) {
+
+  unsigned low = 0, high = c_brightness_max;
+  while (low < high) {
+    unsigned mid = (low + high + 1) / 2;
+    if (BrightnessToDuty(mid, resolution_bits) <= duty)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+  return low;
+}
+
+/*
+ * @brief Duty at elapsed_ms into a linear fade, for software fallback and to
+ * estimate the progress of a hardware fade.
+ */
+constexpr uint32_t FadeDuty(uint32_t from, uint32_t to, uint32_t elapsed_ms, uint32_t total_ms) {
+
+  if (!total_ms || elapsed_ms >= total_ms)
+    return to;
+  if (to >= from)
+    return from + (uint64_t)(to - from) * elapsed_ms / total_ms;
+  return from - (uint64_t)(from - to) * elapsed_ms / total_ms;
+}
+
+/* Longest the LEDC fade can hold one duty step, in PWM periods. */
+constexpr uint32_t c_max_cycles_per_step = 1023;
+
+/*
+ * @brief Fade time actually used for a requested transition: capped to
+ * max_ms, and to what the hardware can stretch the duty difference over.
+ */
+constexpr uint32_t FadeTime(uint32_t from, uint32_t to, uint32_t transition_ms,
+                            uint32_t pwm_freq_hz, uint32_t max_ms) {
+
+  if (transition_ms > max_ms)
+    transition_ms = max_ms;
+  const uint64_t steps = to > from ? to - from : from - to;
+  if (!steps || !pwm_freq_hz)
+    return 0;
+  const uint64_t slowest_ms = steps * c_max_cycles_per_step * 1000 / pwm_freq_hz;
+  return transition_ms < slowest_ms ? transition_ms : slowest_ms;
+}
+
+static_assert(BrightnessToDuty(0, 13) == 0);
+static_assert(BrightnessToDuty(255, 13) == DutyMax(13));
+static_assert(BrightnessToDuty(1, 13) >= 1);
+static_assert(DutyToBrightness(BrightnessToDuty(128, 13), 13) == 128);
+static_assert(FadeDuty(0, 100, 50, 100) == 50);
+static_assert(FadeDuty(100, 0, 25, 100) == 75);
+static_assert(FadeTime(0, 1, 5000, 5000, 10000) == 204);
+
+} // namespace light_fade
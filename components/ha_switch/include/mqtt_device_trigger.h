@@ -30,16 +30,29 @@
 
 #pragma once
 
+#include <atomic>
+#include "timer_wheel.h"
 #include "ha_virtual_switch.h"
 
+/* Presses are counted and published as one event per burst, see
+ * CONFIG_HA_TRIGGER_BURST_WINDOW_MS. */
 class MqttDeviceTrigger : public HaVirtualSwitch {
 public:
-  MqttDeviceTrigger(unsigned index) : HaVirtualSwitch(index) {}
-  ~MqttDeviceTrigger() override {}
+  MqttDeviceTrigger(unsigned index) : HaVirtualSwitch(index), m_presses(0), m_burst{} {}
+  ~MqttDeviceTrigger() override;
   esp_err_t set(HaSwitch *ha_switch_p) override;
   esp_err_t reset(HaSwitch *ha_switch_p) override;
+  esp_err_t longPress(HaSwitch *ha_switch_p) override;
   esp_err_t Connect(HaSwitch *ha_switch_p) override;
+  esp_err_t Republish(bool force) override;
 
 private:
+  std::atomic<unsigned> m_presses;
+  timer_wheel_node m_burst;
   esp_err_t PublishState() override;
+  esp_err_t PublishConfig(bool force) override;
+  const char *commandTopic() const override;
+  esp_err_t PublishEvent(unsigned type);
+  esp_err_t FlushBurst();
+  static void mBurstEnd(void *user_ctx);
 };
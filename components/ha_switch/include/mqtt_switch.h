@@ -39,7 +39,12 @@ public:
   esp_err_t set(HaSwitch *ha_switch_p) override;
   esp_err_t reset(HaSwitch *ha_switch_p) override;
   esp_err_t Connect(HaSwitch *ha_switch_p) override;
+  esp_err_t Republish(bool force) override;
+  bool restorable() const override { return true; }
 
 private:
   esp_err_t PublishState() override;
+  esp_err_t PublishConfig(bool force) override;
+  const char *commandTopic() const override;
+  static void mPublished(esp_err_t result, void *user_ctx);
 };
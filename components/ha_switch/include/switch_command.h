@@ -0,0 +1,54 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file switch_command.h
+ *
+ * @brief Parser for the command payloads switches receive.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Payloads are recognised in place in the received buffer, which is not NUL
+ * terminated, against a table of the accepted commands: ON, OFF, TOGGLE and
+ * the payload_on/payload_off announced in the discovery config, plain or as
+ * {"state":"..."}. Matches are exact, so "O" or "ONN" are not commands.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+enum switch_command : uint8_t {
+  SWITCH_COMMAND_NONE,    /* Not a command, ignored */
+  SWITCH_COMMAND_ON,
+  SWITCH_COMMAND_OFF,
+  SWITCH_COMMAND_TOGGLE,
+};
+
+/**
+ * @brief Recognise a command payload.
+ *
+ * @param data received payload, need not be NUL terminated.
+ * @param data_len bytes in data.
+ * @return the command, SWITCH_COMMAND_NONE for anything else.
+ */
+switch_command SwitchCommandParse(const char *data, int data_len);
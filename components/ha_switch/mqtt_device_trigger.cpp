@@ -30,64 +30,143 @@
 
 #include <cstring>
 #include "mqtt_manager.h"
+#include "discovery_cache.h"
+#include "trace.h"
 #include "mqtt_device_trigger.h"
 
 static const char *s_t_config  = "homeassistant/device_automation/franzininho-wifi/%s/config";
-static const char *s_config_trigger = "{\"name\":\"Franzininho-WiFi %s\",\"availability_topic\":\"franzininho-wifi/status\",\"topic\":\"franzininho-wifi/%s/action\",\"device\":{\"name\":\"franzininho-wifi\",\"identifiers\":[\"615830010\"]},\"platform\":\"device_automation\",\"automation_type\":\"trigger\",\"type\":\"button_short_press\",\"subtype\":\"button_%u\",\"payload\":\"%s\"}";
+static const char *s_config_trigger = "{\"name\":\"Franzininho-WiFi %s\",\"availability_topic\":\"franzininho-wifi/status\",\"topic\":\"franzininho-wifi/%s/action\",\"device\":{\"name\":\"franzininho-wifi\",\"identifiers\":[\"615830010\"]},\"platform\":\"device_automation\",\"automation_type\":\"trigger\",\"type\":\"%s\",\"subtype\":\"button_%u\",\"payload\":\"%s\"}";
+
+/* One discovery config per event, all on the action topic. The short press
+ * keeps the config topic and payload of the single press trigger. */
+struct press_event {
+  const char *suffix;
+  const char *type;
+  const char *payload;
+};
+
+static const press_event s_events[] = {
+  { "",           "button_short_press",     "PRESS" },
+  { "_double",    "button_double_press",    "DOUBLE" },
+  { "_triple",    "button_triple_press",    "TRIPLE" },
+  { "_quadruple", "button_quadruple_press", "QUADRUPLE" },
+  { "_quintuple", "button_quintuple_press", "QUINTUPLE" },
+  { "_long",      "button_long_press",      "LONG" },
+};
+
+/* Events 0 to c_max_presses - 1 are bursts of 1 to c_max_presses presses;
+ * longer bursts count as the last one. */
+constexpr unsigned c_max_presses {5};
+constexpr unsigned c_long_press  {5};
+
+MqttDeviceTrigger::~MqttDeviceTrigger() {
+
+  TimerWheelCancel(&m_burst);
+}
 
 esp_err_t MqttDeviceTrigger::Connect(HaSwitch *ha_switch_p) {
 
-  constexpr int config_size   = 400;
-  constexpr int state_size    =  30;
+  esp_err_t rc;
+  if ((rc = SubscribeCommand(ha_switch_p)))
+    return rc;
+
+  return rc = PublishConfig(false);
+}
+
+const char *MqttDeviceTrigger::commandTopic() const {
+
+  return s_t_state;
+}
+
+esp_err_t MqttDeviceTrigger::Republish(bool force) {
+
+  return PublishConfig(force);
+}
+
+esp_err_t MqttDeviceTrigger::PublishConfig(bool force) {
+
+  constexpr int config_size   = 450;
   constexpr int instance_size =   8;
+  constexpr int name_size     =  20;
 
-  esp_err_t rc;
   char config_buffer[config_size];
-  char state_buffer[state_size];
   char instance[instance_size];
+  char name[name_size];
+  esp_err_t rc = ESP_OK;
 
   snprintf(instance, instance_size, "s_%u", m_index);
 
-  int temp, offset, newsize;
-
-  temp = snprintf(config_buffer, config_size, s_t_config, instance);
-  if (temp > config_size || temp < 0)
-    return ESP_FAIL;
+  for (unsigned i = 0; i < sizeof(s_events) / sizeof(s_events[0]); i++) {
+    /* Without a burst window presses are never counted. */
+    if (!CONFIG_HA_TRIGGER_BURST_WINDOW_MS && i && i < c_max_presses)
+      continue;
 
-  offset = temp + 1;
-  newsize = config_size - offset;
-  temp = snprintf(config_buffer + offset, newsize, s_config_trigger, instance, instance, m_index, s_press);
-  if (temp > newsize || temp < 0)
-      return ESP_FAIL;
+    snprintf(name, name_size, "%s%s", instance, s_events[i].suffix);
 
-  temp = snprintf(state_buffer, state_size, s_t_state, instance);
-  if (temp > state_size || temp < 0)
-    return ESP_FAIL;
+    int temp, offset, newsize;
 
-  if ((rc = MqttSubscribe(state_buffer, 0, mCallback, ha_switch_p)))
-    return rc;
+    temp = snprintf(config_buffer, config_size, s_t_config, name);
+    if (temp > config_size || temp < 0)
+      return ESP_FAIL;
 
-  return rc = MqttPublish(config_buffer, config_buffer+offset, 0, 0, 1);
+    offset = temp + 1;
+    newsize = config_size - offset;
+    temp = snprintf(config_buffer + offset, newsize, s_config_trigger, name, instance,
+                    s_events[i].type, m_index, s_events[i].payload);
+    if (temp > newsize || temp < 0)
+        return ESP_FAIL;
+
+    if (DiscoveryPublish(config_buffer, config_buffer+offset, force))
+      rc = ESP_FAIL;
+  }
+  return rc;
 }
 
 esp_err_t MqttDeviceTrigger::set(HaSwitch* ha_switch_p) {
 
   m_state = true;
-  if (ha_switch_p->m_user_callback)
-    ha_switch_p->m_user_callback(ha_switch_p);
+  mNotify(ha_switch_p);
   return ESP_OK;
 }
 
 esp_err_t MqttDeviceTrigger::reset(HaSwitch* ha_switch_p) {
 
   m_state = false;
-  if (ha_switch_p->m_user_callback)
-    ha_switch_p->m_user_callback(ha_switch_p);
+  mNotify(ha_switch_p);
   return ESP_OK;
 }
 
+esp_err_t MqttDeviceTrigger::longPress(HaSwitch* ha_switch_p) {
+
+  /* Presses before the hold are published first, in order. */
+  TimerWheelCancel(&m_burst);
+  FlushBurst();
+  mNotify(ha_switch_p);
+  return PublishEvent(c_long_press);
+}
+
 esp_err_t MqttDeviceTrigger::PublishState() {
 
+  if (!CONFIG_HA_TRIGGER_BURST_WINDOW_MS)
+    return PublishEvent(0);
+
+  /* Each press restarts the window, the burst is published once it expires. */
+  m_presses++;
+  if (TimerWheelStart(&m_burst, CONFIG_HA_TRIGGER_BURST_WINDOW_MS, 0, mBurstEnd, this))
+    return FlushBurst();
+  return ESP_OK;
+}
+
+esp_err_t MqttDeviceTrigger::FlushBurst() {
+
+  unsigned presses = m_presses.exchange(0);
+  if (!presses)
+    return ESP_OK;
+  return PublishEvent((presses < c_max_presses ? presses : c_max_presses) - 1);
+}
+
+esp_err_t MqttDeviceTrigger::PublishEvent(unsigned event) {
+
   constexpr int topic_size    =  30;
   constexpr int instance_size =   8;
 
@@ -99,5 +178,13 @@ esp_err_t MqttDeviceTrigger::PublishState() {
   if (temp > topic_size || temp < 0)
     return ESP_FAIL;
 
-  return MqttPublish(topic_buffer, s_press, 0, 0, 0);
+  TRACE_BEGIN(SWITCH_PUBLISH, m_index);
+  esp_err_t rc = MqttPublish(topic_buffer, s_events[event].payload, 0, 0, 0);
+  TRACE_END(SWITCH_PUBLISH, m_index);
+  return rc;
+}
+
+void MqttDeviceTrigger::mBurstEnd(void *user_ctx) {
+
+  ((MqttDeviceTrigger*) user_ctx)->FlushBurst();
 }
@@ -29,21 +29,44 @@
  */
 
 #include <cstring>
+#include "esp_log.h"
 #include "mqtt_manager.h"
+#include "discovery_cache.h"
+#include "trace.h"
 #include "mqtt_switch.h"
 
+static const char *s_TAG = "HA_SWITCH";
 static const char *s_t_config  = "homeassistant/switch/franzininho-wifi/%s/config";
-static const char *s_config_switch  = "{\"name\":\"Franzininho-WiFi %s\",\"availability_topic\":\"franzininho-wifi/status\",\"command_topic\":\"franzininho-wifi/%s/action\",\"device\":{\"name\":\"franzininho-wifi\",\"identifiers\":[\"615830010\"]},\"platform\":\"switch\",\"state_topic\":\"franzininho-wifi/%s/state\"}";
+static const char *s_config_switch  = "{\"name\":\"Franzininho-WiFi %s\",\"availability_topic\":\"franzininho-wifi/status\",\"command_topic\":\"franzininho-wifi/%s/action\",\"payload_on\":\"%s\",\"payload_off\":\"%s\",\"device\":{\"name\":\"franzininho-wifi\",\"identifiers\":[\"615830010\"]},\"platform\":\"switch\",\"state_on\":\"ON\",\"state_off\":\"OFF\",\"state_topic\":\"franzininho-wifi/%s/state\"}";
 
 esp_err_t MqttSwitch::Connect(HaSwitch *ha_switch_p) {
 
-  constexpr int config_size   = 400;
-  constexpr int action_size   =  30;
-  constexpr int instance_size =   8;
+  esp_err_t rc;
+  if ((rc = SubscribeCommand(ha_switch_p)))
+    return rc;
+
+  return rc = PublishConfig(false);
+}
+
+const char *MqttSwitch::commandTopic() const {
+
+  return s_t_action;
+}
+
+esp_err_t MqttSwitch::Republish(bool force) {
 
   esp_err_t rc;
+  if ((rc = PublishConfig(force)))
+    return rc;
+  return rc = PublishState();
+}
+
+esp_err_t MqttSwitch::PublishConfig(bool force) {
+
+  constexpr int config_size   = 480;
+  constexpr int instance_size =   8;
+
   char config_buffer[config_size];
-  char action_buffer[action_size];
   char instance[instance_size];
 
   snprintf(instance, instance_size, "s_%u", m_index);
@@ -56,34 +79,25 @@ esp_err_t MqttSwitch::Connect(HaSwitch *ha_switch_p) {
 
   offset = temp + 1;
   newsize = config_size - offset;
-  temp = snprintf(config_buffer + offset, newsize, s_config_switch, instance, instance, instance);
+  temp = snprintf(config_buffer + offset, newsize, s_config_switch, instance, instance,
+                  CONFIG_HA_SWITCH_PAYLOAD_ON, CONFIG_HA_SWITCH_PAYLOAD_OFF, instance);
   if (temp > newsize || temp < 0)
       return ESP_FAIL;
 
-  temp = snprintf(action_buffer, action_size, s_t_action, instance);
-  if (temp > action_size || temp < 0)
-    return ESP_FAIL;
-
-
-  if ((rc = MqttSubscribe(action_buffer, 0, mCallback, ha_switch_p)))
-    return rc;
-
-  return rc = MqttPublish(config_buffer, config_buffer+offset, 0, 0, 1);
+  return DiscoveryPublish(config_buffer, config_buffer+offset, force);
 }
 
 esp_err_t MqttSwitch::set(HaSwitch *ha_switch_p) {
 
   m_state = true;
-  if (ha_switch_p->m_user_callback)
-    ha_switch_p->m_user_callback(ha_switch_p);
+  mNotify(ha_switch_p);
   return PublishState();
 }
 
 esp_err_t MqttSwitch::reset(HaSwitch *ha_switch_p) {
 
   m_state = false;
-  if (ha_switch_p->m_user_callback)
-    ha_switch_p->m_user_callback(ha_switch_p);
+  mNotify(ha_switch_p);
   return PublishState();
 }
 
@@ -106,5 +120,27 @@ esp_err_t MqttSwitch::PublishState() {
   else
     state = s_off;
 
-  return MqttPublish(topic_buffer, state, 0, 0, 1);
+  TRACE_BEGIN(SWITCH_PUBLISH, m_index);
+#ifdef CONFIG_HA_SWITCH_STATE_QOS1
+  /* Several updates may be in flight; with a full window this blocks until
+   * the broker catches up, except on the MQTT task, which gets ESP_ERR_TIMEOUT
+   * at once. The state still goes out then, only without the ack report. */
+  esp_err_t rc = MqttPublishAsync(topic_buffer, state, 0, 1, 1, CONFIG_HA_SWITCH_PUBLISH_TIMEOUT_MS,
+                                  mPublished, (void*)(uintptr_t) m_index);
+  if (rc == ESP_ERR_TIMEOUT)
+    rc = MqttPublish(topic_buffer, state, 0, 1, 1);
+#else
+  esp_err_t rc = MqttPublish(topic_buffer, state, 0, 0, 1);
+#endif
+  TRACE_END(SWITCH_PUBLISH, m_index);
+  return rc;
+}
+
+void MqttSwitch::mPublished(esp_err_t result, void *user_ctx) {
+
+  /* The state is retained and republished on every connection, so a lost
+   * update is corrected there; just report it. */
+  if (result)
+    ESP_LOGW(s_TAG, "State of s_%u not acknowledged: %s", (unsigned)(uintptr_t) user_ctx,
+             esp_err_to_name(result));
 }
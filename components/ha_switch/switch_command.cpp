@@ -0,0 +1,111 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file switch_command.cpp
+ *
+ * @brief Switch command parser implementation.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cstring>
+#include "sdkconfig.h"
+#include "switch_command.h"
+
+struct command_entry {
+  const char *payload;
+  uint8_t len;
+  switch_command command;
+};
+
+#define COMMAND_ENTRY(payload, command) { payload, sizeof(payload) - 1, command }
+
+/* The length is compared first, so most payloads which are no command are
+ * rejected without reading them. Empty custom payloads never match. */
+static const command_entry s_commands[] = {
+  COMMAND_ENTRY("ON", SWITCH_COMMAND_ON),
+  COMMAND_ENTRY("OFF", SWITCH_COMMAND_OFF),
+  COMMAND_ENTRY("TOGGLE", SWITCH_COMMAND_TOGGLE),
+  COMMAND_ENTRY(CONFIG_HA_SWITCH_PAYLOAD_ON, SWITCH_COMMAND_ON),
+  COMMAND_ENTRY(CONFIG_HA_SWITCH_PAYLOAD_OFF, SWITCH_COMMAND_OFF),
+};
+
+static constexpr char s_state_key[] = "\"state\"";
+
+/*
+ * @brief Match data against the command table.
+ */
+static switch_command s_Match(const char *data, int data_len) {
+
+  for (const command_entry &entry : s_commands) {
+    if (entry.len && entry.len == data_len && !memcmp(entry.payload, data, data_len))
+      return entry.command;
+  }
+  return SWITCH_COMMAND_NONE;
+}
+
+static const char *s_SkipSpace(const char *p, const char *end) {
+
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    p++;
+  return p;
+}
+
+/*
+ * @brief Find the string value of "state" in a JSON object, in place.
+ *
+ * @return the command it holds, SWITCH_COMMAND_NONE without one.
+ */
+static switch_command s_MatchJson(const char *data, int data_len) {
+
+  constexpr int key_len = sizeof(s_state_key) - 1;
+  const char *end = data + data_len;
+
+  for (const char *p = data; p + key_len <= end; p++) {
+    if (*p != '"' || memcmp(p, s_state_key, key_len))
+      continue;
+    p = s_SkipSpace(p + key_len, end);
+    if (p == end || *p != ':')
+      continue;
+    p = s_SkipSpace(p + 1, end);
+    if (p == end || *p != '"')
+      return SWITCH_COMMAND_NONE;
+    const char *value = ++p;
+    while (p < end && *p != '"')
+      p++;
+    if (p == end)
+      return SWITCH_COMMAND_NONE;
+    return s_Match(value, p - value);
+  }
+  return SWITCH_COMMAND_NONE;
+}
+
+switch_command SwitchCommandParse(const char *data, int data_len) {
+
+  if (!data || data_len <= 0)
+    return SWITCH_COMMAND_NONE;
+  const char *p = s_SkipSpace(data, data + data_len);
+  if (p < data + data_len && *p == '{')
+    return s_MatchJson(p, data + data_len - p);
+  return s_Match(data, data_len);
+}
@@ -33,6 +33,9 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -40,12 +43,205 @@ extern "C" {
 #endif
 
 typedef void (*mqtt_subscription_cb)(const char *data, int data_len, void *user_ctx);
+/* For topic filters: topic is the one matched, not NUL terminated. */
+typedef void (*mqtt_topic_cb)(const char *topic, int topic_len, const char *data, int data_len,
+                              void *user_ctx);
+/* For messages larger than the client buffer, which arrive in parts and in
+ * order: data goes at offset in the whole message of total_len bytes. */
+typedef void (*mqtt_fragment_cb)(const char *data, int data_len, int offset, int total_len,
+                                 void *user_ctx);
+
+/* Alignment of the context copied by MqttSubscribeCtx() */
+#define MQTT_SUB_CTX_ALIGN (8)
+
+typedef void (*mqtt_connected_cb)(void *user_ctx);
+
+/* result is ESP_OK once acknowledged, ESP_ERR_TIMEOUT past the deadline and
+ * ESP_FAIL if the message was dropped or left behind on a failed broker. */
+typedef void (*mqtt_publish_cb)(esp_err_t result, void *user_ctx);
+
+typedef struct {
+  unsigned active_broker;       /* index: 0 primary, then fallbacks in order */
+  unsigned failovers;           /* switches to a different broker */
+  uint32_t last_failover_ms;    /* disconnect to resubscribed on the new broker */
+  uint32_t max_failover_ms;
+  uint32_t last_outage_ms;      /* last disconnect to reconnect, any broker */
+} mqtt_failover_stats;
+
+typedef struct {
+  unsigned connects;            /* successful connections, any broker */
+  uint32_t last_connect_ms;     /* connection attempt to CONNACK: TCP, TLS handshake, CONNECT */
+  uint32_t min_connect_ms;
+  uint32_t max_connect_ms;
+  uint32_t avg_connect_ms;
+} mqtt_connect_stats;
+
+typedef struct {
+  const char *key;
+  const char *value;
+} mqtt_user_property;
+
+typedef struct {
+  unsigned in_flight;           /* QoS 1/2 publishes waiting for their acknowledgement */
+  unsigned max_in_flight;
+  unsigned acked;
+  unsigned timed_out;
+  unsigned failed;
+  unsigned window_full;         /* MqttPublishAsync() calls which timed out on the window */
+} mqtt_publish_stats;
+
+typedef struct {
+  unsigned used;                /* subscription pool entries in use */
+  unsigned max_used;
+  unsigned size;                /* CONFIG_MQTT_MAX_SUBSCRIPTIONS */
+} mqtt_subscription_stats;
+
+/* Probe outcomes the link statistics are computed over */
+#define MQTT_LINK_SAMPLES (32)
+
+typedef struct {
+  uint32_t last_rtt_ms;         /* probe published to its echo back from the broker */
+  uint32_t p50_rtt_ms;          /* over the probes answered of the last MQTT_LINK_SAMPLES */
+  uint32_t p90_rtt_ms;
+  uint32_t p99_rtt_ms;
+  unsigned loss_pct;            /* of the last MQTT_LINK_SAMPLES probes */
+  unsigned probes;              /* sent since boot */
+  unsigned lost;
+  unsigned half_open;           /* connections dropped for CONFIG_MQTT_PROBE_MAX_LOST lost probes */
+  uint32_t keepalive_s;         /* asked for on the next connection */
+  uint32_t reconnect_ms;        /* delay before the next reconnection attempt */
+} mqtt_link_stats;
+
+/* Interactive publishes go out immediately. Bulk (discovery) and diagnostic
+ * publishes are queued and sent within their share of CONFIG_MQTT_LANE_BANDWIDTH. */
+typedef enum {
+  MQTT_LANE_INTERACTIVE,
+  MQTT_LANE_BULK,
+  MQTT_LANE_DIAG,
+  MQTT_NUM_LANES
+} mqtt_lane;
+
+typedef struct {
+  unsigned depth;               /* messages queued now */
+  unsigned max_depth;
+  unsigned sent;
+  unsigned dropped;             /* lane queue full */
+  unsigned failed;              /* refused by the client while connected */
+  uint64_t bytes;               /* payload bytes sent */
+} mqtt_lane_stats;
+
+/* MQTT 5 publish properties, only accepted with CONFIG_MQTT_MANAGER_PROTOCOL_V5. */
+typedef struct {
+  uint32_t message_expiry_interval;   /* seconds, 0 means no expiry */
+  const mqtt_user_property *user_properties;
+  unsigned num_user_properties;       /* up to 8 */
+} mqtt_publish_props;
 
 esp_err_t MqttInit(void);
 esp_err_t MqttPublish(const char *topic, const char *message, int len, int qos, int retain);
+esp_err_t MqttPublishEx(const char *topic, const char *message, int len, int qos, int retain,
+                        const mqtt_publish_props *props);
+
+/* Publish on a priority lane. Queued lanes copy topic and message and return
+ * ESP_ERR_NO_MEM when full; MqttPublish() is the interactive lane. */
+esp_err_t MqttPublishLane(mqtt_lane lane, const char *topic, const char *message, int len,
+                          int qos, int retain);
+
+/* MqttPublishLane() with the callback of MqttPublishAsync(), called once the
+ * queued message is acknowledged, or with ESP_FAIL if the client refuses it.
+ * Never called if the message could not be queued. */
+esp_err_t MqttPublishLaneAsync(mqtt_lane lane, const char *topic, const char *message, int len,
+                               int qos, int retain, uint32_t timeout_ms, mqtt_publish_cb callback,
+                               void *user_ctx);
+
+/**
+ * @brief Publish and get called back when the broker acknowledges it.
+ *
+ * At most CONFIG_MQTT_INFLIGHT_WINDOW QoS 1/2 publishes are in flight; with a
+ * full window the call blocks until a slot frees up, which is the caller's
+ * backpressure. Called from the MQTT task, e.g. a subscription callback, or
+ * from the connected callback it never blocks and returns ESP_ERR_TIMEOUT at
+ * once instead. QoS 0 publishes complete as soon as they are handed over.
+ *
+ * @param timeout_ms bounds both the wait for a window slot and the wait for
+ * the acknowledgement.
+ * @param callback called from the MQTT task, the ack timer task or the
+ * caller, exactly once if the call returns ESP_OK and never otherwise.
+ */
+esp_err_t MqttPublishAsync(const char *topic, const char *message, int len, int qos, int retain,
+                           uint32_t timeout_ms, mqtt_publish_cb callback, void *user_ctx);
+
+/* Blocking MqttPublishAsync(), returns the callback's result.
+ * ESP_ERR_INVALID_STATE from the MQTT task or the connected callback. */
+esp_err_t MqttPublishWait(const char *topic, const char *message, int len, int qos, int retain,
+                          uint32_t timeout_ms);
 esp_err_t MqttSubscribe(const char *topic, int qos, mqtt_subscription_cb callback, void *user_ctx);
+
+/* Like MqttSubscribe(), but ctx_size bytes of ctx are copied into the
+ * subscription and the callback gets a pointer to that copy, so no context
+ * has to be kept alive or allocated by the caller. */
+esp_err_t MqttSubscribeCtx(const char *topic, int qos, mqtt_subscription_cb callback,
+                           const void *ctx, size_t ctx_size);
+
+/**
+ * @brief Subscribe to a topic filter with + and # wildcards, e.g. one filter
+ * for the commands of every entity; the callback is told which topic matched.
+ * With MQTT 5 the subscription is no local: the broker does not send back the
+ * device's own publishes which match the filter.
+ */
+esp_err_t MqttSubscribeFilter(const char *filter, int qos, mqtt_topic_cb callback, void *user_ctx);
+
+/* Like MqttSubscribe(), but retained messages, which the broker sends again on
+ * every (re)subscription, are not delivered: only what is published while
+ * subscribed. */
+esp_err_t MqttSubscribeLive(const char *topic, int qos, mqtt_subscription_cb callback,
+                            void *user_ctx);
+
+/* Like MqttSubscribe(), for messages which may not fit the client buffer: the
+ * callback gets every part of them. The other subscribe calls only get
+ * messages which arrived whole, larger ones are dropped. */
+esp_err_t MqttSubscribeFragments(const char *topic, int qos, mqtt_fragment_cb callback,
+                                 void *user_ctx);
+
+/* Drop a subscription made with any of the calls above, freeing its pool
+ * entry; the broker is told once no other entry has the same topic. A message
+ * already being dispatched may still reach the callback after it returns. */
 esp_err_t MqttUnsubscribe(const char *topic);
+esp_err_t MqttWaitConnected(uint32_t timeout_ms);
+
+/* Called from the manager's control task on every (re)connection, after
+ * subscriptions have been renewed on the active broker. Use it to republish
+ * retained state; failover waits for it to return. */
+esp_err_t MqttSetConnectedCallback(mqtt_connected_cb callback, void *user_ctx);
+esp_err_t MqttGetFailoverStats(mqtt_failover_stats *stats);
+esp_err_t MqttGetConnectStats(mqtt_connect_stats *stats);
+esp_err_t MqttGetPublishStats(mqtt_publish_stats *stats);
+esp_err_t MqttGetLaneStats(mqtt_lane lane, mqtt_lane_stats *stats);
+esp_err_t MqttGetSubscriptionStats(mqtt_subscription_stats *stats);
+
+/* ESP_ERR_NOT_SUPPORTED without CONFIG_MQTT_LINK_PROBE. */
+esp_err_t MqttGetLinkStats(mqtt_link_stats *stats);
 
 #ifdef __cplusplus
 } // extern "C"
+
+#include <type_traits>
+
+/**
+ * @brief Subscribe with a callable taking (const char *data, int data_len),
+ * e.g. a lambda. Its captures are copied into the subscription pool, so they
+ * must be trivially copyable and fit in CONFIG_MQTT_SUB_CTX_SIZE bytes.
+ */
+template <typename F>
+esp_err_t MqttSubscribe(const char *topic, int qos, F callback) {
+
+  static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>,
+                "captures must be trivially copyable");
+  static_assert(sizeof(F) <= CONFIG_MQTT_SUB_CTX_SIZE, "captures too large for the subscription");
+  static_assert(alignof(F) <= MQTT_SUB_CTX_ALIGN, "captures over aligned");
+
+  return MqttSubscribeCtx(topic, qos, [](const char *data, int data_len, void *ctx) {
+                            (*static_cast<F*>(ctx))(data, data_len);
+                          }, &callback, sizeof(F));
+}
 #endif
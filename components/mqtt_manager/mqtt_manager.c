@@ -32,14 +32,25 @@
  */
 
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>
 #include "esp_err.h"
 #include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "mqtt_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
 #include "mqtt_manager.h"
+#include "trace.h"
+#include "dlog.h"
 
 #ifdef CONFIG_MQTT_NULL_CLIENT_ID
 #define MQTT_NULL_CLIENT_ID true
@@ -47,32 +58,992 @@
 #define MQTT_NULL_CLIENT_ID false
 #endif
 
+#ifdef CONFIG_MQTT_TLS_VERIFY_PINNED_CA
+/* CONFIG_MQTT_TLS_CA_CERT_PATH, embedded by CMakeLists.txt */
+extern const char mqtt_broker_ca_pem_start[] asm("_binary_mqtt_broker_ca_pem_start");
+#endif
+
 static const char *s_TAG = "MQTT_M";
 
-typedef struct subscriptions {
-  char *topic;
+#define MQTT_CONNECTED_BIT (1 << 0)
+#define MQTT_MAX_USER_PROPERTIES (8)
+#define MQTT_MAX_BROKERS (4)
+#define MQTT_EARLY_ACKS (4)
+#define MQTT_MSG_ID_PENDING (-1)
+#define MQTT_ACK_CHECK_PERIOD_US (100 * 1000)
+#define MQTT_LANE_RETRY_MS (10)
+/* Control task requests */
+#define MQTT_CTL_BROKERS (1 << 0)       /* a broker connected or disconnected */
+#define MQTT_CTL_PROBE_DROP (1 << 1)    /* probes found the link half-open */
+#define MQTT_CTL_LINK_CONFIG (1 << 2)   /* keepalive or reconnect delay changed */
+#define MQTT_CTL_PROBE_SEND (1 << 3)    /* a probe is due */
+
+#ifdef CONFIG_MQTT_LINK_PROBE
+#define MQTT_RTT_LOST UINT32_MAX
+/* Probes answered in a row before a connection counts as stable */
+#define MQTT_PROBE_STABLE (8)
+/* The keepalive covers this many worst case round trips */
+#define MQTT_KEEPALIVE_RTTS (4)
+/* Private to the board through its MAC, every message on it is an echo */
+#define MQTT_PROBE_TOPIC "franzininho-wifi/%02x%02x%02x%02x%02x%02x/probe"
+#define MQTT_PROBE_TOPIC_LEN (sizeof("franzininho-wifi/") + 12 + sizeof("/probe"))
+_Static_assert(CONFIG_MQTT_PROBE_TIMEOUT_MS < CONFIG_MQTT_PROBE_PERIOD_MS,
+               "MQTT_PROBE_TIMEOUT_MS must be below MQTT_PROBE_PERIOD_MS");
+_Static_assert(CONFIG_MQTT_KEEPALIVE_MIN_S <= CONFIG_MQTT_KEEPALIVE_MAX_S,
+               "MQTT_KEEPALIVE_MIN_S above MQTT_KEEPALIVE_MAX_S");
+#endif
+
+#ifdef CONFIG_MQTT_MANAGER_PROTOCOL_V5
+#define MQTT_PROTOCOL_VERSION MQTT_PROTOCOL_V_5
+/* Twice as many candidates as aliases, so a topic has to keep being
+ * published to win an alias over one-off topics. */
+#define MQTT_ALIAS_CANDIDATES (2 * CONFIG_MQTT_TOPIC_ALIAS_MAX)
+
+typedef struct {
+  uint32_t hash;
+  uint16_t count;
+  uint16_t alias;     /* 0 while the topic has no alias */
+  bool announced;     /* broker knows the alias on this connection */
+  char topic[CONFIG_MQTT_SUB_TOPIC_MAX_LEN + 1];
+} topic_alias;
+#else
+#define MQTT_PROTOCOL_VERSION MQTT_PROTOCOL_V_3_1_1
+#endif
+
+/* started belongs to the control task; the others are only written by the
+ * broker's own client task, which counts its events for the control task. */
+typedef struct {
+  const char *uri;
+  esp_mqtt_client_handle_t client;
+  bool started;
+  bool connected;
+  TaskHandle_t task;        /* the client's task, as of its last event */
+  int64_t connect_start;    /* last connection attempt, 0 once connected */
+  char data_topic[CONFIG_MQTT_SUB_TOPIC_MAX_LEN];   /* of a message arriving in parts */
+  int data_topic_len;       /* -1 if its topic did not fit */
+  uint32_t connect_ms;      /* the attempt behind the last CONNECTED, UINT32_MAX if untimed */
+  unsigned connects;
+  unsigned disconnects;
+} broker;
+
+typedef struct {
+  int msg_id;               /* 0 while the slot is free */
+  unsigned broker;
+  int64_t deadline;
+  mqtt_publish_cb callback;
+  void *user_ctx;
+} inflight;
+
+typedef struct {
+  int msg_id;
+  unsigned broker;
+} ack_key;
+
+typedef struct {
+  mqtt_publish_cb callback;
+  void *user_ctx;
+} completion;
+
+/* A queued publish: topic, NUL, then the payload. */
+typedef struct {
+  int len;
+  int qos;
+  int retain;
+  uint32_t timeout_ms;
+  mqtt_publish_cb callback; /* NULL unless queued by MqttPublishLaneAsync() */
+  void *user_ctx;
+  char data[];
+} lane_msg;
+
+typedef struct {
+  QueueHandle_t queue;
+  int64_t tokens;           /* bytes, may go negative after a large message */
+  int64_t rate;             /* bytes per second */
+  mqtt_lane_stats stats;
+} lane;
+
+typedef bool (*inflight_match)(const inflight *entry, const void *arg);
+
+#ifdef CONFIG_MQTT_LINK_PROBE
+typedef struct {
+  esp_timer_handle_t timer;
+  char topic[MQTT_PROBE_TOPIC_LEN];
+  SemaphoreHandle_t lock;   /* shared by the probe timer, the MQTT and the control task */
+  uint32_t seq;
+  int64_t sent_us;          /* probe waiting for its echo, 0 if none */
+  int64_t sent_busy_us;     /* busy_us as of sent_us */
+  int64_t busy_since;       /* active client's task entered an event handler, 0 if not */
+  int64_t busy_us;          /* total time it spent in handlers, unable to read echoes */
+  int64_t next_us;          /* next probe due */
+  unsigned lost_in_row;
+  unsigned answered_in_row;
+  bool stable;              /* answered MQTT_PROBE_STABLE probes in a row on this connection */
+  bool half_open;           /* dropped for lost probes, reconnect at once */
+  uint32_t rtt_ms[MQTT_LINK_SAMPLES];   /* ring of outcomes, MQTT_RTT_LOST if lost */
+  unsigned num_samples;
+  unsigned next_sample;
+  unsigned applied_broker;              /* last client configured, and with what */
+  uint32_t applied_keepalive_s;
+  uint32_t applied_reconnect_ms;
+  mqtt_link_stats stats;
+} link_probe;
+#endif
+
+typedef struct {
+  bool in_use;
+  char topic[CONFIG_MQTT_SUB_TOPIC_MAX_LEN + 1];
+  int qos;
+  bool no_local;            /* MQTT 5: the broker does not echo our own publishes */
+  bool live;                /* retained messages are not delivered */
+  unsigned sent_on;         /* connection the SUBSCRIBE went out on, 0 if none */
   mqtt_subscription_cb callback;
+  mqtt_topic_cb topic_callback;
+  mqtt_fragment_cb fragment_callback;
   void *user_ctx;
-  struct subscriptions *next;
+/* Copy of the context given to MqttSubscribeCtx(), user_ctx then points here */
+  union {
+    uint64_t align_u64;
+    double align_double;
+    void *align_ptr;
+    uint8_t bytes[CONFIG_MQTT_SUB_CTX_SIZE];
+  } ctx;
 } subscriptions;
+/* What a subscribe call asks for, copied into its pool entry */
+typedef struct {
+  int qos;
+  bool no_local;
+  bool live;
+  mqtt_subscription_cb callback;
+  mqtt_topic_cb topic_callback;
+  mqtt_fragment_cb fragment_callback;
+  void *user_ctx;
+} subscribe_spec;
+
+_Static_assert(_Alignof(double) <= MQTT_SUB_CTX_ALIGN && _Alignof(uint64_t) <= MQTT_SUB_CTX_ALIGN,
+               "MQTT_SUB_CTX_ALIGN too small");
 
 struct driver_state {
 
 /* Is driver initialised? */
   bool initialised;
 
-/* MQTT client handle */
+/* MQTT client handle of the active broker */
   esp_mqtt_client_handle_t client;
 
-/* MQTT subscriptions */
-  subscriptions *head;
-  subscriptions *tail;
+/* Configured brokers, in order of preference */
+  broker brokers[MQTT_MAX_BROKERS];
+  unsigned num_brokers;
+  unsigned active;
+  char uri_list[sizeof(CONFIG_MQTT_BROKER_URI_FALLBACK)];
+
+/* Failover is serialised by control_task: the event handlers only record
+ * what happened to their broker and notify it. It owns active, the connected
+ * bit and the stats; outage_start is 0 while the active broker is up. */
+  TaskHandle_t control_task;
+  int64_t outage_start;
+  mqtt_failover_stats stats;
+  mqtt_connected_cb connected_cb;
+  void *connected_ctx;
+
+/* Connection attempt durations */
+  mqtt_connect_stats connect_stats;
+  uint64_t connect_total_ms;
+
+/* Client configuration, kept to adapt keepalive and reconnect delay */
+  esp_mqtt_client_config_t config;
+
+/* Connection state, MQTT_CONNECTED_BIT set while connected */
+  EventGroupHandle_t events;
+
+/* Serialises MQTT 5 property setup with the publish or subscribe it applies to */
+  SemaphoreHandle_t publish_lock;
+
+#ifdef CONFIG_MQTT_MANAGER_PROTOCOL_V5
+/* Topic aliases for frequently published topics */
+  topic_alias aliases[MQTT_ALIAS_CANDIDATES];
+  uint16_t next_alias;
+  bool aliases_refused;
+#endif
+
+/* Publishes waiting for their acknowledgement, the window semaphore counts
+ * the free slots. ack_timer runs while any slot is in use. */
+  inflight inflight[CONFIG_MQTT_INFLIGHT_WINDOW];
+  SemaphoreHandle_t inflight_lock;
+  SemaphoreHandle_t window;
+  esp_timer_handle_t ack_timer;
+  mqtt_publish_stats publish_stats;
+
+/* Acknowledgements which arrived before their publish call returned; kept
+ * only while such a call is returning and its broker connected */
+  ack_key early_acks[MQTT_EARLY_ACKS];
+  unsigned next_early_ack;
+
+/* Priority lanes; the interactive one publishes directly, the others are
+ * queued and drained by lane_task within their bandwidth share */
+  lane lanes[MQTT_NUM_LANES];
+  TaskHandle_t lane_task;
+  int64_t lanes_refill;
+/* Guards the stats of every lane, updated by publishers and lane_task */
+  SemaphoreHandle_t lanes_lock;
+
+/* MQTT subscriptions, a fixed pool; entries below num_subscriptions may be
+ * in use. sub_lock guards the pool and is never held while calling into the
+ * client, as the MQTT task holds the client lock while it dispatches events.
+ * connection counts activations, to tell which entries were subscribed. */
+  subscriptions subscriptions[CONFIG_MQTT_MAX_SUBSCRIPTIONS];
+  SemaphoreHandle_t sub_lock;
+  unsigned connection;
+  unsigned num_subscriptions;
+  unsigned max_subscriptions_used;
+
+#ifdef CONFIG_MQTT_LINK_PROBE
+/* Loopback probes through the broker and what they tell about the link */
+  link_probe probe;
+#endif
 
 /* Error check variable */
   esp_err_t rc;
 };
 static struct driver_state s_d_state = {0};
 
+static esp_err_t s_InitLanes(void);
+static esp_err_t s_Subscribe(const char *topic, const subscribe_spec *spec, const void *ctx,
+                             size_t ctx_size);
+static esp_err_t s_Publish(const char *topic, const char *message, int len, int qos, int retain,
+                           const mqtt_publish_props *props, int *msg_id);
+
+/*
+ * @brief Send the SUBSCRIBE of a pool entry to the active broker.
+ */
+static int s_SendSubscribe(const subscriptions *s) {
+
+#ifdef CONFIG_MQTT_MANAGER_PROTOCOL_V5
+  if (s->no_local) {
+    /* The property applies to the next subscribe call only. */
+    esp_mqtt5_subscribe_property_config_t property = {
+      .no_local_flag = true,
+    };
+    int msg_id = -1;
+    xSemaphoreTake(s_d_state.publish_lock, portMAX_DELAY);
+    if (esp_mqtt5_client_set_subscribe_property(s_d_state.client, &property) == ESP_OK)
+      msg_id = esp_mqtt_client_subscribe(s_d_state.client, s->topic, s->qos);
+    xSemaphoreGive(s_d_state.publish_lock);
+    return msg_id;
+  }
+#endif
+  return esp_mqtt_client_subscribe(s_d_state.client, s->topic, s->qos);
+}
+
+/*
+ * @brief Match a topic against a filter with + and # wildcards. Topics
+ * starting with $ only match filters starting with the same level.
+ */
+static bool s_TopicMatches(const char *filter, const char *topic, int topic_len) {
+
+  const char *end = topic + topic_len;
+  if (!topic_len || (*topic == '$' && (*filter == '+' || *filter == '#')))
+    return false;
+
+  while (*filter) {
+    if (*filter == '#')
+      return true;
+    if (*filter == '+') {
+      while (topic < end && *topic != '/')
+        topic++;
+      filter++;
+    } else if (topic < end && *topic == *filter) {
+      topic++;
+      filter++;
+    } else {
+      /* "a/#" also matches its parent level "a". */
+      return topic == end && !strcmp(filter, "/#");
+    }
+  }
+  return topic == end;
+}
+
+/*
+ * @brief Copy the next subscription matching a topic, from *next on, so its
+ * callback can run without the lock while the entry is freed or reused.
+ *
+ * @return false once there are no more matches.
+ */
+static bool s_NextMatch(unsigned *next, const char *topic, int topic_len, subscriptions *match) {
+
+  bool found = false;
+  xSemaphoreTake(s_d_state.sub_lock, portMAX_DELAY);
+  for (unsigned i = *next; i < s_d_state.num_subscriptions && !found; i++) {
+    const subscriptions *s = &s_d_state.subscriptions[i];
+    if (!s->in_use || !s_TopicMatches(s->topic, topic, topic_len))
+      continue;
+    *match = *s;
+    if (s->user_ctx == s->ctx.bytes)
+      match->user_ctx = match->ctx.bytes;
+    *next = i + 1;
+    found = true;
+  }
+  xSemaphoreGive(s_d_state.sub_lock);
+  return found;
+}
+
+/*
+ * @brief Copy the next subscription from *next on which was not subscribed on
+ * the given connection yet, marking it as subscribed.
+ *
+ * @return false once there are no more.
+ */
+static bool s_NextRenewal(unsigned *next, unsigned connection, subscriptions *renew) {
+
+  bool found = false;
+  xSemaphoreTake(s_d_state.sub_lock, portMAX_DELAY);
+  for (unsigned i = *next; i < s_d_state.num_subscriptions && !found; i++) {
+    subscriptions *s = &s_d_state.subscriptions[i];
+    if (!s->in_use || s->sent_on == connection)
+      continue;
+    s->sent_on = connection;
+    *renew = *s;
+    *next = i + 1;
+    found = true;
+  }
+  xSemaphoreGive(s_d_state.sub_lock);
+  return found;
+}
+
+/*
+ * @brief Start the client of a broker which is not running yet.
+ */
+static void s_StartBroker(unsigned index) {
+
+  broker *b = &s_d_state.brokers[index];
+  if (b->started)
+    return;
+  if (esp_mqtt_client_start(b->client) == ESP_OK)
+    b->started = true;
+  else
+    ESP_LOGE(s_TAG, "Failed to start client for %s", b->uri);
+}
+
+/*
+ * @brief Stop the brokers started by a failover which are no longer needed,
+ * the ones which lost the race included; only the active broker and the warm
+ * standby keep running. Never called from a client task, which cannot stop
+ * itself.
+ */
+static void s_StopIdleBrokers(void) {
+
+  for (unsigned i = 0; i < s_d_state.num_brokers; i++) {
+    broker *b = &s_d_state.brokers[i];
+    if (i == s_d_state.active || !b->started)
+      continue;
+#ifdef CONFIG_MQTT_WARM_STANDBY
+    if (i == (s_d_state.active + 1) % s_d_state.num_brokers)
+      continue;
+#endif
+    if (esp_mqtt_client_stop(b->client) != ESP_OK) {
+      ESP_LOGW(s_TAG, "Failed to stop client for %s", b->uri);
+      continue;
+    }
+    /* Its task is gone, nothing else writes these now. */
+    b->started = false;
+    b->connected = false;
+    b->connect_start = 0;
+    DLOGI(s_TAG, "Stopped broker %u", i);
+  }
+}
+
+/*
+ * @brief Drop the early acknowledgements of a broker, or of all with
+ * MQTT_MAX_BROKERS. Called with inflight_lock held.
+ */
+static void s_ForgetEarlyAcks(unsigned broker) {
+
+  for (int i = 0; i < MQTT_EARLY_ACKS; i++) {
+    ack_key *key = &s_d_state.early_acks[i];
+    if (broker == MQTT_MAX_BROKERS || key->broker == broker)
+      key->msg_id = 0;
+  }
+}
+
+static bool s_MatchAck(const inflight *entry, const void *arg) {
+
+  const ack_key *key = arg;
+  return entry->msg_id == key->msg_id && entry->broker == key->broker;
+}
+
+static bool s_MatchBroker(const inflight *entry, const void *arg) {
+
+  return entry->broker == *(const unsigned*) arg;
+}
+
+static bool s_MatchExpired(const inflight *entry, const void *arg) {
+
+  return entry->deadline <= *(const int64_t*) arg;
+}
+
+/*
+ * @brief Resolve the in-flight publishes selected by match. Callbacks run
+ * after the lock is released, so they may publish again.
+ *
+ * @param remember with no match, keep the key of an acknowledgement which
+ * may belong to a publish call still returning its msg_id.
+ * @return number of publishes resolved.
+ */
+static unsigned s_ResolveInflight(inflight_match match, const void *arg, esp_err_t result,
+                                  bool remember) {
+
+  completion done[CONFIG_MQTT_INFLIGHT_WINDOW];
+  unsigned count = 0;
+  bool pending = false;
+
+  xSemaphoreTake(s_d_state.inflight_lock, portMAX_DELAY);
+  for (int i = 0; i < CONFIG_MQTT_INFLIGHT_WINDOW; i++) {
+    inflight *entry = &s_d_state.inflight[i];
+    if (entry->msg_id == MQTT_MSG_ID_PENDING)
+      pending = true;
+    if (entry->msg_id <= 0 || !match(entry, arg))
+      continue;
+    done[count].callback = entry->callback;
+    done[count].user_ctx = entry->user_ctx;
+    count++;
+    entry->msg_id = 0;
+    xSemaphoreGive(s_d_state.window);
+  }
+  if (!count && remember && pending)
+    s_d_state.early_acks[s_d_state.next_early_ack++ % MQTT_EARLY_ACKS] = *(const ack_key*) arg;
+
+  if (result == ESP_OK)
+    s_d_state.publish_stats.acked += count;
+  else if (result == ESP_ERR_TIMEOUT)
+    s_d_state.publish_stats.timed_out += count;
+  else
+    s_d_state.publish_stats.failed += count;
+  xSemaphoreGive(s_d_state.inflight_lock);
+
+  for (unsigned i = 0; i < count; i++) {
+    if (done[i].callback)
+      done[i].callback(result, done[i].user_ctx);
+  }
+  return count;
+}
+
+static void s_AckTimer(void *args) {
+
+  int64_t now = esp_timer_get_time();
+  s_ResolveInflight(s_MatchExpired, &now, ESP_ERR_TIMEOUT, false);
+
+  xSemaphoreTake(s_d_state.inflight_lock, portMAX_DELAY);
+  if (uxSemaphoreGetCount(s_d_state.window) == CONFIG_MQTT_INFLIGHT_WINDOW)
+    esp_timer_stop(s_d_state.ack_timer);
+  xSemaphoreGive(s_d_state.inflight_lock);
+}
+
+#ifdef CONFIG_MQTT_LINK_PROBE
+static int s_CompareU32(const void *a, const void *b) {
+
+  uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * @brief Add a probe outcome, then update the percentiles, the loss and the
+ * keepalive they call for. Must be called with the probe lock held.
+ */
+static void s_ProbeRecord(uint32_t rtt_ms) {
+
+  link_probe *p = &s_d_state.probe;
+  p->rtt_ms[p->next_sample] = rtt_ms;
+  p->next_sample = (p->next_sample + 1) % MQTT_LINK_SAMPLES;
+  if (p->num_samples < MQTT_LINK_SAMPLES)
+    p->num_samples++;
+
+  uint32_t sorted[MQTT_LINK_SAMPLES];
+  unsigned answered = 0;
+  for (unsigned i = 0; i < p->num_samples; i++) {
+    if (p->rtt_ms[i] != MQTT_RTT_LOST)
+      sorted[answered++] = p->rtt_ms[i];
+  }
+  qsort(sorted, answered, sizeof(sorted[0]), s_CompareU32);
+
+  mqtt_link_stats *stats = &p->stats;
+  stats->loss_pct = (p->num_samples - answered) * 100 / p->num_samples;
+  if (answered) {
+    /* Nearest rank */
+    stats->p50_rtt_ms = sorted[(answered * 50 + 99) / 100 - 1];
+    stats->p90_rtt_ms = sorted[(answered * 90 + 99) / 100 - 1];
+    stats->p99_rtt_ms = sorted[(answered * 99 + 99) / 100 - 1];
+  }
+
+  /* Short while the probes get through, long while they are being lost, as
+   * they catch a dead link anyway; never below a few slow round trips. */
+  uint32_t keepalive = stats->loss_pct ? CONFIG_MQTT_KEEPALIVE_MAX_S : CONFIG_MQTT_KEEPALIVE_MIN_S;
+  uint32_t slowest = ((uint64_t) stats->p99_rtt_ms * MQTT_KEEPALIVE_RTTS + 999) / 1000;
+  stats->keepalive_s = MIN(MAX(keepalive, slowest), CONFIG_MQTT_KEEPALIVE_MAX_S);
+}
+
+/*
+ * @brief Hand the keepalive and reconnect delay to the client of a broker if
+ * they changed. Only called from the control task; keepalive takes effect on
+ * the next CONNECT, the delay on the next reconnection.
+ */
+static void s_ApplyLinkConfig(unsigned index) {
+
+  link_probe *p = &s_d_state.probe;
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  uint32_t keepalive = p->stats.keepalive_s;
+  uint32_t reconnect = p->stats.reconnect_ms;
+  bool changed = index != p->applied_broker || keepalive != p->applied_keepalive_s ||
+                 reconnect != p->applied_reconnect_ms;
+  p->applied_broker = index;
+  p->applied_keepalive_s = keepalive;
+  p->applied_reconnect_ms = reconnect;
+  xSemaphoreGive(p->lock);
+  if (!changed)
+    return;
+
+  esp_mqtt_client_config_t config = s_d_state.config;
+  config.broker.address.uri = s_d_state.brokers[index].uri;
+  config.session.keepalive = keepalive;
+  config.network.reconnect_timeout_ms = reconnect;
+  if (esp_mqtt_set_config(s_d_state.brokers[index].client, &config) != ESP_OK)
+    ESP_LOGW(s_TAG, "Failed to reconfigure %s", s_d_state.brokers[index].uri);
+  else
+    DLOGI(s_TAG, "Keepalive %" PRIu32 " s, reconnect delay %" PRIu32 " ms", keepalive, reconnect);
+}
+
+/*
+ * @brief Time the active client's task spent in event handlers up to now.
+ * Must be called with the probe lock held.
+ */
+static int64_t s_ProbeBusyUs(const link_probe *p, int64_t now) {
+
+  return p->busy_us + (p->busy_since ? now - p->busy_since : 0);
+}
+
+/*
+ * @brief Account the time the active client's task spends in event handlers.
+ * An echo can only be read once the task is back, so that time is not held
+ * against the link.
+ */
+static void s_ProbeDispatch(bool begin) {
+
+  link_probe *p = &s_d_state.probe;
+  int64_t now = esp_timer_get_time();
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  if (begin) {
+    p->busy_since = now;
+  } else if (p->busy_since) {
+    p->busy_us += now - p->busy_since;
+    p->busy_since = 0;
+  }
+  xSemaphoreGive(p->lock);
+}
+
+/*
+ * @brief Send the next probe when due and count the ones not echoed in time.
+ * One shot, rearmed for the next timeout or probe; stops while disconnected
+ * and s_ProbeStart() starts it again. The timeout is extended by the time the
+ * active client's task was busy, so a slow task is not taken for a dead link.
+ */
+static void s_ProbeTimer(void *args) {
+
+  link_probe *p = &s_d_state.probe;
+  int64_t now = esp_timer_get_time();
+  uint32_t request = 0;
+
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  if (!(xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT)) {
+    p->sent_us = 0;
+    xSemaphoreGive(p->lock);
+    return;
+  }
+
+  int64_t deadline = p->sent_us + (int64_t) CONFIG_MQTT_PROBE_TIMEOUT_MS * 1000 +
+                     s_ProbeBusyUs(p, now) - p->sent_busy_us;
+  if (p->sent_us && now >= deadline) {
+    p->sent_us = 0;
+    p->stats.lost++;
+    p->answered_in_row = 0;
+    s_ProbeRecord(MQTT_RTT_LOST);
+    if (++p->lost_in_row >= CONFIG_MQTT_PROBE_MAX_LOST) {
+      p->lost_in_row = 0;
+      p->stats.half_open++;
+      p->half_open = true;
+      request = MQTT_CTL_PROBE_DROP;
+    } else {
+      /* Retry at once, a dead link is told from a lost packet sooner. */
+      p->next_us = now;
+    }
+  }
+
+  if (!request && !p->sent_us && now >= p->next_us) {
+    p->seq++;
+    p->sent_us = now;
+    p->sent_busy_us = s_ProbeBusyUs(p, now);
+    deadline = now + (int64_t) CONFIG_MQTT_PROBE_TIMEOUT_MS * 1000;
+    p->next_us = now + (int64_t) CONFIG_MQTT_PROBE_PERIOD_MS * 1000;
+    p->stats.probes++;
+    request = MQTT_CTL_PROBE_SEND;
+  }
+  int64_t wake = p->sent_us ? deadline : p->next_us;
+  xSemaphoreGive(p->lock);
+
+  /* Sending and disconnecting wait for the client lock, which the timer task
+   * must not, so the control task does both. */
+  if (request)
+    xTaskNotify(s_d_state.control_task, request, eSetBits);
+  if (request != MQTT_CTL_PROBE_DROP)
+    esp_timer_start_once(p->timer, MAX(wake - esp_timer_get_time(), 1000));
+}
+
+/*
+ * @brief Publish the probe the timer has just started waiting for. One which
+ * fails to go out is counted lost on its timeout.
+ */
+static void s_ProbeSend(void) {
+
+  link_probe *p = &s_d_state.probe;
+  char payload[12];
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  bool due = p->sent_us != 0;
+  int len = snprintf(payload, sizeof(payload), "%" PRIu32, p->seq);
+  xSemaphoreGive(p->lock);
+  if (due)
+    s_Publish(p->topic, payload, len, 0, 0, NULL, NULL);
+}
+
+static void s_ProbeEcho(const char *data, int data_len, void *user_ctx) {
+
+  link_probe *p = &s_d_state.probe;
+  int64_t now = esp_timer_get_time();
+  char payload[12];
+  if (data_len <= 0 || (size_t) data_len >= sizeof(payload))
+    return;
+  memcpy(payload, data, data_len);
+  payload[data_len] = '\0';
+  uint32_t seq = strtoul(payload, NULL, 10);
+
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  /* A late echo belongs to a probe already counted lost. */
+  if (!p->sent_us || seq != p->seq) {
+    xSemaphoreGive(p->lock);
+    return;
+  }
+  /* Arrived when the handler was entered, less the time the task was busy
+   * with other events since the probe went out. */
+  int64_t arrival = p->busy_since ? p->busy_since : now;
+  int64_t rtt_us = arrival - p->sent_us - (s_ProbeBusyUs(p, arrival) - p->sent_busy_us);
+  uint32_t rtt_ms = (MAX(rtt_us, 0) + 500) / 1000;
+  p->sent_us = 0;
+  p->lost_in_row = 0;
+  p->stats.last_rtt_ms = rtt_ms;
+  s_ProbeRecord(rtt_ms);
+  if (++p->answered_in_row >= MQTT_PROBE_STABLE && !p->stable) {
+    p->stable = true;
+    p->stats.reconnect_ms = CONFIG_MQTT_RECONNECT_TIMEOUT_MS;
+  }
+  xSemaphoreGive(p->lock);
+
+  xTaskNotify(s_d_state.control_task, MQTT_CTL_LINK_CONFIG, eSetBits);
+}
+
+/*
+ * @brief Drop a connection the probes found half-open, unless it went down
+ * meanwhile. The DISCONNECTED event then reconnects, or fails over, at once.
+ */
+static void s_ProbeDrop(void) {
+
+  link_probe *p = &s_d_state.probe;
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  bool drop = p->half_open && (xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT);
+  xSemaphoreGive(p->lock);
+  if (!drop)
+    return;
+  ESP_LOGW(s_TAG, "%d probes lost in a row, dropping the connection", CONFIG_MQTT_PROBE_MAX_LOST);
+  esp_mqtt_client_disconnect(s_d_state.client);
+}
+
+/*
+ * @brief Start probing a new connection, one period after it came up so the
+ * first probe does not queue behind the republished state.
+ */
+static void s_ProbeStart(unsigned index) {
+
+  link_probe *p = &s_d_state.probe;
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  p->sent_us = 0;
+  p->next_us = 0;
+  p->lost_in_row = 0;
+  p->answered_in_row = 0;
+  p->stable = false;
+  xSemaphoreGive(p->lock);
+
+  s_ApplyLinkConfig(index);
+  esp_timer_stop(p->timer);
+  esp_timer_start_once(p->timer, (uint64_t) CONFIG_MQTT_PROBE_PERIOD_MS * 1000);
+}
+
+/*
+ * @brief The active connection dropped, or an attempt to make it failed: back
+ * off unless the connection had proven stable, and reconnect a half-open
+ * connection at once.
+ */
+static void s_ProbeLinkDown(unsigned index) {
+
+  link_probe *p = &s_d_state.probe;
+  xSemaphoreTake(p->lock, portMAX_DELAY);
+  if (!p->stable)
+    p->stats.reconnect_ms = MIN(p->stats.reconnect_ms * 2, CONFIG_MQTT_RECONNECT_MAX_MS);
+  p->stable = false;
+  p->sent_us = 0;
+  bool half_open = p->half_open;
+  p->half_open = false;
+  xSemaphoreGive(p->lock);
+
+  s_ApplyLinkConfig(index);
+  if (half_open)
+    esp_mqtt_client_reconnect(s_d_state.brokers[index].client);
+}
+
+static esp_err_t s_ProbeInit(void) {
+
+  link_probe *p = &s_d_state.probe;
+  uint8_t mac[6];
+  esp_err_t rc;
+
+  if ((rc = esp_read_mac(mac, ESP_MAC_WIFI_STA)))
+    return rc;
+  snprintf(p->topic, sizeof(p->topic), MQTT_PROBE_TOPIC,
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  p->lock = xSemaphoreCreateMutex();
+  if (!p->lock)
+    return ESP_ERR_NO_MEM;
+  p->stats.keepalive_s = CONFIG_MQTT_KEEPALIVE_MIN_S;
+  p->stats.reconnect_ms = CONFIG_MQTT_RECONNECT_TIMEOUT_MS;
+  p->applied_keepalive_s = CONFIG_MQTT_KEEPALIVE_MIN_S;
+  p->applied_reconnect_ms = CONFIG_MQTT_RECONNECT_TIMEOUT_MS;
+
+  const esp_timer_create_args_t timer = {
+    .callback = s_ProbeTimer,
+    .name = "mqtt_probe",
+  };
+  return esp_timer_create(&timer, &p->timer);
+}
+#endif
+
+/*
+ * @brief Make a connected broker the active one.
+ *
+ *  Called by the control task on every connection of the active broker and
+ *  when another broker takes over. Clean sessions drop subscriptions, so they
+ *  are always renewed, then the user is told to republish its state.
+ */
+static void s_Activate(unsigned index) {
+
+  unsigned previous = s_d_state.active;
+
+  xSemaphoreTake(s_d_state.publish_lock, portMAX_DELAY);
+  s_d_state.active = index;
+  s_d_state.client = s_d_state.brokers[index].client;
+#ifdef CONFIG_MQTT_MANAGER_PROTOCOL_V5
+  /* Alias mappings only live as long as the network connection. */
+  for (int i = 0; i < MQTT_ALIAS_CANDIDATES; i++)
+    s_d_state.aliases[i].announced = false;
+  s_d_state.aliases_refused = false;
+#endif
+  xSemaphoreGive(s_d_state.publish_lock);
+
+  /* Subscriptions added from here on see the connected bit and subscribe
+   * themselves on this connection, the ones added before are renewed here. */
+  xSemaphoreTake(s_d_state.sub_lock, portMAX_DELAY);
+  unsigned connection = ++s_d_state.connection;
+  xEventGroupSetBits(s_d_state.events, MQTT_CONNECTED_BIT);
+  xSemaphoreGive(s_d_state.sub_lock);
+  subscriptions renew;
+  for (unsigned next = 0; s_NextRenewal(&next, connection, &renew);) {
+    if (s_SendSubscribe(&renew) < 0)
+      ESP_LOGW(s_TAG, "Resubscribe to %s failed", renew.topic);
+  }
+#ifdef CONFIG_MQTT_LINK_PROBE
+  s_ProbeStart(index);
+#endif
+
+  if (s_d_state.outage_start) {
+    uint32_t latency_ms = (esp_timer_get_time() - s_d_state.outage_start) / 1000;
+    s_d_state.outage_start = 0;
+    s_d_state.stats.last_outage_ms = latency_ms;
+    if (index != previous) {
+      s_d_state.stats.failovers++;
+      s_d_state.stats.last_failover_ms = latency_ms;
+      if (latency_ms > s_d_state.stats.max_failover_ms)
+        s_d_state.stats.max_failover_ms = latency_ms;
+      ESP_LOGW(s_TAG, "Failed over to %s in %" PRIu32 " ms", s_d_state.brokers[index].uri,
+               latency_ms);
+    }
+  }
+  s_d_state.stats.active_broker = index;
+
+#ifdef CONFIG_MQTT_WARM_STANDBY
+  /* Keep the next broker connected, ready to take over. */
+  if (s_d_state.num_brokers > 1)
+    s_StartBroker((index + 1) % s_d_state.num_brokers);
+#endif
+
+  /* Publishes left on the previous broker will not be acknowledged here. */
+  if (index != previous)
+    s_ResolveInflight(s_MatchBroker, &previous, ESP_FAIL, false);
+
+  if (s_d_state.connected_cb)
+    s_d_state.connected_cb(s_d_state.connected_ctx);
+}
+
+/*
+ * @brief Account the connection attempt of a broker which just connected.
+ */
+static void s_ConnectDone(unsigned index) {
+
+  uint32_t elapsed_ms = s_d_state.brokers[index].connect_ms;
+  if (elapsed_ms == UINT32_MAX) {
+    DLOGI(s_TAG, "MQTT_EVENT_CONNECTED, broker %u", index);
+    return;
+  }
+
+  mqtt_connect_stats *stats = &s_d_state.connect_stats;
+  stats->connects++;
+  stats->last_connect_ms = elapsed_ms;
+  if (stats->connects == 1 || elapsed_ms < stats->min_connect_ms)
+    stats->min_connect_ms = elapsed_ms;
+  if (elapsed_ms > stats->max_connect_ms)
+    stats->max_connect_ms = elapsed_ms;
+  s_d_state.connect_total_ms += elapsed_ms;
+  stats->avg_connect_ms = s_d_state.connect_total_ms / stats->connects;
+  DLOGI(s_TAG, "MQTT_EVENT_CONNECTED, broker %u in %" PRIu32 " ms", index, elapsed_ms);
+}
+
+/*
+ * @brief Catch up with the events of the brokers since the last call.
+ *
+ *  When the active broker went away, switch to a connected standby, or start
+ *  the other brokers and switch to whichever connects first. Brokers which
+ *  are not needed once one is active are stopped again.
+ *
+ * @param connects, disconnects the broker counters seen so far.
+ */
+static void s_Reconcile(unsigned *connects, unsigned *disconnects) {
+
+  const unsigned active = s_d_state.active;
+  bool lost = false;
+  for (unsigned i = 0; i < s_d_state.num_brokers; i++) {
+    const broker *b = &s_d_state.brokers[i];
+    unsigned connected = b->connects, disconnected = b->disconnects;
+    if (connected != connects[i]) {
+      connects[i] = connected;
+      s_ConnectDone(i);
+    }
+    if (disconnected != disconnects[i]) {
+      disconnects[i] = disconnected;
+      if (i == active)
+        lost = true;
+    }
+  }
+
+  /* Also a failed attempt to connect the active broker. */
+  if (lost) {
+    xEventGroupClearBits(s_d_state.events, MQTT_CONNECTED_BIT);
+    if (!s_d_state.outage_start)
+      s_d_state.outage_start = esp_timer_get_time();
+#ifdef CONFIG_MQTT_LINK_PROBE
+    s_ProbeLinkDown(active);
+#endif
+  }
+
+  if (xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT) {
+    s_StopIdleBrokers();
+    return;
+  }
+
+  /* The active broker first, it may have reconnected meanwhile. */
+  for (unsigned n = 0; n < s_d_state.num_brokers; n++) {
+    unsigned i = (active + n) % s_d_state.num_brokers;
+    if (s_d_state.brokers[i].connected) {
+      s_Activate(i);
+      s_StopIdleBrokers();
+      return;
+    }
+  }
+  if (s_d_state.outage_start) {
+    for (unsigned n = 1; n < s_d_state.num_brokers; n++)
+      s_StartBroker((active + n) % s_d_state.num_brokers);
+  }
+}
+
+/*
+ * @brief Runs failover on behalf of the client tasks, one event at a time, so
+ * it is never raced and may stop clients, which a client task cannot do.
+ */
+static void s_ControlTask(void *args) {
+
+  unsigned connects[MQTT_MAX_BROKERS] = {0};
+  unsigned disconnects[MQTT_MAX_BROKERS] = {0};
+  uint32_t requests;
+  while (true) {
+    xTaskNotifyWait(0, UINT32_MAX, &requests, portMAX_DELAY);
+    if (requests & MQTT_CTL_BROKERS)
+      s_Reconcile(connects, disconnects);
+#ifdef CONFIG_MQTT_LINK_PROBE
+    if (requests & MQTT_CTL_PROBE_SEND)
+      s_ProbeSend();
+    if (requests & MQTT_CTL_PROBE_DROP)
+      s_ProbeDrop();
+    if (requests & MQTT_CTL_LINK_CONFIG)
+      s_ApplyLinkConfig(s_d_state.active);
+#endif
+  }
+}
+
+/*
+ * @brief Hand a received message to every matching subscription. A broker
+ * may also send one copy per matching filter (mosquitto does), each of which
+ * goes to all of them, so callers keep command filters from overlapping.
+ * event->topic is not NUL terminated. A message larger than the client buffer arrives in parts, only
+ * the first of which has the topic; they only go to fragment callbacks.
+ */
+static void s_Deliver(broker *b, esp_mqtt_event_handle_t event) {
+
+  const char *topic = event->topic;
+  int topic_len = event->topic_len;
+  const bool whole = event->data_len == event->total_data_len;
+  if (!whole && !event->current_data_offset) {
+    b->data_topic_len = topic_len <= (int) sizeof(b->data_topic) ? topic_len : -1;
+    if (b->data_topic_len > 0)
+      memcpy(b->data_topic, topic, topic_len);
+  } else if (!whole) {
+    topic = b->data_topic;
+    topic_len = b->data_topic_len;
+  }
+  if (topic_len < 0) {
+    DLOGW(s_TAG, "Dropped part of a %d byte message, topic too long", event->total_data_len);
+    return;
+  }
+
+  subscriptions current;
+  for (unsigned next = 0; s_NextMatch(&next, topic, topic_len, &current);) {
+    if (current.live && event->retain)
+      continue;
+    if (current.fragment_callback) {
+      current.fragment_callback(event->data, event->data_len, event->current_data_offset,
+                                event->total_data_len, current.user_ctx);
+    } else if (!whole) {
+      if (!event->current_data_offset)
+        DLOGW(s_TAG, "Dropped a %d byte message larger than the buffer", event->total_data_len);
+    } else if (current.topic_callback) {
+      current.topic_callback(topic, topic_len, event->data, event->data_len, current.user_ctx);
+    } else if (current.callback) {
+      current.callback(event->data, event->data_len, current.user_ctx);
+    }
+  }
+}
+
 /*
  * @brief Event handler registered to receive MQTT events
  *
@@ -85,45 +1056,67 @@ static struct driver_state s_d_state = {0};
  */
 static void s_MqttEventHandler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
 
-  ESP_LOGD(s_TAG, "Event dispatched from event loop base=%s, event_id=%" PRIi32, base, event_id);
+  TRACE_BEGIN(MQTT_EVENT, event_id);
+  DLOGD(s_TAG, "Event dispatched from event loop base=%s, event_id=%" PRIi32, base, event_id);
   esp_mqtt_event_handle_t event = event_data;
-  subscriptions *current;
+  const unsigned index = (unsigned)(uintptr_t) handler_args;
+  broker *b = &s_d_state.brokers[index];
+  b->task = xTaskGetCurrentTaskHandle();
+#ifdef CONFIG_MQTT_LINK_PROBE
+  const bool busy = index == s_d_state.active;
+  if (busy)
+    s_ProbeDispatch(true);
+#endif
   switch ((esp_mqtt_event_id_t)event_id) {
   case MQTT_EVENT_BEFORE_CONNECT:
-    ESP_LOGI(s_TAG, "MQTT_EVENT_BEFORE_CONNECT");
+    DLOGI(s_TAG, "MQTT_EVENT_BEFORE_CONNECT");
+    b->connect_start = esp_timer_get_time();
     break;
 
   case MQTT_EVENT_CONNECTED:
-    ESP_LOGI(s_TAG, "MQTT_EVENT_CONNECTED");
+    b->connect_ms = b->connect_start ? (esp_timer_get_time() - b->connect_start) / 1000 : UINT32_MAX;
+    b->connect_start = 0;
+    b->connected = true;
+    b->connects++;
+    xTaskNotify(s_d_state.control_task, MQTT_CTL_BROKERS, eSetBits);
     break;
 
   case MQTT_EVENT_DISCONNECTED:
-    ESP_LOGI(s_TAG, "MQTT_EVENT_DISCONNECTED");
+    DLOGI(s_TAG, "MQTT_EVENT_DISCONNECTED, broker %u", index);
+    b->connected = false;
+    b->disconnects++;
+    /* msg_ids start over on the next session, nothing it acked is awaited. */
+    xSemaphoreTake(s_d_state.inflight_lock, portMAX_DELAY);
+    s_ForgetEarlyAcks(index);
+    xSemaphoreGive(s_d_state.inflight_lock);
+    xTaskNotify(s_d_state.control_task, MQTT_CTL_BROKERS, eSetBits);
     break;
 
   case MQTT_EVENT_SUBSCRIBED:
-    ESP_LOGI(s_TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
+    DLOGI(s_TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
     break;
 
   case MQTT_EVENT_UNSUBSCRIBED:
-    ESP_LOGI(s_TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
+    DLOGI(s_TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
     break;
 
   case MQTT_EVENT_PUBLISHED:
-    ESP_LOGI(s_TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+    DLOGD(s_TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+    s_ResolveInflight(s_MatchAck, &(ack_key){event->msg_id, index}, ESP_OK, true);
+    break;
+
+  case MQTT_EVENT_DELETED:
+    /* Dropped from the outbox after too many retransmissions. */
+    DLOGW(s_TAG, "MQTT_EVENT_DELETED, msg_id=%d", event->msg_id);
+    s_ResolveInflight(s_MatchAck, &(ack_key){event->msg_id, index}, ESP_FAIL, false);
     break;
 
   case MQTT_EVENT_DATA:
-    ESP_LOGI(s_TAG, "MQTT_EVENT_DATA");
-    current = s_d_state.head;
-    while (current != s_d_state.tail) {
-        if (!strncmp(event->topic, current->topic, event->topic_len)) {
-          if (current->callback)
-            current->callback(event->data, event->data_len, current->user_ctx);
-          break;
-        }
-        current = current->next;
-    }
+    DLOGI(s_TAG, "MQTT_EVENT_DATA, msg_id=%d len=%d", event->msg_id, event->data_len);
+    /* A standby broker only delivers what was published before failover. */
+    if (index != s_d_state.active)
+      break;
+    s_Deliver(b, event);
     break;
 
   case MQTT_EVENT_ERROR:
@@ -141,9 +1134,14 @@ static void s_MqttEventHandler(void *handler_args, esp_event_base_t base, int32_
     break;
 
   default:
-    ESP_LOGI(s_TAG, "Other event id:%d", event->event_id);
+    DLOGI(s_TAG, "Other event id:%d", event->event_id);
     break;
   }
+#ifdef CONFIG_MQTT_LINK_PROBE
+  if (busy)
+    s_ProbeDispatch(false);
+#endif
+  TRACE_END(MQTT_EVENT, event_id);
 }
 
 esp_err_t MqttInit(void) {
@@ -152,80 +1150,779 @@ esp_err_t MqttInit(void) {
     return s_d_state.rc = ESP_ERR_INVALID_STATE;
   }
 
-  const esp_mqtt_client_config_t mqtt_cfg = {
+  esp_mqtt_client_config_t mqtt_cfg = {
     .broker = {
       .address.uri = CONFIG_MQTT_BROKER_URI,
+#ifdef CONFIG_MQTT_TLS_VERIFY_PINNED_CA
+      .verification.certificate = mqtt_broker_ca_pem_start,
+#else
       .verification.crt_bundle_attach = esp_crt_bundle_attach,
+#endif
 //      .verification.skip_cert_common_name_check = true
     },
     .credentials = {
       .username = CONFIG_MQTT_USERNAME,
       .authentication.password = CONFIG_MQTT_PASSWORD,
       .set_null_client_id = MQTT_NULL_CLIENT_ID
-    }
+    },
+    .session.protocol_ver = MQTT_PROTOCOL_VERSION,
+#ifdef CONFIG_MQTT_LINK_PROBE
+    .session.keepalive = CONFIG_MQTT_KEEPALIVE_MIN_S,
+#endif
+    .network.reconnect_timeout_ms = CONFIG_MQTT_RECONNECT_TIMEOUT_MS
   };
+  s_d_state.config = mqtt_cfg;
 
-  s_d_state.client = esp_mqtt_client_init(&mqtt_cfg);
-  if (!s_d_state.client) {
-    return s_d_state.rc = ESP_FAIL;
+  s_d_state.events = xEventGroupCreate();
+  s_d_state.publish_lock = xSemaphoreCreateMutex();
+  s_d_state.inflight_lock = xSemaphoreCreateMutex();
+  s_d_state.window = xSemaphoreCreateCounting(CONFIG_MQTT_INFLIGHT_WINDOW, CONFIG_MQTT_INFLIGHT_WINDOW);
+  s_d_state.sub_lock = xSemaphoreCreateMutex();
+  if (!s_d_state.events || !s_d_state.publish_lock || !s_d_state.inflight_lock ||
+      !s_d_state.window || !s_d_state.sub_lock) {
+    return s_d_state.rc = ESP_ERR_NO_MEM;
   }
 
-  /* The last argument may be used to pass data to the event handler, in this example s_MqttEventHandler */
-  s_d_state.rc = esp_mqtt_client_register_event(s_d_state.client, ESP_EVENT_ANY_ID, s_MqttEventHandler, NULL);
-  if (s_d_state.rc)
+  const esp_timer_create_args_t ack_timer = {
+    .callback = s_AckTimer,
+    .name = "mqtt_acks",
+  };
+  if ((s_d_state.rc = esp_timer_create(&ack_timer, &s_d_state.ack_timer)))
     return s_d_state.rc;
-
-  s_d_state.rc = esp_mqtt_client_start(s_d_state.client);
-  if (s_d_state.rc)
+#ifdef CONFIG_MQTT_LINK_PROBE
+  if ((s_d_state.rc = s_ProbeInit()))
     return s_d_state.rc;
+#endif
 
-  s_d_state.head = (subscriptions*) calloc(1, sizeof(subscriptions));
-  if (!s_d_state.head)
-    return ESP_ERR_NO_MEM;
+  /* Primary broker first, then the comma separated fallbacks. */
+  s_d_state.brokers[0].uri = CONFIG_MQTT_BROKER_URI;
+  s_d_state.num_brokers = 1;
+  strcpy(s_d_state.uri_list, CONFIG_MQTT_BROKER_URI_FALLBACK);
+  char *save = NULL;
+  for (char *uri = strtok_r(s_d_state.uri_list, ", ", &save);
+       uri && s_d_state.num_brokers < MQTT_MAX_BROKERS; uri = strtok_r(NULL, ", ", &save))
+    s_d_state.brokers[s_d_state.num_brokers++].uri = uri;
+
+  for (unsigned i = 0; i < s_d_state.num_brokers; i++) {
+    mqtt_cfg.broker.address.uri = s_d_state.brokers[i].uri;
+    s_d_state.brokers[i].client = esp_mqtt_client_init(&mqtt_cfg);
+    if (!s_d_state.brokers[i].client) {
+      return s_d_state.rc = ESP_FAIL;
+    }
 
-  s_d_state.tail = s_d_state.head;
+    /* The broker index is passed to s_MqttEventHandler, to tell events of the
+     * active broker from those of standby ones. */
+    s_d_state.rc = esp_mqtt_client_register_event(s_d_state.brokers[i].client, ESP_EVENT_ANY_ID,
+                                                  s_MqttEventHandler, (void*)(uintptr_t) i);
+    if (s_d_state.rc)
+      return s_d_state.rc;
+  }
+  s_d_state.active = 0;
+  s_d_state.client = s_d_state.brokers[0].client;
+  if ((s_d_state.rc = s_InitLanes()))
+    return s_d_state.rc;
+  if (xTaskCreate(s_ControlTask, "mqtt_ctl", CONFIG_MQTT_CONTROL_TASK_STACK_SIZE, NULL,
+                  CONFIG_MQTT_CONTROL_TASK_PRIORITY, &s_d_state.control_task) != pdPASS)
+    return s_d_state.rc = ESP_ERR_NO_MEM;
   s_d_state.initialised = true;
+#ifdef CONFIG_MQTT_LINK_PROBE
+  if ((s_d_state.rc = s_Subscribe(s_d_state.probe.topic,
+                                  &(subscribe_spec){ .callback = s_ProbeEcho }, NULL, 0)))
+    return s_d_state.rc;
+#endif
+
+  s_StartBroker(0);
+  if (!s_d_state.brokers[0].started)
+    return s_d_state.rc = ESP_FAIL;
+#ifdef CONFIG_MQTT_WARM_STANDBY
+  if (s_d_state.num_brokers > 1)
+    s_StartBroker(1);
+#endif
   return ESP_OK;
 }
 
-esp_err_t MqttPublish(const char *topic, const char *message, int len, int qos, int retain) {
+#ifdef CONFIG_MQTT_MANAGER_PROTOCOL_V5
+/*
+ * @brief Find the alias entry of a topic, recording one more publish to it.
+ *
+ *  Topics reaching CONFIG_MQTT_TOPIC_ALIAS_THRESHOLD publishes get an alias
+ *  while there are aliases left. Must be called with publish_lock held.
+ *
+ * @return the entry if the topic has an alias, NULL otherwise.
+ */
+static topic_alias *s_TopicAlias(const char *topic) {
+
+  uint32_t hash = 2166136261u;
+  for (const char *c = topic; *c; c++)
+    hash = (hash ^ (uint8_t) *c) * 16777619u;
+
+  topic_alias *entry = NULL, *victim = NULL;
+  for (int i = 0; i < MQTT_ALIAS_CANDIDATES; i++) {
+    topic_alias *a = &s_d_state.aliases[i];
+    if (a->count && a->hash == hash && !strcmp(a->topic, topic)) {
+      entry = a;
+      break;
+    }
+    if (!a->alias && (!victim || a->count < victim->count))
+      victim = a;
+  }
+
+  if (!entry) {
+    if (!victim || strlen(topic) > CONFIG_MQTT_SUB_TOPIC_MAX_LEN)
+      return NULL;
+    entry = victim;
+    entry->hash = hash;
+    entry->count = 0;
+    entry->announced = false;
+    strcpy(entry->topic, topic);
+  }
+
+  if (entry->count < UINT16_MAX)
+    entry->count++;
+  if (!entry->alias && entry->count >= CONFIG_MQTT_TOPIC_ALIAS_THRESHOLD &&
+      s_d_state.next_alias < CONFIG_MQTT_TOPIC_ALIAS_MAX)
+    entry->alias = ++s_d_state.next_alias;
+  return entry->alias ? entry : NULL;
+}
+#endif
+
+/*
+ * @brief Publish on the active broker.
+ *
+ * @param msg_id if not NULL, receives the id of the message, 0 for QoS 0.
+ */
+static esp_err_t s_Publish(const char *topic, const char *message, int len, int qos, int retain,
+                           const mqtt_publish_props *props, int *msg_id) {
 
   if (!s_d_state.initialised)
     return ESP_ERR_INVALID_STATE;
 
-  esp_err_t rc = esp_mqtt_client_publish(s_d_state.client, topic, message, len, qos, retain);
+#ifdef CONFIG_MQTT_MANAGER_PROTOCOL_V5
+  if (props && props->num_user_properties > MQTT_MAX_USER_PROPERTIES)
+    return ESP_ERR_INVALID_ARG;
+
+  esp_mqtt5_publish_property_config_t property = {0};
+  esp_mqtt5_user_property_item_t items[MQTT_MAX_USER_PROPERTIES];
+  const char *wire_topic = topic;
+  topic_alias *alias = NULL;
+  int rc;
+
+  xSemaphoreTake(s_d_state.publish_lock, portMAX_DELAY);
+
+  /* QoS 0 only: a QoS 1/2 message may be retransmitted on a later
+   * connection, where its alias means nothing. */
+  if (!qos && !s_d_state.aliases_refused &&
+      (xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT))
+    alias = s_TopicAlias(topic);
+  if (alias) {
+    property.topic_alias = alias->alias;
+    if (alias->announced)
+      wire_topic = "";
+  }
+
+  if (props) {
+    property.message_expiry_interval = props->message_expiry_interval;
+    for (unsigned i = 0; i < props->num_user_properties; i++) {
+      items[i].key = props->user_properties[i].key;
+      items[i].value = props->user_properties[i].value;
+    }
+    if (props->num_user_properties &&
+        esp_mqtt5_client_set_user_property(&property.user_property, items,
+                                           props->num_user_properties) != ESP_OK) {
+      xSemaphoreGive(s_d_state.publish_lock);
+      return ESP_ERR_NO_MEM;
+    }
+  }
+
+  if (esp_mqtt5_client_set_publish_property(s_d_state.client, &property) == ESP_OK) {
+    rc = esp_mqtt_client_publish(s_d_state.client, wire_topic, message, len, qos, retain);
+  } else {
+    rc = -1;
+  }
+
+  if (alias && rc < 0) {
+    /* Most likely the broker's Topic Alias Maximum is lower than ours. Stop
+     * aliasing until the next connection and send the full topic. */
+    ESP_LOGW(s_TAG, "Topic alias %u refused, disabling aliases", alias->alias);
+    s_d_state.aliases_refused = true;
+    property.topic_alias = 0;
+    if (esp_mqtt5_client_set_publish_property(s_d_state.client, &property) == ESP_OK)
+      rc = esp_mqtt_client_publish(s_d_state.client, topic, message, len, qos, retain);
+  } else if (alias) {
+    alias->announced = true;
+  }
+
+  if (property.user_property)
+    esp_mqtt5_client_delete_user_property(property.user_property);
+  xSemaphoreGive(s_d_state.publish_lock);
+#else
+  if (props && (props->message_expiry_interval || props->num_user_properties))
+    return ESP_ERR_NOT_SUPPORTED;
+
+  int rc = esp_mqtt_client_publish(s_d_state.client, topic, message, len, qos, retain);
+#endif
   if (rc < 0)
     return ESP_FAIL;
+  if (msg_id)
+    *msg_id = rc;
   return ESP_OK;
 }
 
-esp_err_t MqttSubscribe(const char *topic, int qos, mqtt_subscription_cb callback, void *user_ctx) {
+esp_err_t MqttPublish(const char *topic, const char *message, int len, int qos, int retain) {
+
+  return MqttPublishLane(MQTT_LANE_INTERACTIVE, topic, message, len, qos, retain);
+}
+
+esp_err_t MqttPublishEx(const char *topic, const char *message, int len, int qos, int retain,
+                        const mqtt_publish_props *props) {
+
+  return s_Publish(topic, message, len, qos, retain, props, NULL);
+}
+
+/*
+ * @brief Is the caller a client task, which acknowledgements wait for, or the
+ * control task, which failover waits for? Neither may block on the window.
+ */
+static bool s_InManagerTask(void) {
+
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  if (self == s_d_state.control_task)
+    return true;
+  for (unsigned i = 0; i < s_d_state.num_brokers; i++) {
+    if (s_d_state.brokers[i].task == self)
+      return true;
+  }
+  return false;
+}
+
+esp_err_t MqttPublishAsync(const char *topic, const char *message, int len, int qos, int retain,
+                           uint32_t timeout_ms, mqtt_publish_cb callback, void *user_ctx) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  esp_err_t rc;
+  if (!qos) {
+    /* Nothing will be acknowledged, done once handed to the client. */
+    if (!(rc = s_Publish(topic, message, len, qos, retain, NULL, NULL)) && callback)
+      callback(ESP_OK, user_ctx);
+    return rc;
+  }
+
+  TickType_t wait = s_InManagerTask() ? 0 : pdMS_TO_TICKS(timeout_ms);
+  if (xSemaphoreTake(s_d_state.window, wait) != pdTRUE) {
+    s_d_state.publish_stats.window_full++;
+    return ESP_ERR_TIMEOUT;
+  }
+
+  /* Reserve a slot first: the acknowledgement may be handled by the MQTT
+   * task before esp_mqtt_client_publish() returns the msg_id. */
+  inflight *entry = NULL;
+  xSemaphoreTake(s_d_state.inflight_lock, portMAX_DELAY);
+  for (int i = 0; i < CONFIG_MQTT_INFLIGHT_WINDOW && !entry; i++) {
+    if (!s_d_state.inflight[i].msg_id)
+      entry = &s_d_state.inflight[i];
+  }
+  entry->msg_id = MQTT_MSG_ID_PENDING;
+  entry->broker = s_d_state.active;
+  entry->deadline = esp_timer_get_time() + (int64_t) timeout_ms * 1000;
+  entry->callback = callback;
+  entry->user_ctx = user_ctx;
+  xSemaphoreGive(s_d_state.inflight_lock);
+
+  int msg_id = 0;
+  rc = s_Publish(topic, message, len, qos, retain, NULL, &msg_id);
+
+  bool acked = false;
+  xSemaphoreTake(s_d_state.inflight_lock, portMAX_DELAY);
+  if (!rc) {
+    entry->msg_id = msg_id;
+    for (int i = 0; i < MQTT_EARLY_ACKS; i++) {
+      ack_key *key = &s_d_state.early_acks[i];
+      if (key->msg_id == msg_id && key->broker == entry->broker) {
+        key->msg_id = 0;
+        acked = true;
+      }
+    }
+  }
+  if (rc || acked) {
+    entry->msg_id = 0;
+    xSemaphoreGive(s_d_state.window);
+  }
+  /* With no other call returning, what is left belongs to no publish, e.g. a
+   * late ack of one which timed out; kept, it could match a reused msg_id. */
+  bool returning = false;
+  for (int i = 0; i < CONFIG_MQTT_INFLIGHT_WINDOW; i++) {
+    if (s_d_state.inflight[i].msg_id == MQTT_MSG_ID_PENDING)
+      returning = true;
+  }
+  if (!returning)
+    s_ForgetEarlyAcks(MQTT_MAX_BROKERS);
+  if (!rc && !acked) {
+    unsigned in_flight = CONFIG_MQTT_INFLIGHT_WINDOW - uxSemaphoreGetCount(s_d_state.window);
+    if (in_flight > s_d_state.publish_stats.max_in_flight)
+      s_d_state.publish_stats.max_in_flight = in_flight;
+    if (!esp_timer_is_active(s_d_state.ack_timer))
+      esp_timer_start_periodic(s_d_state.ack_timer, MQTT_ACK_CHECK_PERIOD_US);
+  }
+  if (acked)
+    s_d_state.publish_stats.acked++;
+  xSemaphoreGive(s_d_state.inflight_lock);
+
+  if (acked && callback)
+    callback(ESP_OK, user_ctx);
+  return rc;
+}
+
+/*
+ * @brief Add the tokens earned since the last refill. A lane with nothing
+ * queued may save up at most one second of its share.
+ */
+static void s_RefillLanes(void) {
+
+  int64_t now = esp_timer_get_time();
+  int64_t elapsed = now - s_d_state.lanes_refill;
+  s_d_state.lanes_refill = now;
+
+  for (int i = MQTT_LANE_BULK; i < MQTT_NUM_LANES; i++) {
+    lane *l = &s_d_state.lanes[i];
+    l->tokens += l->rate * elapsed / 1000000;
+    if (l->tokens > l->rate)
+      l->tokens = l->rate;
+  }
+}
+
+/*
+ * @brief Count a publish attempt of a lane; failures only while connected.
+ */
+static void s_LaneCount(lane *l, esp_err_t rc, int len) {
+
+  xSemaphoreTake(s_d_state.lanes_lock, portMAX_DELAY);
+  if (!rc) {
+    l->stats.sent++;
+    l->stats.bytes += len;
+  } else {
+    l->stats.failed++;
+  }
+  xSemaphoreGive(s_d_state.lanes_lock);
+}
+
+/*
+ * @brief Drains the queued lanes at a low priority, so any task publishing
+ * interactive traffic runs first. Each lane spends its own token bucket; bulk
+ * is served before diagnostics when both have tokens.
+ */
+static void s_LaneTask(void *args) {
+
+  TickType_t wait = portMAX_DELAY;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, wait);
+    xEventGroupWaitBits(s_d_state.events, MQTT_CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    s_RefillLanes();
+
+    bool backlog = false;
+    for (int i = MQTT_LANE_BULK; i < MQTT_NUM_LANES; i++) {
+      lane *l = &s_d_state.lanes[i];
+      lane_msg *msg;
+      while (l->tokens > 0 && xQueuePeek(l->queue, &msg, 0) == pdTRUE) {
+        const char *topic = msg->data;
+        const char *payload = topic + strlen(topic) + 1;
+        esp_err_t rc;
+        if (msg->callback)
+          rc = MqttPublishAsync(topic, payload, msg->len, msg->qos, msg->retain, msg->timeout_ms,
+                                msg->callback, msg->user_ctx);
+        else
+          rc = s_Publish(topic, payload, msg->len, msg->qos, msg->retain, NULL, NULL);
+        if (rc == ESP_ERR_TIMEOUT)
+          break;  /* The in-flight window stayed full, try again later. */
+        if (rc && !(xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT))
+          break;  /* Lost the connection, keep it for the next one. */
+        /* Refused while connected, e.g. a full outbox or an oversized message:
+         * retrying would stall the lane behind it. */
+        xQueueReceive(l->queue, &msg, 0);
+        l->tokens -= msg->len;
+        s_LaneCount(l, rc, msg->len);
+        if (rc) {
+          ESP_LOGW(s_TAG, "Lane %d publish to %s failed", i, topic);
+          if (msg->callback)
+            msg->callback(ESP_FAIL, msg->user_ctx);
+        }
+        free(msg);
+      }
+      if (uxQueueMessagesWaiting(l->queue))
+        backlog = true;
+    }
+    wait = backlog ? pdMS_TO_TICKS(MQTT_LANE_RETRY_MS) ?: 1 : portMAX_DELAY;
+  }
+}
+
+static esp_err_t s_InitLanes(void) {
+
+  const int depth[MQTT_NUM_LANES] = { 0, CONFIG_MQTT_LANE_BULK_DEPTH, CONFIG_MQTT_LANE_DIAG_DEPTH };
+  const int share[MQTT_NUM_LANES] = { 0, CONFIG_MQTT_LANE_BULK_SHARE, CONFIG_MQTT_LANE_DIAG_SHARE };
+
+  s_d_state.lanes_lock = xSemaphoreCreateMutex();
+  if (!s_d_state.lanes_lock)
+    return ESP_ERR_NO_MEM;
+  for (int i = MQTT_LANE_BULK; i < MQTT_NUM_LANES; i++) {
+    lane *l = &s_d_state.lanes[i];
+    l->queue = xQueueCreate(depth[i], sizeof(lane_msg*));
+    if (!l->queue)
+      return ESP_ERR_NO_MEM;
+    l->rate = (int64_t) CONFIG_MQTT_LANE_BANDWIDTH * share[i] / 100;
+    l->tokens = l->rate;
+  }
+  s_d_state.lanes_refill = esp_timer_get_time();
+
+  if (xTaskCreate(s_LaneTask, "mqtt_lanes", CONFIG_MQTT_LANE_TASK_STACK_SIZE, NULL,
+                  CONFIG_MQTT_LANE_TASK_PRIORITY, &s_d_state.lane_task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+  return ESP_OK;
+}
+
+esp_err_t MqttPublishLane(mqtt_lane lane_id, const char *topic, const char *message, int len,
+                          int qos, int retain) {
+
+  return MqttPublishLaneAsync(lane_id, topic, message, len, qos, retain, 0, NULL, NULL);
+}
+
+esp_err_t MqttPublishLaneAsync(mqtt_lane lane_id, const char *topic, const char *message, int len,
+                               int qos, int retain, uint32_t timeout_ms, mqtt_publish_cb callback,
+                               void *user_ctx) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (lane_id >= MQTT_NUM_LANES)
+    return ESP_ERR_INVALID_ARG;
+
+  if (!len)
+    len = strlen(message);
+  lane *l = &s_d_state.lanes[lane_id];
+
+  if (lane_id == MQTT_LANE_INTERACTIVE) {
+    esp_err_t rc;
+    if (callback)
+      rc = MqttPublishAsync(topic, message, len, qos, retain, timeout_ms, callback, user_ctx);
+    else
+      rc = s_Publish(topic, message, len, qos, retain, NULL, NULL);
+    if (!rc || xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT)
+      s_LaneCount(l, rc, len);
+    return rc;
+  }
+
+  /* Never blocks: the caller may be the MQTT task republishing on connect,
+   * which the lane task needs to publish. */
+  unsigned topic_len = strlen(topic) + 1;
+  lane_msg *msg = malloc(sizeof(lane_msg) + topic_len + len);
+  if (!msg)
+    return ESP_ERR_NO_MEM;
+  msg->len = len;
+  msg->qos = qos;
+  msg->retain = retain;
+  msg->timeout_ms = timeout_ms;
+  msg->callback = callback;
+  msg->user_ctx = user_ctx;
+  memcpy(msg->data, topic, topic_len);
+  memcpy(msg->data + topic_len, message, len);
+
+  bool queued = xQueueSend(l->queue, &msg, 0) == pdTRUE;
+  unsigned depth = uxQueueMessagesWaiting(l->queue);
+  xSemaphoreTake(s_d_state.lanes_lock, portMAX_DELAY);
+  if (!queued)
+    l->stats.dropped++;
+  else if (depth > l->stats.max_depth)
+    l->stats.max_depth = depth;
+  xSemaphoreGive(s_d_state.lanes_lock);
+  if (!queued) {
+    free(msg);
+    return ESP_ERR_NO_MEM;
+  }
+  xTaskNotifyGive(s_d_state.lane_task);
+  return ESP_OK;
+}
+
+esp_err_t MqttGetLaneStats(mqtt_lane lane_id, mqtt_lane_stats *stats) {
 
   if (!s_d_state.initialised)
     return ESP_ERR_INVALID_STATE;
+  if (lane_id >= MQTT_NUM_LANES || !stats)
+    return ESP_ERR_INVALID_ARG;
+
+  lane *l = &s_d_state.lanes[lane_id];
+  xSemaphoreTake(s_d_state.lanes_lock, portMAX_DELAY);
+  *stats = l->stats;
+  xSemaphoreGive(s_d_state.lanes_lock);
+  stats->depth = l->queue ? uxQueueMessagesWaiting(l->queue) : 0;
+  return ESP_OK;
+}
+
+typedef struct {
+  SemaphoreHandle_t done;
+  esp_err_t result;
+} publish_waiter;
+
+static void s_PublishDone(esp_err_t result, void *user_ctx) {
+
+  publish_waiter *waiter = user_ctx;
+  waiter->result = result;
+  xSemaphoreGive(waiter->done);
+}
+
+esp_err_t MqttPublishWait(const char *topic, const char *message, int len, int qos, int retain,
+                          uint32_t timeout_ms) {
+
+  /* The acknowledgement would never be read, or failover would wait for it. */
+  if (s_InManagerTask())
+    return ESP_ERR_INVALID_STATE;
 
-  if (!s_d_state.tail)
+  publish_waiter waiter = { .done = xSemaphoreCreateBinary() };
+  if (!waiter.done)
     return ESP_ERR_NO_MEM;
 
-  unsigned topic_len = strlen(topic);
-  if (topic_len > CONFIG_MQTT_SUB_TOPIC_MAX_LEN)
+  esp_err_t rc = MqttPublishAsync(topic, message, len, qos, retain, timeout_ms, s_PublishDone,
+                                  &waiter);
+  /* Every accepted publish is resolved, by its deadline at the latest. */
+  if (!rc) {
+    xSemaphoreTake(waiter.done, portMAX_DELAY);
+    rc = waiter.result;
+  }
+  vSemaphoreDelete(waiter.done);
+  return rc;
+}
+
+esp_err_t MqttGetPublishStats(mqtt_publish_stats *stats) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!stats)
     return ESP_ERR_INVALID_ARG;
 
-  topic_len++;
-  s_d_state.tail->topic = (char*) malloc(topic_len);
+  xSemaphoreTake(s_d_state.inflight_lock, portMAX_DELAY);
+  *stats = s_d_state.publish_stats;
+  stats->in_flight = CONFIG_MQTT_INFLIGHT_WINDOW - uxSemaphoreGetCount(s_d_state.window);
+  xSemaphoreGive(s_d_state.inflight_lock);
+  return ESP_OK;
+}
+
+/*
+ * @brief Add a subscription to the pool and subscribe on the active broker.
+ * While disconnected it is only added, s_Activate() subscribes on connection.
+ */
+static esp_err_t s_Subscribe(const char *topic, const subscribe_spec *spec, const void *ctx,
+                             size_t ctx_size) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  if (strlen(topic) > CONFIG_MQTT_SUB_TOPIC_MAX_LEN || ctx_size > CONFIG_MQTT_SUB_CTX_SIZE)
+    return ESP_ERR_INVALID_ARG;
 
-  if (!s_d_state.tail->topic)
+  xSemaphoreTake(s_d_state.sub_lock, portMAX_DELAY);
+  subscriptions *entry = NULL;
+  for (unsigned i = 0; i < CONFIG_MQTT_MAX_SUBSCRIPTIONS && !entry; i++) {
+    if (!s_d_state.subscriptions[i].in_use)
+      entry = &s_d_state.subscriptions[i];
+  }
+  if (!entry) {
+    xSemaphoreGive(s_d_state.sub_lock);
     return ESP_ERR_NO_MEM;
+  }
+
+  strcpy(entry->topic, topic);
+  entry->qos = spec->qos;
+  entry->no_local = spec->no_local;
+  entry->live = spec->live;
+  entry->callback = spec->callback;
+  entry->topic_callback = spec->topic_callback;
+  entry->fragment_callback = spec->fragment_callback;
+  if (ctx_size) {
+    memcpy(entry->ctx.bytes, ctx, ctx_size);
+    entry->user_ctx = entry->ctx.bytes;
+  } else {
+    entry->user_ctx = spec->user_ctx;
+  }
+  entry->in_use = true;
 
-  if (esp_mqtt_client_subscribe(s_d_state.client, topic, qos) < 0) {
-    free (s_d_state.tail->topic);
+  unsigned index = entry - s_d_state.subscriptions;
+  if (index >= s_d_state.num_subscriptions)
+    s_d_state.num_subscriptions = index + 1;
+
+  unsigned used = 0;
+  for (unsigned i = 0; i < s_d_state.num_subscriptions; i++)
+    used += s_d_state.subscriptions[i].in_use;
+  if (used > s_d_state.max_subscriptions_used)
+    s_d_state.max_subscriptions_used = used;
+
+  /* Read under the lock: either s_Activate() renews the entry or the bit is
+   * already set and it is subscribed here, on the current connection. */
+  bool connected = xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT;
+  entry->sent_on = connected ? s_d_state.connection : 0;
+  subscriptions copy = *entry;
+  xSemaphoreGive(s_d_state.sub_lock);
+
+  if (connected && s_SendSubscribe(&copy) < 0) {
+    xSemaphoreTake(s_d_state.sub_lock, portMAX_DELAY);
+    entry->in_use = false;
+    while (s_d_state.num_subscriptions &&
+           !s_d_state.subscriptions[s_d_state.num_subscriptions - 1].in_use)
+      s_d_state.num_subscriptions--;
+    xSemaphoreGive(s_d_state.sub_lock);
     return ESP_FAIL;
   }
+  return ESP_OK;
+}
+
+esp_err_t MqttSubscribe(const char *topic, int qos, mqtt_subscription_cb callback, void *user_ctx) {
+
+  return s_Subscribe(topic, &(subscribe_spec){ .qos = qos, .callback = callback,
+                                              .user_ctx = user_ctx }, NULL, 0);
+}
+
+esp_err_t MqttSubscribeFilter(const char *filter, int qos, mqtt_topic_cb callback, void *user_ctx) {
+
+  if (!callback)
+    return ESP_ERR_INVALID_ARG;
+  return s_Subscribe(filter, &(subscribe_spec){ .qos = qos, .no_local = true,
+                                               .topic_callback = callback,
+                                               .user_ctx = user_ctx }, NULL, 0);
+}
+
+esp_err_t MqttSubscribeCtx(const char *topic, int qos, mqtt_subscription_cb callback,
+                           const void *ctx, size_t ctx_size) {
 
-  strncpy(s_d_state.tail->topic, topic, topic_len);
-  s_d_state.tail->callback = callback;
-  s_d_state.tail->user_ctx = user_ctx;
-  s_d_state.tail->next = (subscriptions*) calloc(1, sizeof(subscriptions));
-  s_d_state.tail = s_d_state.tail->next;
+  if (ctx_size && !ctx)
+    return ESP_ERR_INVALID_ARG;
+  return s_Subscribe(topic, &(subscribe_spec){ .qos = qos, .callback = callback }, ctx,
+                     ctx_size);
+}
+
+esp_err_t MqttSubscribeFragments(const char *topic, int qos, mqtt_fragment_cb callback,
+                                 void *user_ctx) {
+
+  if (!callback)
+    return ESP_ERR_INVALID_ARG;
+  return s_Subscribe(topic, &(subscribe_spec){ .qos = qos, .fragment_callback = callback,
+                                              .user_ctx = user_ctx }, NULL, 0);
+}
+
+esp_err_t MqttSubscribeLive(const char *topic, int qos, mqtt_subscription_cb callback,
+                            void *user_ctx) {
+
+  return s_Subscribe(topic, &(subscribe_spec){ .qos = qos, .live = true, .callback = callback,
+                                              .user_ctx = user_ctx }, NULL, 0);
+}
+
+esp_err_t MqttUnsubscribe(const char *topic) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!topic)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(s_d_state.sub_lock, portMAX_DELAY);
+  subscriptions *entry = NULL;
+  bool shared = false;
+  for (unsigned i = 0; i < s_d_state.num_subscriptions; i++) {
+    subscriptions *s = &s_d_state.subscriptions[i];
+    if (!s->in_use || strcmp(s->topic, topic))
+      continue;
+    if (entry)
+      shared = true;
+    else
+      entry = s;
+  }
+  if (!entry) {
+    xSemaphoreGive(s_d_state.sub_lock);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  /* The event handler dispatches from a copy, so the slot is free for the
+   * next subscription at once; a message being dispatched may still reach
+   * the callback after this returns. */
+  entry->in_use = false;
+  while (s_d_state.num_subscriptions &&
+         !s_d_state.subscriptions[s_d_state.num_subscriptions - 1].in_use)
+    s_d_state.num_subscriptions--;
+  xSemaphoreGive(s_d_state.sub_lock);
+
+  /* Another entry with the same filter still needs the broker subscription. */
+  if (!shared && (xEventGroupGetBits(s_d_state.events) & MQTT_CONNECTED_BIT) &&
+      esp_mqtt_client_unsubscribe(s_d_state.client, topic) < 0)
+    return ESP_FAIL;
+  return ESP_OK;
+}
+
+esp_err_t MqttWaitConnected(uint32_t timeout_ms) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  EventBits_t bits = xEventGroupWaitBits(s_d_state.events, MQTT_CONNECTED_BIT, pdFALSE, pdTRUE,
+                                         pdMS_TO_TICKS(timeout_ms));
+  if (!(bits & MQTT_CONNECTED_BIT))
+    return ESP_ERR_TIMEOUT;
+  return ESP_OK;
+}
+
+esp_err_t MqttSetConnectedCallback(mqtt_connected_cb callback, void *user_ctx) {
+
+  s_d_state.connected_cb = callback;
+  s_d_state.connected_ctx = user_ctx;
   return ESP_OK;
 }
+
+esp_err_t MqttGetFailoverStats(mqtt_failover_stats *stats) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!stats)
+    return ESP_ERR_INVALID_ARG;
+
+  *stats = s_d_state.stats;
+  return ESP_OK;
+}
+
+esp_err_t MqttGetConnectStats(mqtt_connect_stats *stats) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!stats)
+    return ESP_ERR_INVALID_ARG;
+
+  *stats = s_d_state.connect_stats;
+  return ESP_OK;
+}
+
+esp_err_t MqttGetSubscriptionStats(mqtt_subscription_stats *stats) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!stats)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(s_d_state.sub_lock, portMAX_DELAY);
+  stats->used = 0;
+  for (unsigned i = 0; i < s_d_state.num_subscriptions; i++)
+    stats->used += s_d_state.subscriptions[i].in_use;
+  stats->max_used = s_d_state.max_subscriptions_used;
+  xSemaphoreGive(s_d_state.sub_lock);
+  stats->size = CONFIG_MQTT_MAX_SUBSCRIPTIONS;
+  return ESP_OK;
+}
+
+esp_err_t MqttGetLinkStats(mqtt_link_stats *stats) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!stats)
+    return ESP_ERR_INVALID_ARG;
+
+#ifdef CONFIG_MQTT_LINK_PROBE
+  xSemaphoreTake(s_d_state.probe.lock, portMAX_DELAY);
+  *stats = s_d_state.probe.stats;
+  xSemaphoreGive(s_d_state.probe.lock);
+  return ESP_OK;
+#else
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
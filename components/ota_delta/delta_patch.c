@@ -0,0 +1,243 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file delta_patch.c
+ *
+ * @brief Streaming application of COPY/INSERT binary deltas.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <string.h>
+#include "delta_patch.h"
+
+enum {
+  DELTA_HEADER,
+  DELTA_OP,
+  DELTA_COPY_ARGS,
+  DELTA_INSERT_ARGS,
+  DELTA_INSERT_DATA,
+  DELTA_DONE,
+  DELTA_FAILED
+};
+
+#define DELTA_OP_COPY   'C'
+#define DELTA_OP_INSERT 'I'
+#define DELTA_OP_END    'E'
+
+static uint32_t s_U32(const uint8_t *data) {
+
+  return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t) data[3] << 24;
+}
+
+static void s_Expect(delta_patch *patch, int state, unsigned args) {
+
+  patch->state = state;
+  patch->args_len = 0;
+  patch->args_needed = args;
+}
+
+static esp_err_t s_Write(delta_patch *patch, const void *data, size_t len) {
+
+  if (len > patch->target_size - patch->written)
+    return ESP_ERR_INVALID_ARG;
+
+  esp_err_t rc = patch->write(data, len, patch->user_ctx);
+  if (rc)
+    return rc;
+  mbedtls_sha256_update(&patch->sha, data, len);
+  patch->written += len;
+  return ESP_OK;
+}
+
+/*
+ * @brief Hash the first source_size bytes of the source.
+ */
+static esp_err_t s_HashSource(delta_patch *patch, uint8_t digest[32]) {
+
+  mbedtls_sha256_context sha;
+  esp_err_t rc = ESP_OK;
+
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  for (uint32_t offset = 0; offset < patch->source_size && !rc; ) {
+    uint32_t len = patch->source_size - offset;
+    if (len > sizeof(patch->buffer))
+      len = sizeof(patch->buffer);
+    if (!(rc = patch->read(offset, patch->buffer, len, patch->user_ctx)))
+      mbedtls_sha256_update(&sha, patch->buffer, len);
+    offset += len;
+  }
+  mbedtls_sha256_finish(&sha, digest);
+  mbedtls_sha256_free(&sha);
+  return rc;
+}
+
+static esp_err_t s_Header(delta_patch *patch) {
+
+  uint8_t digest[32];
+  esp_err_t rc;
+
+  if (memcmp(patch->args, DELTA_PATCH_MAGIC, 4))
+    return ESP_ERR_INVALID_ARG;
+  patch->source_size = s_U32(patch->args + 4);
+  patch->target_size = s_U32(patch->args + 8);
+  memcpy(patch->target_sha, patch->args + 44, sizeof(patch->target_sha));
+
+  if ((rc = s_HashSource(patch, digest)))
+    return rc;
+  if (memcmp(digest, patch->args + 12, sizeof(digest)))
+    return ESP_ERR_INVALID_VERSION;
+
+  mbedtls_sha256_starts(&patch->sha, 0);
+  s_Expect(patch, DELTA_OP, 0);
+  return ESP_OK;
+}
+
+static esp_err_t s_Copy(delta_patch *patch) {
+
+  uint32_t offset = s_U32(patch->args);
+  uint32_t len = s_U32(patch->args + 4);
+  esp_err_t rc;
+
+  if (offset > patch->source_size || len > patch->source_size - offset ||
+      len > patch->target_size - patch->written)
+    return ESP_ERR_INVALID_ARG;
+
+  while (len) {
+    uint32_t chunk = len < sizeof(patch->buffer) ? len : sizeof(patch->buffer);
+    if ((rc = patch->read(offset, patch->buffer, chunk, patch->user_ctx)))
+      return rc;
+    if ((rc = s_Write(patch, patch->buffer, chunk)))
+      return rc;
+    offset += chunk;
+    len -= chunk;
+  }
+  s_Expect(patch, DELTA_OP, 0);
+  return ESP_OK;
+}
+
+static esp_err_t s_Insert(delta_patch *patch) {
+
+  patch->remaining = s_U32(patch->args);
+  if (patch->remaining > patch->target_size - patch->written)
+    return ESP_ERR_INVALID_ARG;
+  s_Expect(patch, patch->remaining ? DELTA_INSERT_DATA : DELTA_OP, 0);
+  return ESP_OK;
+}
+
+void DeltaPatchInit(delta_patch *patch, delta_read_cb read, delta_write_cb write, void *user_ctx) {
+
+  memset(patch, 0, offsetof(delta_patch, buffer));
+  patch->read = read;
+  patch->write = write;
+  patch->user_ctx = user_ctx;
+  patch->source_size = patch->target_size = patch->written = 0;
+  mbedtls_sha256_init(&patch->sha);
+  s_Expect(patch, DELTA_HEADER, DELTA_PATCH_HEADER_SIZE);
+}
+
+esp_err_t DeltaPatchFeed(delta_patch *patch, const void *data, size_t len) {
+
+  const uint8_t *in = data;
+  esp_err_t rc = ESP_OK;
+
+  while (len && !rc) {
+    switch (patch->state) {
+    case DELTA_HEADER:
+    case DELTA_COPY_ARGS:
+    case DELTA_INSERT_ARGS: {
+      size_t chunk = patch->args_needed - patch->args_len;
+      if (chunk > len)
+        chunk = len;
+      memcpy(patch->args + patch->args_len, in, chunk);
+      patch->args_len += chunk;
+      in += chunk;
+      len -= chunk;
+      if (patch->args_len < patch->args_needed)
+        break;
+      if (patch->state == DELTA_HEADER)
+        rc = s_Header(patch);
+      else if (patch->state == DELTA_COPY_ARGS)
+        rc = s_Copy(patch);
+      else
+        rc = s_Insert(patch);
+      break;
+    }
+
+    case DELTA_OP:
+      if (*in == DELTA_OP_COPY)
+        s_Expect(patch, DELTA_COPY_ARGS, 8);
+      else if (*in == DELTA_OP_INSERT)
+        s_Expect(patch, DELTA_INSERT_ARGS, 4);
+      else if (*in == DELTA_OP_END)
+        patch->state = DELTA_DONE;
+      else
+        rc = ESP_ERR_INVALID_ARG;
+      in++;
+      len--;
+      break;
+
+    case DELTA_INSERT_DATA: {
+      size_t chunk = patch->remaining < len ? patch->remaining : len;
+      if ((rc = s_Write(patch, in, chunk)))
+        break;
+      patch->remaining -= chunk;
+      in += chunk;
+      len -= chunk;
+      if (!patch->remaining)
+        s_Expect(patch, DELTA_OP, 0);
+      break;
+    }
+
+    case DELTA_DONE:
+      /* Nothing may follow the end marker. */
+      rc = ESP_ERR_INVALID_ARG;
+      break;
+
+    default:
+      return ESP_ERR_INVALID_STATE;
+    }
+  }
+
+  if (rc)
+    patch->state = DELTA_FAILED;
+  return rc;
+}
+
+esp_err_t DeltaPatchFinish(delta_patch *patch) {
+
+  uint8_t digest[32];
+
+  if (patch->state != DELTA_DONE || patch->written != patch->target_size)
+    return ESP_ERR_INVALID_SIZE;
+  mbedtls_sha256_finish(&patch->sha, digest);
+  if (memcmp(digest, patch->target_sha, sizeof(digest)))
+    return ESP_ERR_INVALID_CRC;
+  return ESP_OK;
+}
+
+void DeltaPatchFree(delta_patch *patch) {
+
+  mbedtls_sha256_free(&patch->sha);
+}
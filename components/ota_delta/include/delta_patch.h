@@ -0,0 +1,103 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file delta_patch.h
+ *
+ * @brief Streaming application of COPY/INSERT binary deltas.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * A patch, built by tools/mkdelta.py, rebuilds the target image from ranges
+ * of the source image and literal bytes. It is fed in pieces of any size and
+ * the target is written strictly in order, so it can go straight into an OTA
+ * partition; RAM use is this struct whatever the image and patch sizes.
+ *
+ * Format, little endian:
+ *   header  "FDP1", source size, target size, source SHA-256, target SHA-256
+ *   'C'     source offset (u32), length (u32): copy from the source
+ *   'I'     length (u32), bytes: insert literal bytes
+ *   'E'     end of patch
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "mbedtls/sha256.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DELTA_PATCH_MAGIC       "FDP1"
+#define DELTA_PATCH_HEADER_SIZE (4 + 4 + 4 + 32 + 32)
+
+/* Read source bytes at offset; write the next target bytes. */
+typedef esp_err_t (*delta_read_cb)(uint32_t offset, void *buffer, size_t len, void *user_ctx);
+typedef esp_err_t (*delta_write_cb)(const void *data, size_t len, void *user_ctx);
+
+typedef struct {
+/* Owned by the patch engine, do not touch. */
+  int state;
+  uint8_t args[DELTA_PATCH_HEADER_SIZE];
+  unsigned args_len;
+  unsigned args_needed;
+  uint32_t remaining;             /* bytes left in the current insert */
+  uint8_t target_sha[32];
+  mbedtls_sha256_context sha;
+  delta_read_cb read;
+  delta_write_cb write;
+  void *user_ctx;
+  uint8_t buffer[CONFIG_OTA_DELTA_BUFFER_SIZE];
+
+/* Read only progress. */
+  uint32_t source_size;
+  uint32_t target_size;
+  uint32_t written;
+} delta_patch;
+
+void DeltaPatchInit(delta_patch *patch, delta_read_cb read, delta_write_cb write, void *user_ctx);
+
+/**
+ * @brief Apply the next len bytes of the patch.
+ *
+ * Once the header is in, the source is hashed through the read callback and
+ * a patch built against another image fails with ESP_ERR_INVALID_VERSION.
+ * Malformed patches fail with ESP_ERR_INVALID_ARG; errors of the callbacks
+ * are returned as is. After an error the patch must be started again.
+ */
+esp_err_t DeltaPatchFeed(delta_patch *patch, const void *data, size_t len);
+
+/**
+ * @brief Check the patch ended and the target hash matches what was written:
+ * ESP_ERR_INVALID_SIZE if incomplete, ESP_ERR_INVALID_CRC on a hash mismatch.
+ */
+esp_err_t DeltaPatchFinish(delta_patch *patch);
+void DeltaPatchFree(delta_patch *patch);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
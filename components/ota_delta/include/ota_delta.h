@@ -0,0 +1,92 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ota_delta.h
+ *
+ * @brief Delta firmware updates over MQTT chunks or HTTP.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * A patch against the running image is applied while it arrives into the
+ * next OTA partition, then the target hash and the image are verified and
+ * the board boots the new partition. Topics, under franzininho-wifi/ota/:
+ *
+ *   begin   patch size in bytes, as text; starts an MQTT update
+ *   chunk   patch offset (u32, little endian) followed by patch bytes
+ *   url     https:// URL of a patch, downloaded by the device
+ *   status  published by the device: {"state":..,"offset":..,"size":..,"error":..}
+ *
+ * Every chunk is acknowledged on status with the next offset expected, so
+ * tools/mkdelta.py can send a window of chunks and resend from there. A chunk
+ * and its topic must fit the MQTT buffer, larger messages arrive truncated.
+ * The MQTT task only queues chunks, an OTA task applies and verifies them.
+ *
+ * Updates need CONFIG_OTA_DELTA, which requires signed app images: anyone
+ * able to publish on the topics can send a patch, only a signed result boots.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  unsigned updates;             /* patches applied */
+  unsigned failures;
+  uint32_t last_patch_bytes;
+  uint32_t last_image_bytes;
+  uint32_t last_update_ms;      /* begin to verified image */
+} ota_delta_stats;
+
+/**
+ * @brief Subscribe to the OTA topics. Without CONFIG_OTA_DELTA nothing is
+ * subscribed and the session calls return ESP_ERR_INVALID_STATE.
+ */
+esp_err_t OtaDeltaInit(void);
+
+/**
+ * @brief Confirm the running image, which cancels the rollback of a freshly
+ * updated one. Call it from the MQTT connected callback, so an image which
+ * never reaches the broker is still rolled back; later calls do nothing.
+ */
+esp_err_t OtaDeltaConfirm(void);
+
+/* Transport independent session, one at a time. size 0 means unknown. */
+esp_err_t OtaDeltaBegin(uint32_t size);
+esp_err_t OtaDeltaWrite(const void *data, size_t len);
+/* Verify the update and switch the boot partition. */
+esp_err_t OtaDeltaEnd(void);
+void OtaDeltaAbort(void);
+
+/* Download and apply a patch in the background, https:// only. */
+esp_err_t OtaDeltaStartHttp(const char *url);
+esp_err_t OtaDeltaGetStats(ota_delta_stats *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,504 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ota_delta.c
+ *
+ * @brief Delta firmware updates over MQTT chunks or HTTP.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "mqtt_manager.h"
+#include "timer_wheel.h"
+#include "delta_patch.h"
+#include "ota_delta.h"
+
+#define OTA_TOPIC(name) "franzininho-wifi/ota/" name
+
+/* HTTP downloads report their progress every this many bytes. */
+#define OTA_HTTP_PROGRESS_BYTES (32 * 1024)
+
+static const char *s_TAG = "OTA_DELTA";
+
+typedef enum {
+  OTA_MSG_BEGIN,
+  OTA_MSG_CHUNK,
+} ota_msg_type;
+
+/* A begin or chunk message, copied off the MQTT task */
+typedef struct {
+  ota_msg_type type;
+  uint32_t value;       /* Patch size for a begin, patch offset for a chunk */
+  size_t len;
+  uint8_t data[];
+} ota_msg;
+
+struct driver_state {
+
+/* Is driver initialised? */
+  bool initialised;
+
+/* Running image confirmed, set once from the MQTT connected callback */
+  bool confirmed;
+
+/* Serialises the session calls of the OTA task and the HTTP task */
+  SemaphoreHandle_t lock;
+
+/* MQTT sessions are applied by task, fed through queue */
+  QueueHandle_t queue;
+  TaskHandle_t task;
+
+/* Current session, patch is NULL while idle */
+  delta_patch *patch;
+  const esp_partition_t *running;
+  const esp_partition_t *update;
+  esp_ota_handle_t handle;
+  uint32_t size;
+  uint32_t received;
+  int64_t start_us;
+  bool mqtt_session;
+
+  TaskHandle_t http_task;
+  char url[CONFIG_OTA_DELTA_URL_MAX_LEN + 1];
+
+  timer_wheel_node reboot;
+  ota_delta_stats stats;
+};
+static struct driver_state s_d_state = {0};
+
+static void s_Status(const char *state, esp_err_t rc) {
+
+  char status[160];
+  snprintf(status, sizeof(status),
+           "{\"state\":\"%s\",\"offset\":%" PRIu32 ",\"size\":%" PRIu32 ",\"error\":\"%s\"}",
+           state, s_d_state.received, s_d_state.size, rc ? esp_err_to_name(rc) : "");
+  MqttPublish(OTA_TOPIC("status"), status, 0, 0, 0);
+}
+
+static esp_err_t s_ReadSource(uint32_t offset, void *buffer, size_t len, void *user_ctx) {
+
+  return esp_partition_read(s_d_state.running, offset, buffer, len);
+}
+
+static esp_err_t s_WriteTarget(const void *data, size_t len, void *user_ctx) {
+
+  return esp_ota_write(s_d_state.handle, data, len);
+}
+
+/*
+ * @brief Release the session, called with the lock held.
+ */
+static void s_Release(void) {
+
+  DeltaPatchFree(s_d_state.patch);
+  free(s_d_state.patch);
+  s_d_state.patch = NULL;
+  s_d_state.mqtt_session = false;
+}
+
+/*
+ * @brief Drop a failed session, called with the lock held.
+ */
+static esp_err_t s_Fail(esp_err_t rc, bool ota_open) {
+
+  if (ota_open)
+    esp_ota_abort(s_d_state.handle);
+  s_Release();
+  s_d_state.stats.failures++;
+  ESP_LOGE(s_TAG, "Update failed at patch offset %" PRIu32 ": %s", s_d_state.received,
+           esp_err_to_name(rc));
+  s_Status("error", rc);
+  return rc;
+}
+
+static void s_Reboot(void *user_ctx) {
+
+  ESP_LOGI(s_TAG, "Rebooting into %s", s_d_state.update->label);
+  esp_restart();
+}
+
+esp_err_t OtaDeltaBegin(uint32_t size) {
+
+  esp_err_t rc;
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  if (s_d_state.patch) {
+    xSemaphoreGive(s_d_state.lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  s_d_state.running = esp_ota_get_running_partition();
+  s_d_state.update = esp_ota_get_next_update_partition(NULL);
+  s_d_state.size = size;
+  s_d_state.received = 0;
+  s_d_state.start_us = esp_timer_get_time();
+  if (!s_d_state.running || !s_d_state.update) {
+    rc = ESP_ERR_NOT_FOUND;
+  } else if (!(s_d_state.patch = malloc(sizeof(delta_patch)))) {
+    rc = ESP_ERR_NO_MEM;
+  } else if ((rc = esp_ota_begin(s_d_state.update, OTA_WITH_SEQUENTIAL_WRITES, &s_d_state.handle))) {
+    free(s_d_state.patch);
+    s_d_state.patch = NULL;
+  } else {
+    DeltaPatchInit(s_d_state.patch, s_ReadSource, s_WriteTarget, NULL);
+    ESP_LOGI(s_TAG, "Updating %s from %s, %" PRIu32 " byte patch", s_d_state.update->label,
+             s_d_state.running->label, size);
+  }
+  xSemaphoreGive(s_d_state.lock);
+
+  if (rc) {
+    s_d_state.stats.failures++;
+    s_Status("error", rc);
+  }
+  return rc;
+}
+
+esp_err_t OtaDeltaWrite(const void *data, size_t len) {
+
+  esp_err_t rc = ESP_ERR_INVALID_STATE;
+
+  if (!s_d_state.initialised)
+    return rc;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  if (s_d_state.patch) {
+    if (s_d_state.size && len > s_d_state.size - s_d_state.received)
+      rc = ESP_ERR_INVALID_SIZE;
+    else
+      rc = DeltaPatchFeed(s_d_state.patch, data, len);
+    if (rc)
+      s_Fail(rc, true);
+    else
+      s_d_state.received += len;
+  }
+  xSemaphoreGive(s_d_state.lock);
+  return rc;
+}
+
+esp_err_t OtaDeltaEnd(void) {
+
+  esp_err_t rc = ESP_ERR_INVALID_STATE;
+
+  if (!s_d_state.initialised)
+    return rc;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  if (!s_d_state.patch) {
+    xSemaphoreGive(s_d_state.lock);
+    return rc;
+  }
+
+  s_Status("verifying", ESP_OK);
+  if ((rc = DeltaPatchFinish(s_d_state.patch))) {
+    s_Fail(rc, true);
+  } else if ((rc = esp_ota_end(s_d_state.handle)) ||
+             (rc = esp_ota_set_boot_partition(s_d_state.update))) {
+    /* esp_ota_end() releases the handle, even when the image is invalid. */
+    s_Fail(rc, false);
+  } else {
+    ota_delta_stats *stats = &s_d_state.stats;
+    stats->updates++;
+    stats->last_patch_bytes = s_d_state.received;
+    stats->last_image_bytes = s_d_state.patch->target_size;
+    stats->last_update_ms = (esp_timer_get_time() - s_d_state.start_us) / 1000;
+    ESP_LOGI(s_TAG, "%s updated: %" PRIu32 " byte patch, %" PRIu32 " byte image, %" PRIu32 " ms",
+             s_d_state.update->label, stats->last_patch_bytes, stats->last_image_bytes,
+             stats->last_update_ms);
+    s_Release();
+    s_Status("done", ESP_OK);
+    if (CONFIG_OTA_DELTA_REBOOT_DELAY_MS)
+      TimerWheelStart(&s_d_state.reboot, CONFIG_OTA_DELTA_REBOOT_DELAY_MS, 0, s_Reboot, NULL);
+  }
+  xSemaphoreGive(s_d_state.lock);
+  return rc;
+}
+
+void OtaDeltaAbort(void) {
+
+  if (!s_d_state.initialised)
+    return;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  if (s_d_state.patch) {
+    esp_ota_abort(s_d_state.handle);
+    s_Release();
+    ESP_LOGW(s_TAG, "Update aborted at patch offset %" PRIu32, s_d_state.received);
+    s_Status("aborted", ESP_OK);
+  }
+  xSemaphoreGive(s_d_state.lock);
+}
+
+static void s_HttpTask(void *args) {
+
+  esp_http_client_config_t config = {
+    .url = s_d_state.url,
+    .timeout_ms = 10000,
+    .crt_bundle_attach = esp_crt_bundle_attach,
+  };
+  esp_err_t rc = ESP_ERR_NO_MEM;
+  char *buffer = malloc(CONFIG_OTA_DELTA_HTTP_BUFFER_SIZE);
+  esp_http_client_handle_t client = esp_http_client_init(&config);
+
+  if (buffer && client && !(rc = esp_http_client_open(client, 0))) {
+    int64_t length = esp_http_client_fetch_headers(client);
+    int status = esp_http_client_get_status_code(client);
+    if (status != 200) {
+      ESP_LOGE(s_TAG, "GET %s: HTTP %d", s_d_state.url, status);
+      s_d_state.received = s_d_state.size = 0;
+      s_Status("error", rc = ESP_ERR_NOT_FOUND);
+    } else {
+      rc = OtaDeltaBegin(length > 0 ? length : 0);
+    }
+
+    uint32_t reported = 0;
+    while (!rc) {
+      int len = esp_http_client_read(client, buffer, CONFIG_OTA_DELTA_HTTP_BUFFER_SIZE);
+      if (len <= 0) {
+        if (len < 0 || !esp_http_client_is_complete_data_received(client))
+          rc = ESP_FAIL;
+        break;
+      }
+      rc = OtaDeltaWrite(buffer, len);
+      if (!rc && s_d_state.received - reported >= OTA_HTTP_PROGRESS_BYTES) {
+        reported = s_d_state.received;
+        s_Status("receiving", ESP_OK);
+      }
+    }
+    if (!rc)
+      OtaDeltaEnd();
+    esp_http_client_close(client);
+  } else {
+    s_Status("error", rc);
+  }
+
+  if (rc) {
+    ESP_LOGE(s_TAG, "Download of %s failed: %s", s_d_state.url, esp_err_to_name(rc));
+    /* Failed writes already dropped the session, a broken download did not. */
+    OtaDeltaAbort();
+  }
+  if (client)
+    esp_http_client_cleanup(client);
+  free(buffer);
+  s_d_state.http_task = NULL;
+  vTaskDelete(NULL);
+}
+
+esp_err_t OtaDeltaStartHttp(const char *url) {
+
+  if (!s_d_state.initialised || s_d_state.http_task || s_d_state.patch)
+    return ESP_ERR_INVALID_STATE;
+  if (!url || strlen(url) > CONFIG_OTA_DELTA_URL_MAX_LEN || strncmp(url, "https://", 8))
+    return ESP_ERR_INVALID_ARG;
+
+  strcpy(s_d_state.url, url);
+  if (xTaskCreate(s_HttpTask, "ota_http", CONFIG_OTA_DELTA_HTTP_TASK_STACK_SIZE, NULL,
+                  CONFIG_OTA_DELTA_HTTP_TASK_PRIORITY, &s_d_state.http_task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+  return ESP_OK;
+}
+
+#ifdef CONFIG_OTA_DELTA
+/*
+ * @brief Start an MQTT session, on the OTA task.
+ */
+static void s_MqttBegin(uint32_t size) {
+
+  /* A new begin restarts an interrupted MQTT update. */
+  if (s_d_state.mqtt_session)
+    OtaDeltaAbort();
+  if (!size || s_d_state.http_task) {
+    s_Status("error", ESP_ERR_INVALID_STATE);
+    return;
+  }
+  if (!OtaDeltaBegin(size)) {
+    s_d_state.mqtt_session = true;
+    s_Status("receiving", ESP_OK);
+  }
+}
+
+/*
+ * @brief Apply an MQTT chunk, on the OTA task.
+ */
+static void s_MqttChunk(uint32_t offset, const uint8_t *data, size_t len) {
+
+  if (!s_d_state.mqtt_session)
+    return;
+
+  /* Duplicates and chunks past a gap are only answered with the offset
+   * expected next, the sender resends from there. */
+  if (offset == s_d_state.received) {
+    if (OtaDeltaWrite(data, len))
+      return;
+    if (s_d_state.received == s_d_state.size) {
+      OtaDeltaEnd();
+      return;
+    }
+  }
+  s_Status("receiving", ESP_OK);
+}
+
+static void s_OtaTask(void *args) {
+
+  ota_msg *msg;
+
+  for (;;) {
+    xQueueReceive(s_d_state.queue, &msg, portMAX_DELAY);
+    if (msg->type == OTA_MSG_BEGIN)
+      s_MqttBegin(msg->value);
+    else
+      s_MqttChunk(msg->value, msg->data, msg->len);
+    free(msg);
+  }
+}
+
+/*
+ * @brief Hand a message to the OTA task without blocking the MQTT task.
+ *
+ * A chunk dropped on a full queue is never acknowledged, so the sender
+ * resends it.
+ */
+static void s_Queue(ota_msg_type type, uint32_t value, const void *data, size_t len) {
+
+  ota_msg *msg = malloc(sizeof(ota_msg) + len);
+  if (!msg)
+    return;
+  msg->type = type;
+  msg->value = value;
+  msg->len = len;
+  if (len)
+    memcpy(msg->data, data, len);
+  if (xQueueSend(s_d_state.queue, &msg, 0) != pdTRUE) {
+    ESP_LOGW(s_TAG, "OTA queue full, message dropped");
+    free(msg);
+  }
+}
+
+static void s_BeginCallback(const char *data, int data_len, void *user_ctx) {
+
+  char text[12];
+  if (data_len <= 0 || data_len >= (int) sizeof(text))
+    return;
+  memcpy(text, data, data_len);
+  text[data_len] = '\0';
+  s_Queue(OTA_MSG_BEGIN, strtoul(text, NULL, 10), NULL, 0);
+}
+
+static void s_ChunkCallback(const char *data, int data_len, void *user_ctx) {
+
+  if (data_len < 4)
+    return;
+
+  const uint8_t *bytes = (const uint8_t*) data;
+  uint32_t offset = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+  s_Queue(OTA_MSG_CHUNK, offset, bytes + 4, data_len - 4);
+}
+
+static void s_UrlCallback(const char *data, int data_len, void *user_ctx) {
+
+  char url[CONFIG_OTA_DELTA_URL_MAX_LEN + 1];
+  if (data_len <= 0 || data_len > CONFIG_OTA_DELTA_URL_MAX_LEN)
+    return;
+  memcpy(url, data, data_len);
+  url[data_len] = '\0';
+
+  esp_err_t rc = OtaDeltaStartHttp(url);
+  if (rc)
+    s_Status("error", rc);
+}
+#endif
+
+esp_err_t OtaDeltaInit(void) {
+
+  if (s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  s_d_state.lock = xSemaphoreCreateMutex();
+  if (!s_d_state.lock)
+    return ESP_ERR_NO_MEM;
+
+#ifndef CONFIG_OTA_DELTA
+  /* Updates are disabled, OtaDeltaConfirm() still confirms the image. */
+  return ESP_OK;
+#else
+  esp_err_t rc;
+
+  s_d_state.queue = xQueueCreate(CONFIG_OTA_DELTA_QUEUE_DEPTH, sizeof(ota_msg*));
+  if (!s_d_state.queue)
+    return ESP_ERR_NO_MEM;
+  if (xTaskCreate(s_OtaTask, "ota_mqtt", CONFIG_OTA_DELTA_TASK_STACK_SIZE, NULL,
+                  CONFIG_OTA_DELTA_TASK_PRIORITY, &s_d_state.task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  if ((rc = MqttSubscribe(OTA_TOPIC("begin"), 1, s_BeginCallback, NULL)) ||
+      (rc = MqttSubscribe(OTA_TOPIC("chunk"), 1, s_ChunkCallback, NULL)) ||
+      (rc = MqttSubscribe(OTA_TOPIC("url"), 1, s_UrlCallback, NULL)))
+    return rc;
+
+  s_d_state.initialised = true;
+  return ESP_OK;
+#endif
+}
+
+esp_err_t OtaDeltaConfirm(void) {
+
+  esp_err_t rc;
+
+  /* Reaching the broker is what an update must not break, so the image is
+   * only confirmed once a connection succeeded, not at boot. */
+  if (s_d_state.confirmed)
+    return ESP_OK;
+  if ((rc = esp_ota_mark_app_valid_cancel_rollback()))
+    return rc;
+  s_d_state.confirmed = true;
+  ESP_LOGI(s_TAG, "Running image confirmed");
+  return ESP_OK;
+}
+
+esp_err_t OtaDeltaGetStats(ota_delta_stats *stats) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!stats)
+    return ESP_ERR_INVALID_ARG;
+
+  *stats = s_d_state.stats;
+  return ESP_OK;
+}
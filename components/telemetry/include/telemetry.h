@@ -0,0 +1,99 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file telemetry.h
+ *
+ * @brief Task CPU, stack, heap and subscription pool telemetry.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Every CONFIG_TELEMETRY_PERIOD_MS the FreeRTOS task states, the heap, the
+ * MQTT subscription pool and the broker link are sampled from the timer wheel
+ * task, published as Home Assistant diagnostic sensors and checked against the
+ * alert thresholds.
+ * Per task figures need CONFIG_FREERTOS_USE_TRACE_FACILITY, CPU shares also
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_TASK_NAME_LEN (16)
+
+/* Alert bits, set while the matching threshold is crossed. */
+#define TELEMETRY_ALERT_STACK   (1 << 0)
+#define TELEMETRY_ALERT_CPU     (1 << 1)
+#define TELEMETRY_ALERT_HEAP    (1 << 2)
+#define TELEMETRY_ALERT_FRAG    (1 << 3)
+#define TELEMETRY_ALERT_SUBS    (1 << 4)
+
+typedef struct {
+  char name[TELEMETRY_TASK_NAME_LEN];
+  uint8_t cpu_pct;              /* share of the last period */
+  uint32_t stack_free;          /* high-water mark, bytes never used */
+} telemetry_task;
+
+typedef struct {
+  uint32_t uptime_s;
+  uint8_t cpu_pct;              /* all tasks but idle, over the last period */
+  uint32_t heap_free;
+  uint32_t heap_min_free;       /* since boot */
+  uint32_t heap_largest;        /* largest free block */
+  uint8_t heap_frag_pct;        /* free heap outside the largest block */
+  unsigned subs_used;
+  unsigned subs_max_used;
+  unsigned subs_size;
+  uint32_t rtt_p50_ms;          /* broker round trip, see MqttGetLinkStats() */
+  uint32_t rtt_p90_ms;
+  uint32_t rtt_p99_ms;
+  unsigned link_loss_pct;
+  uint32_t stack_min;           /* lowest stack_free of all tasks */
+  unsigned stack_min_task;      /* index in tasks */
+  uint32_t alerts;              /* TELEMETRY_ALERT_* */
+  unsigned num_tasks;
+  telemetry_task tasks[CONFIG_TELEMETRY_MAX_TASKS];
+} telemetry_sample;
+
+/**
+ * @brief Publish the discovery configs and start sampling. Call it with the
+ * other entities, before DiscoverySweep(); needs TimerWheelInit() and MqttInit().
+ */
+esp_err_t TelemetryInit(void);
+
+/**
+ * @brief Publish the discovery configs and the last sample again, e.g. on
+ * reconnection. force sends the configs even if the discovery cache holds them.
+ */
+esp_err_t TelemetryRepublish(bool force);
+esp_err_t TelemetryGetSample(telemetry_sample *sample);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
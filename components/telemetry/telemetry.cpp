@@ -0,0 +1,412 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file telemetry.cpp
+ *
+ * @brief Task CPU, stack, heap and subscription pool telemetry.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * A sample is one JSON state message; each diagnostic entity picks its value
+ * from it with a template, so a period costs a single publish on the
+ * diagnostic lane.
+ *
+ */
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "mqtt_manager.h"
+#include "discovery_cache.h"
+#include "timer_wheel.h"
+#include "telemetry.h"
+
+static const char *s_TAG = "TELEMETRY";
+
+static const char *s_t_config = "homeassistant/%s/franzininho-wifi/telemetry_%s/config";
+static const char *s_t_state  = "franzininho-wifi/telemetry/state";
+static const char *s_config_entity = "{\"name\":\"Franzininho-WiFi %s\",\"availability_topic\":\"franzininho-wifi/status\",\"device\":{\"name\":\"franzininho-wifi\",\"identifiers\":[\"615830010\"]},\"platform\":\"%s\",\"state_topic\":\"franzininho-wifi/telemetry/state\",\"value_template\":\"%s\",\"entity_category\":\"diagnostic\"%s}";
+
+#define TELEMETRY_BYTES ",\"unit_of_measurement\":\"B\",\"device_class\":\"data_size\",\"state_class\":\"measurement\""
+#define TELEMETRY_PCT   ",\"unit_of_measurement\":\"%\",\"state_class\":\"measurement\""
+#define TELEMETRY_MS    ",\"unit_of_measurement\":\"ms\",\"device_class\":\"duration\",\"state_class\":\"measurement\""
+#define TELEMETRY_ATTRS(tmpl) ",\"json_attributes_topic\":\"franzininho-wifi/telemetry/state\",\"json_attributes_template\":\"" tmpl "\""
+
+constexpr int c_state_size {2048};
+
+struct telemetry_entity {
+  const char *id;
+  const char *platform;
+  const char *value_template;
+  const char *extra;
+};
+
+static const telemetry_entity s_entities[] = {
+  { "cpu_load",      "sensor", "{{ value_json.cpu }}",           TELEMETRY_PCT },
+  { "heap_free",     "sensor", "{{ value_json.heap_free }}",     TELEMETRY_BYTES },
+  { "heap_min_free", "sensor", "{{ value_json.heap_min_free }}", TELEMETRY_BYTES },
+  { "heap_largest",  "sensor", "{{ value_json.heap_largest }}",  TELEMETRY_BYTES },
+  { "heap_frag",     "sensor", "{{ value_json.heap_frag }}",     TELEMETRY_PCT },
+  { "stack_min",     "sensor", "{{ value_json.stack_min }}",
+    TELEMETRY_BYTES TELEMETRY_ATTRS("{{ value_json.tasks | tojson }}") },
+  { "subscriptions", "sensor", "{{ value_json.subs }}",          ",\"state_class\":\"measurement\"" },
+  { "link_rtt",      "sensor", "{{ value_json.rtt }}",
+    TELEMETRY_MS TELEMETRY_ATTRS("{{ {'p90': value_json.rtt_p90, 'p99': value_json.rtt_p99} | tojson }}") },
+  { "link_loss",     "sensor", "{{ value_json.loss }}",          TELEMETRY_PCT },
+  { "alert",         "binary_sensor", "{{ 'ON' if value_json.alerts else 'OFF' }}",
+    ",\"device_class\":\"problem\"" TELEMETRY_ATTRS("{{ {'alerts': value_json.alerts} | tojson }}") },
+};
+
+static const char *s_alert_names[] = { "stack", "cpu", "heap", "frag", "subs" };
+
+struct driver_state {
+
+/* Is driver initialised? */
+  bool initialised;
+
+/* Guards sample and the state buffer, shared by the telemetry task and
+ * TelemetryRepublish() callers */
+  SemaphoreHandle_t lock;
+  telemetry_sample sample;
+  bool sampled;
+  char state[c_state_size];
+
+/* The timer wheel callback only wakes the task, which samples and formats */
+  timer_wheel_node timer;
+  TaskHandle_t task;
+
+/* Scratch sample and the run time counters of the previous one, matched by
+ * task number; the sample being taken fills the other half of each pair, which
+ * becomes the baseline once the loop is done. Only used by the telemetry task */
+  telemetry_sample next;
+#ifdef CONFIG_FREERTOS_USE_TRACE_FACILITY
+  TaskStatus_t status[CONFIG_TELEMETRY_MAX_TASKS];
+  UBaseType_t number[2][CONFIG_TELEMETRY_MAX_TASKS];
+  configRUN_TIME_COUNTER_TYPE counter[2][CONFIG_TELEMETRY_MAX_TASKS];
+  unsigned prev;
+  unsigned num_prev;
+  configRUN_TIME_COUNTER_TYPE prev_total;
+  bool warned;
+#endif
+};
+static driver_state s_d_state = {};
+
+static void s_SampleTasks(telemetry_sample *sample) {
+
+  sample->num_tasks = 0;
+  sample->cpu_pct = 0;
+  sample->stack_min = UINT32_MAX;
+  sample->stack_min_task = 0;
+
+#ifdef CONFIG_FREERTOS_USE_TRACE_FACILITY
+  configRUN_TIME_COUNTER_TYPE total = 0;
+  UBaseType_t count = uxTaskGetSystemState(s_d_state.status, CONFIG_TELEMETRY_MAX_TASKS, &total);
+  if (!count) {
+    /* The kernel fills nothing unless every task fits. */
+    if (!s_d_state.warned)
+      ESP_LOGW(s_TAG, "More than %d tasks, raise CONFIG_TELEMETRY_MAX_TASKS",
+               CONFIG_TELEMETRY_MAX_TASKS);
+    s_d_state.warned = true;
+    return;
+  }
+
+  const configRUN_TIME_COUNTER_TYPE elapsed = total - s_d_state.prev_total;
+  const UBaseType_t *prev_number = s_d_state.number[s_d_state.prev];
+  const configRUN_TIME_COUNTER_TYPE *prev_counter = s_d_state.counter[s_d_state.prev];
+  UBaseType_t *next_number = s_d_state.number[!s_d_state.prev];
+  configRUN_TIME_COUNTER_TYPE *next_counter = s_d_state.counter[!s_d_state.prev];
+  uint64_t busy = 0;
+  for (UBaseType_t i = 0; i < count; i++) {
+    const TaskStatus_t *status = &s_d_state.status[i];
+    telemetry_task *task = &sample->tasks[i];
+
+    /* Tasks created during the period count from their start. */
+    configRUN_TIME_COUNTER_TYPE delta = status->ulRunTimeCounter;
+    for (unsigned j = 0; j < s_d_state.num_prev; j++) {
+      if (prev_number[j] == status->xTaskNumber) {
+        delta -= prev_counter[j];
+        break;
+      }
+    }
+    next_number[i] = status->xTaskNumber;
+    next_counter[i] = status->ulRunTimeCounter;
+
+    uint64_t pct = elapsed ? (uint64_t) delta * 100 / elapsed : 0;
+    task->cpu_pct = pct > 100 ? 100 : pct;
+    if (strncmp(status->pcTaskName, "IDLE", 4))
+      busy += delta;
+    strncpy(task->name, status->pcTaskName, TELEMETRY_TASK_NAME_LEN - 1);
+    task->name[TELEMETRY_TASK_NAME_LEN - 1] = '\0';
+    task->stack_free = status->usStackHighWaterMark;
+    if (task->stack_free < sample->stack_min) {
+      sample->stack_min = task->stack_free;
+      sample->stack_min_task = i;
+    }
+  }
+  s_d_state.prev = !s_d_state.prev;
+  s_d_state.num_prev = count;
+  s_d_state.prev_total = total;
+  sample->num_tasks = count;
+
+  uint64_t pct = elapsed ? busy * 100 / elapsed : 0;
+  sample->cpu_pct = pct > 100 ? 100 : pct;
+#endif
+}
+
+static void s_Sample(telemetry_sample *sample) {
+
+  sample->uptime_s = esp_timer_get_time() / 1000000;
+  s_SampleTasks(sample);
+
+  sample->heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  sample->heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  sample->heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  sample->heap_frag_pct = sample->heap_free ?
+                          100 - (uint64_t) sample->heap_largest * 100 / sample->heap_free : 0;
+
+  mqtt_subscription_stats subs = {};
+  MqttGetSubscriptionStats(&subs);
+  sample->subs_used = subs.used;
+  sample->subs_max_used = subs.max_used;
+  sample->subs_size = subs.size;
+
+  mqtt_link_stats link = {};
+  MqttGetLinkStats(&link);
+  sample->rtt_p50_ms = link.p50_rtt_ms;
+  sample->rtt_p90_ms = link.p90_rtt_ms;
+  sample->rtt_p99_ms = link.p99_rtt_ms;
+  sample->link_loss_pct = link.loss_pct;
+
+  sample->alerts = 0;
+  if (sample->num_tasks && sample->stack_min < CONFIG_TELEMETRY_STACK_ALERT_BYTES)
+    sample->alerts |= TELEMETRY_ALERT_STACK;
+  if (sample->cpu_pct >= CONFIG_TELEMETRY_CPU_ALERT_PCT)
+    sample->alerts |= TELEMETRY_ALERT_CPU;
+  if (sample->heap_free < CONFIG_TELEMETRY_HEAP_ALERT_BYTES)
+    sample->alerts |= TELEMETRY_ALERT_HEAP;
+  if (sample->heap_frag_pct >= CONFIG_TELEMETRY_FRAG_ALERT_PCT)
+    sample->alerts |= TELEMETRY_ALERT_FRAG;
+  if (sample->subs_size && sample->subs_used * 100 >= sample->subs_size * CONFIG_TELEMETRY_SUBS_ALERT_PCT)
+    sample->alerts |= TELEMETRY_ALERT_SUBS;
+}
+
+/*
+ * @brief Log the alerts raised or cleared since the previous sample.
+ */
+static void s_LogAlerts(uint32_t previous, const telemetry_sample *sample) {
+
+  uint32_t raised = sample->alerts & ~previous;
+  uint32_t cleared = previous & ~sample->alerts;
+
+  if (raised & TELEMETRY_ALERT_STACK)
+    ESP_LOGW(s_TAG, "Task %s has %" PRIu32 " bytes of stack left",
+             sample->tasks[sample->stack_min_task].name, sample->stack_min);
+  if (raised & TELEMETRY_ALERT_CPU)
+    ESP_LOGW(s_TAG, "CPU load %u%%", sample->cpu_pct);
+  if (raised & TELEMETRY_ALERT_HEAP)
+    ESP_LOGW(s_TAG, "Free heap %" PRIu32 " bytes", sample->heap_free);
+  if (raised & TELEMETRY_ALERT_FRAG)
+    ESP_LOGW(s_TAG, "Heap fragmentation %u%%, largest block %" PRIu32 " of %" PRIu32 " bytes",
+             sample->heap_frag_pct, sample->heap_largest, sample->heap_free);
+  if (raised & TELEMETRY_ALERT_SUBS)
+    ESP_LOGW(s_TAG, "Subscription pool %u of %u in use", sample->subs_used, sample->subs_size);
+
+  for (unsigned i = 0; i < sizeof(s_alert_names) / sizeof(s_alert_names[0]); i++) {
+    if (cleared & (1 << i))
+      ESP_LOGI(s_TAG, "Alert %s cleared", s_alert_names[i]);
+  }
+}
+
+/*
+ * @brief snprintf() at offset, returns the new offset or -1 once truncated.
+ */
+static int s_Append(char *buffer, int size, int offset, const char *format, ...) {
+
+  if (offset < 0)
+    return -1;
+
+  va_list args;
+  va_start(args, format);
+  int temp = vsnprintf(buffer + offset, size - offset, format, args);
+  va_end(args);
+  if (temp < 0 || temp >= size - offset)
+    return -1;
+  return offset + temp;
+}
+
+/*
+ * @brief Format and publish the state message, called with the lock held.
+ */
+static esp_err_t s_PublishState(const telemetry_sample *sample) {
+
+  char *buffer = s_d_state.state;
+  const char *stack_min_task = sample->num_tasks ? sample->tasks[sample->stack_min_task].name : "";
+  uint32_t stack_min = sample->num_tasks ? sample->stack_min : 0;
+
+  int offset = s_Append(buffer, c_state_size, 0,
+                        "{\"uptime\":%" PRIu32 ",\"cpu\":%u,\"heap_free\":%" PRIu32
+                        ",\"heap_min_free\":%" PRIu32 ",\"heap_largest\":%" PRIu32
+                        ",\"heap_frag\":%u,\"subs\":%u,\"subs_max\":%u,\"subs_size\":%u"
+                        ",\"rtt\":%" PRIu32 ",\"rtt_p90\":%" PRIu32 ",\"rtt_p99\":%" PRIu32 ",\"loss\":%u"
+                        ",\"stack_min\":%" PRIu32 ",\"stack_min_task\":\"%s\",\"alerts\":[",
+                        sample->uptime_s, sample->cpu_pct, sample->heap_free,
+                        sample->heap_min_free, sample->heap_largest, sample->heap_frag_pct,
+                        sample->subs_used, sample->subs_max_used, sample->subs_size,
+                        sample->rtt_p50_ms, sample->rtt_p90_ms, sample->rtt_p99_ms,
+                        sample->link_loss_pct,
+                        stack_min, stack_min_task);
+
+  const char *separator = "";
+  for (unsigned i = 0; i < sizeof(s_alert_names) / sizeof(s_alert_names[0]); i++) {
+    if (sample->alerts & (1 << i)) {
+      offset = s_Append(buffer, c_state_size, offset, "%s\"%s\"", separator, s_alert_names[i]);
+      separator = ",";
+    }
+  }
+
+  offset = s_Append(buffer, c_state_size, offset, "],\"tasks\":{");
+  for (unsigned i = 0; i < sample->num_tasks; i++) {
+    offset = s_Append(buffer, c_state_size, offset, "%s\"%s\":{\"cpu\":%u,\"stack\":%" PRIu32 "}",
+                      i ? "," : "", sample->tasks[i].name, sample->tasks[i].cpu_pct,
+                      sample->tasks[i].stack_free);
+  }
+  offset = s_Append(buffer, c_state_size, offset, "}}");
+  if (offset < 0)
+    return ESP_FAIL;
+
+  return MqttPublishLane(MQTT_LANE_DIAG, s_t_state, buffer, offset, 0, 1);
+}
+
+static esp_err_t s_PublishConfigs(bool force) {
+
+  constexpr int config_size = 700;
+  char config_buffer[config_size];
+  esp_err_t rc = ESP_OK;
+
+  for (const telemetry_entity &entity : s_entities) {
+    int temp = snprintf(config_buffer, config_size, s_t_config, entity.platform, entity.id);
+    if (temp > config_size || temp < 0)
+      return ESP_FAIL;
+
+    int offset = temp + 1;
+    int newsize = config_size - offset;
+    temp = snprintf(config_buffer + offset, newsize, s_config_entity, entity.id, entity.platform,
+                    entity.value_template, entity.extra);
+    if (temp > newsize || temp < 0)
+      return ESP_FAIL;
+
+    if (DiscoveryPublish(config_buffer, config_buffer + offset, force))
+      rc = ESP_FAIL;
+  }
+  return rc;
+}
+
+/*
+ * @brief Sample and publish once per period, off the timer wheel task.
+ */
+static void s_TelemetryTask(void *args) {
+
+  telemetry_sample *sample = &s_d_state.next;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    s_Sample(sample);
+
+    xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+    s_LogAlerts(s_d_state.sample.alerts, sample);
+    s_d_state.sample = *sample;
+    s_d_state.sampled = true;
+    if (s_PublishState(sample))
+      ESP_LOGD(s_TAG, "State not published");
+    xSemaphoreGive(s_d_state.lock);
+  }
+}
+
+static void s_TimerCallback(void *user_ctx) {
+
+  /* A period that arrives while the task is still busy is folded into it. */
+  xTaskNotifyGive(s_d_state.task);
+}
+
+esp_err_t TelemetryInit(void) {
+
+  esp_err_t rc;
+
+  if (s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  s_d_state.lock = xSemaphoreCreateMutex();
+  if (!s_d_state.lock)
+    return ESP_ERR_NO_MEM;
+
+  /* The first sample only sets the run time counters baseline. */
+  s_Sample(&s_d_state.sample);
+  s_d_state.sample.alerts = 0;
+
+  if ((rc = s_PublishConfigs(false)))
+    return rc;
+  if (xTaskCreate(s_TelemetryTask, "telemetry", CONFIG_TELEMETRY_TASK_STACK_SIZE, nullptr,
+                  CONFIG_TELEMETRY_TASK_PRIORITY, &s_d_state.task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+  if ((rc = TimerWheelStart(&s_d_state.timer, CONFIG_TELEMETRY_PERIOD_MS,
+                            CONFIG_TELEMETRY_PERIOD_MS, s_TimerCallback, NULL)))
+    return rc;
+
+  s_d_state.initialised = true;
+  return ESP_OK;
+}
+
+esp_err_t TelemetryRepublish(bool force) {
+
+  esp_err_t rc;
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  if ((rc = s_PublishConfigs(force)))
+    return rc;
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  if (s_d_state.sampled)
+    rc = s_PublishState(&s_d_state.sample);
+  xSemaphoreGive(s_d_state.lock);
+  return rc;
+}
+
+esp_err_t TelemetryGetSample(telemetry_sample *sample) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!sample)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  *sample = s_d_state.sample;
+  xSemaphoreGive(s_d_state.lock);
+  return ESP_OK;
+}
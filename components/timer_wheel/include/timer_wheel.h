@@ -0,0 +1,78 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file timer_wheel.h
+ *
+ * @brief Hierarchical timer wheel driven by a single FreeRTOS timer.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Timers are intrusive nodes owned by the caller, so starting and cancelling
+ * a timer is O(1) and never allocates. Callbacks run in the timer wheel task.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*timer_wheel_cb)(void *user_ctx);
+
+typedef struct timer_wheel_node {
+/* Owned by the timer wheel, do not touch. */
+  struct timer_wheel_node *next;
+  struct timer_wheel_node **pprev;  /* NULL while the timer is not pending */
+  uint32_t expiry;
+  uint32_t period;
+
+  timer_wheel_cb callback;
+  void *user_ctx;
+} timer_wheel_node;
+
+#define TIMER_WHEEL_NODE_INIT {0}
+
+esp_err_t TimerWheelInit(void);
+
+/**
+ * @brief Start, or restart, a timer.
+ *
+ * @param node caller owned timer storage, must outlive the pending timer.
+ * @param delay_ms time until the first expiry.
+ * @param period_ms interval between further expiries, 0 for a one shot timer.
+ * @param callback function called from the timer wheel task on expiry.
+ * @param user_ctx argument passed to callback.
+ */
+esp_err_t TimerWheelStart(timer_wheel_node *node, uint32_t delay_ms, uint32_t period_ms,
+                          timer_wheel_cb callback, void *user_ctx);
+esp_err_t TimerWheelCancel(timer_wheel_node *node);
+bool TimerWheelIsPending(const timer_wheel_node *node);
+unsigned TimerWheelPending(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,329 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file timer_wheel.c
+ *
+ * @brief Hierarchical timer wheel implementation.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Four levels of 64 slots cover 2^24 ticks (46 hours at 10 ms). A timer is
+ * linked in the lowest level whose span covers its delay; each time a lower
+ * level wraps, the matching slot of the level above is cascaded down. Longer
+ * delays are parked in the top level and cascaded again until they fit.
+ *
+ */
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "timer_wheel.h"
+
+#define WHEEL_BITS      (6)
+#define WHEEL_SLOTS     (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS    (4)
+#define WHEEL_MAX_DELTA ((1UL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+/* Longest sleep of the wheel task, keeps the FreeRTOS timer period in range */
+#define WHEEL_MAX_SLEEP_MS (3600 * 1000)
+
+static const char *s_TAG = "TWHEEL";
+
+struct driver_state {
+
+/* Is driver initialised? */
+  bool initialised;
+
+/* Protects the wheel against concurrent start/cancel */
+  SemaphoreHandle_t lock;
+
+/* The single one shot FreeRTOS timer driving the wheel, the task it wakes
+ * and the wheel tick it is armed for */
+  TimerHandle_t timer;
+  TaskHandle_t task;
+  uint32_t armed;
+
+/* Wheel ticks processed so far and the time of the last one, advanced
+ * together under the lock */
+  uint32_t now;
+  uint32_t last_ms;
+
+/* Number of pending timers, the FreeRTOS timer only runs while non zero */
+  unsigned pending;
+
+  timer_wheel_node *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+static struct driver_state s_d_state = {0};
+
+static uint32_t s_NowMs(void) {
+
+  return pdTICKS_TO_MS(xTaskGetTickCount());
+}
+
+static void s_Link(timer_wheel_node *node) {
+
+  uint32_t delta = node->expiry - s_d_state.now;
+  uint32_t when = node->expiry;
+  if ((int32_t) delta < 0) {
+    delta = 0;
+    when = s_d_state.now;
+  } else if (delta > WHEEL_MAX_DELTA) {
+    delta = WHEEL_MAX_DELTA;
+    when = s_d_state.now + WHEEL_MAX_DELTA;
+  }
+
+  int level = 0;
+  while (level < WHEEL_LEVELS - 1 && delta >= (1UL << (WHEEL_BITS * (level + 1))))
+    level++;
+
+  timer_wheel_node **head = &s_d_state.slots[level][(when >> (WHEEL_BITS * level)) & WHEEL_MASK];
+  node->next = *head;
+  if (node->next)
+    node->next->pprev = &node->next;
+  node->pprev = head;
+  *head = node;
+}
+
+static void s_Unlink(timer_wheel_node *node) {
+
+  *node->pprev = node->next;
+  if (node->next)
+    node->next->pprev = node->pprev;
+  node->next = NULL;
+  node->pprev = NULL;
+}
+
+static void s_Cascade(int level, unsigned slot) {
+
+  timer_wheel_node *node = s_d_state.slots[level][slot];
+  s_d_state.slots[level][slot] = NULL;
+  while (node) {
+    timer_wheel_node *next = node->next;
+    s_Link(node);
+    node = next;
+  }
+}
+
+/*
+ * @brief Wheel tick of the next cascade or expiry: the start of the first
+ * non empty slot of each level. Ticks before it have nothing to do.
+ */
+static uint32_t s_NextEvent(void) {
+
+  uint32_t next = s_d_state.now + WHEEL_MAX_DELTA + 1;
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    const int shift = WHEEL_BITS * level;
+    const uint32_t base = s_d_state.now >> shift;
+    /* The current slot comes last, it was cascaded on entering it. */
+    for (uint32_t d = 1; d <= WHEEL_SLOTS; d++) {
+      if (s_d_state.slots[level][(base + d) & WHEEL_MASK]) {
+        uint32_t when = (base + d) << shift;
+        if (when - s_d_state.now < next - s_d_state.now)
+          next = when;
+        break;
+      }
+    }
+  }
+  return next;
+}
+
+/*
+ * @brief Arm the FreeRTOS timer for the next wheel event, or stop it when
+ * nothing is pending. Called with the lock held.
+ */
+static void s_Arm(void) {
+
+  if (!s_d_state.pending) {
+    xTimerStop(s_d_state.timer, 0);
+    return;
+  }
+
+  s_d_state.armed = s_NextEvent();
+  int64_t delay_ms = (int64_t)(s_d_state.armed - s_d_state.now) * CONFIG_TIMER_WHEEL_TICK_MS +
+                     (int32_t)(s_d_state.last_ms - s_NowMs());
+  if (delay_ms > WHEEL_MAX_SLEEP_MS)
+    delay_ms = WHEEL_MAX_SLEEP_MS;
+  TickType_t delay = delay_ms > 0 ? pdMS_TO_TICKS(delay_ms + portTICK_PERIOD_MS - 1) : 0;
+  if (xTimerChangePeriod(s_d_state.timer, delay ?: 1, 0) != pdPASS)
+    ESP_LOGE(s_TAG, "Timer not armed");
+}
+
+/*
+ * @brief Advance the wheel one tick and run the timers expiring on it. Called
+ * with the lock held, released around the callbacks.
+ */
+static void s_Tick(void) {
+
+  uint32_t now = ++s_d_state.now;
+  s_d_state.last_ms += CONFIG_TIMER_WHEEL_TICK_MS;
+  for (int level = 1; level < WHEEL_LEVELS; level++) {
+    if ((now >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK)
+      break;
+    s_Cascade(level, (now >> (WHEEL_BITS * level)) & WHEEL_MASK);
+  }
+
+  timer_wheel_node **slot = &s_d_state.slots[0][now & WHEEL_MASK];
+  while (*slot) {
+    timer_wheel_node *node = *slot;
+    s_Unlink(node);
+    if ((int32_t)(node->expiry - now) > 0) {
+      s_Link(node);
+      continue;
+    }
+
+    if (node->period) {
+      node->expiry = now + node->period;
+      s_Link(node);
+    } else {
+      s_d_state.pending--;
+    }
+
+    /* The callback may start or cancel timers, including this one. */
+    timer_wheel_cb callback = node->callback;
+    void *user_ctx = node->user_ctx;
+    xSemaphoreGive(s_d_state.lock);
+    callback(user_ctx);
+    xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  }
+}
+
+static void s_WheelTask(void *args) {
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    /* Catch up to the current time, skipping the ticks with nothing to
+     * cascade or expire. Callbacks may start timers, so look again after
+     * each tick. */
+    xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+    while (s_d_state.pending) {
+      uint32_t elapsed = (s_NowMs() - s_d_state.last_ms) / CONFIG_TIMER_WHEEL_TICK_MS;
+      if (!elapsed)
+        break;
+      uint32_t idle = s_NextEvent() - s_d_state.now - 1;
+      if (idle >= elapsed)
+        idle = elapsed;
+      s_d_state.now += idle;
+      s_d_state.last_ms += idle * CONFIG_TIMER_WHEEL_TICK_MS;
+      if (idle < elapsed)
+        s_Tick();
+    }
+    s_Arm();
+    xSemaphoreGive(s_d_state.lock);
+  }
+}
+
+static void s_TimerCallback(TimerHandle_t timer) {
+
+  xTaskNotifyGive(s_d_state.task);
+}
+
+esp_err_t TimerWheelInit(void) {
+
+  if (s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+
+  s_d_state.lock = xSemaphoreCreateMutex();
+  if (!s_d_state.lock)
+    return ESP_ERR_NO_MEM;
+
+  s_d_state.timer = xTimerCreate("twheel", pdMS_TO_TICKS(CONFIG_TIMER_WHEEL_TICK_MS) ?: 1,
+                                 pdFALSE, NULL, s_TimerCallback);
+  if (!s_d_state.timer)
+    return ESP_ERR_NO_MEM;
+
+  if (xTaskCreate(s_WheelTask, "twheel", CONFIG_TIMER_WHEEL_TASK_STACK_SIZE, NULL,
+                  CONFIG_TIMER_WHEEL_TASK_PRIORITY, &s_d_state.task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  s_d_state.last_ms = s_NowMs();
+  s_d_state.initialised = true;
+  return ESP_OK;
+}
+
+esp_err_t TimerWheelStart(timer_wheel_node *node, uint32_t delay_ms, uint32_t period_ms,
+                          timer_wheel_cb callback, void *user_ctx) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!node || !callback)
+    return ESP_ERR_INVALID_ARG;
+
+  uint32_t delay = (delay_ms + CONFIG_TIMER_WHEEL_TICK_MS - 1) / CONFIG_TIMER_WHEEL_TICK_MS;
+  uint32_t period = (period_ms + CONFIG_TIMER_WHEEL_TICK_MS - 1) / CONFIG_TIMER_WHEEL_TICK_MS;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  if (node->pprev)
+    s_Unlink(node);
+  else
+    s_d_state.pending++;
+
+  /* An idle wheel has no time to catch up. */
+  if (s_d_state.pending == 1)
+    s_d_state.last_ms = s_NowMs();
+
+  /* Ticks elapsed but not yet processed by the wheel task still count. */
+  uint32_t lag = (s_NowMs() - s_d_state.last_ms) / CONFIG_TIMER_WHEEL_TICK_MS;
+  node->expiry = s_d_state.now + lag + (delay ? delay : 1);
+  node->period = period;
+  node->callback = callback;
+  node->user_ctx = user_ctx;
+  s_Link(node);
+
+  /* The wheel task arms the timer itself once its callbacks are done. */
+  if (xTaskGetCurrentTaskHandle() != s_d_state.task &&
+      (s_d_state.pending == 1 || (int32_t)(node->expiry - s_d_state.armed) < 0))
+    s_Arm();
+  xSemaphoreGive(s_d_state.lock);
+
+  ESP_LOGD(s_TAG, "Timer %p due in %" PRIu32 " ticks", node, delay);
+  return ESP_OK;
+}
+
+esp_err_t TimerWheelCancel(timer_wheel_node *node) {
+
+  if (!s_d_state.initialised)
+    return ESP_ERR_INVALID_STATE;
+  if (!node)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(s_d_state.lock, portMAX_DELAY);
+  if (node->pprev) {
+    s_Unlink(node);
+    s_d_state.pending--;
+  }
+  xSemaphoreGive(s_d_state.lock);
+  return ESP_OK;
+}
+
+bool TimerWheelIsPending(const timer_wheel_node *node) {
+
+  return node && node->pprev;
+}
+
+unsigned TimerWheelPending(void) {
+
+  return s_d_state.pending;
+}
@@ -0,0 +1,97 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file trace.h
+ *
+ * @brief Low overhead binary trace ring, usable from ISRs and tasks.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Records are 16 bytes, timestamped with the CPU cycle counter and written
+ * into a lock-free ring. No formatting happens on the device: the ring is
+ * dumped as hex over the console and decoded on the host by
+ * tools/trace2chrome.py.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Trace point identifiers. Names are emitted with each dump, so the host
+ * decoder does not need to be kept in sync with this list. */
+#define TRACE_IDS(X)   \
+  X(GPIO_ISR)          \
+  X(MAIN_LOOP)         \
+  X(MQTT_EVENT)        \
+  X(SWITCH_TOGGLE)     \
+  X(SWITCH_COMMAND)    \
+  X(SWITCH_PUBLISH)
+
+#define TRACE_ID_ENUM(name) TRACE_ID_##name,
+typedef enum {
+  TRACE_IDS(TRACE_ID_ENUM)
+  TRACE_ID_MAX
+} trace_id_t;
+#undef TRACE_ID_ENUM
+
+typedef enum {
+  TRACE_TYPE_BEGIN = 1,
+  TRACE_TYPE_END,
+  TRACE_TYPE_INSTANT,
+  TRACE_TYPE_COUNTER
+} trace_type_t;
+
+#ifdef CONFIG_TRACE_ENABLE
+
+esp_err_t TraceInit(void);
+void TraceRecord(trace_type_t type, trace_id_t id, uint32_t arg);
+esp_err_t TraceDump(void);
+void TraceClear(void);
+
+#define TRACE_BEGIN(id, arg)   TraceRecord(TRACE_TYPE_BEGIN, TRACE_ID_##id, (uint32_t)(arg))
+#define TRACE_END(id, arg)     TraceRecord(TRACE_TYPE_END, TRACE_ID_##id, (uint32_t)(arg))
+#define TRACE_INSTANT(id, arg) TraceRecord(TRACE_TYPE_INSTANT, TRACE_ID_##id, (uint32_t)(arg))
+#define TRACE_COUNTER(id, arg) TraceRecord(TRACE_TYPE_COUNTER, TRACE_ID_##id, (uint32_t)(arg))
+
+#else
+
+static inline esp_err_t TraceInit(void) { return ESP_OK; }
+static inline esp_err_t TraceDump(void) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void TraceClear(void) {}
+
+#define TRACE_BEGIN(id, arg)   ((void)0)
+#define TRACE_END(id, arg)     ((void)0)
+#define TRACE_INSTANT(id, arg) ((void)0)
+#define TRACE_COUNTER(id, arg) ((void)0)
+
+#endif /* CONFIG_TRACE_ENABLE */
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,171 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file trace.c
+ *
+ * @brief Lock-free binary trace ring implementation.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include "trace.h"
+
+#ifdef CONFIG_TRACE_ENABLE
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_private/esp_clk.h"
+
+#define TRACE_RING_MASK (CONFIG_TRACE_RING_RECORDS - 1)
+_Static_assert((CONFIG_TRACE_RING_RECORDS & TRACE_RING_MASK) == 0,
+               "CONFIG_TRACE_RING_RECORDS must be a power of two");
+
+#define TRACE_FLAG_ISR  (1 << 0)
+#define TRACE_MAX_TASKS (16)
+
+typedef struct {
+  uint32_t cycles;
+  uint32_t arg;
+  uint32_t task;
+  uint16_t id;
+  uint8_t type;   /* 0 means the slot was never committed. */
+  uint8_t flags;
+} trace_record_t;
+_Static_assert(sizeof(trace_record_t) == 16, "trace record must be 16 bytes");
+
+#define TRACE_ID_NAME(name) #name,
+static const char *s_id_names[TRACE_ID_MAX] = { TRACE_IDS(TRACE_ID_NAME) };
+#undef TRACE_ID_NAME
+
+static DRAM_ATTR trace_record_t s_ring[CONFIG_TRACE_RING_RECORDS];
+static DRAM_ATTR atomic_uint s_head;
+static DRAM_ATTR atomic_bool s_paused;
+
+#ifdef CONFIG_TRACE_CONSOLE_DUMP
+static void s_ConsoleTask(void *args) {
+
+  while (true) {
+    int c = getchar();
+    if (c == 't')
+      TraceDump();
+    else if (c == 'c')
+      TraceClear();
+    else
+      vTaskDelay(pdMS_TO_TICKS(100));
+  }
+}
+#endif
+
+esp_err_t TraceInit(void) {
+
+  TraceClear();
+#ifdef CONFIG_TRACE_CONSOLE_DUMP
+  if (xTaskCreate(s_ConsoleTask, "trace_con", 3072, NULL, 1, NULL) != pdPASS)
+    return ESP_ERR_NO_MEM;
+#endif
+  return ESP_OK;
+}
+
+void IRAM_ATTR TraceRecord(trace_type_t type, trace_id_t id, uint32_t arg) {
+
+  if (atomic_load_explicit(&s_paused, memory_order_relaxed))
+    return;
+
+  /* Claiming the slot is the only shared write, so ISRs may preempt a task
+   * half-way through a record without corrupting it. */
+  unsigned slot = atomic_fetch_add_explicit(&s_head, 1, memory_order_relaxed) & TRACE_RING_MASK;
+  trace_record_t *r = &s_ring[slot];
+  bool isr = xPortInIsrContext();
+
+  r->type = 0;
+  r->cycles = esp_cpu_get_cycle_count();
+  r->arg = arg;
+  r->task = isr ? 0 : (uint32_t)(uintptr_t) xTaskGetCurrentTaskHandle();
+  r->id = id;
+  r->flags = isr ? TRACE_FLAG_ISR : 0;
+  atomic_signal_fence(memory_order_release);
+  r->type = type;
+}
+
+void TraceClear(void) {
+
+  atomic_store(&s_paused, true);
+  for (unsigned i = 0; i < CONFIG_TRACE_RING_RECORDS; i++)
+    s_ring[i].type = 0;
+  atomic_store(&s_head, 0);
+  atomic_store(&s_paused, false);
+}
+
+esp_err_t TraceDump(void) {
+
+  uint32_t tasks[TRACE_MAX_TASKS];
+  unsigned num_tasks = 0;
+
+  atomic_store(&s_paused, true);
+  /* Let any record claimed before the pause be committed. */
+  vTaskDelay(1);
+
+  unsigned head = atomic_load(&s_head);
+  unsigned count = head < CONFIG_TRACE_RING_RECORDS ? head : CONFIG_TRACE_RING_RECORDS;
+  unsigned first = head - count;
+
+  printf("=== TRACE BEGIN v1 cpu_hz=%d records=%u lost=%u\n", esp_clk_cpu_freq(), count,
+         head - count);
+  for (unsigned i = 0; i < TRACE_ID_MAX; i++)
+    printf("N %u %s\n", i, s_id_names[i]);
+
+  for (unsigned i = 0; i < count; i++) {
+    const trace_record_t *r = &s_ring[(first + i) & TRACE_RING_MASK];
+    if (!r->type)
+      continue;
+    const uint8_t *raw = (const uint8_t*) r;
+    printf("R ");
+    for (unsigned b = 0; b < sizeof(*r); b++)
+      printf("%02x", raw[b]);
+    printf("\n");
+
+    if (r->task) {
+      unsigned t = 0;
+      while (t < num_tasks && tasks[t] != r->task)
+        t++;
+      if (t == num_tasks && num_tasks < TRACE_MAX_TASKS)
+        tasks[num_tasks++] = r->task;
+    }
+  }
+
+  /* Tasks recorded in the ring are assumed to still exist; this holds for
+   * the long lived tasks of this firmware. */
+  for (unsigned t = 0; t < num_tasks; t++)
+    printf("T %08" PRIx32 " %s\n", tasks[t], pcTaskGetName((TaskHandle_t)(uintptr_t) tasks[t]));
+  printf("=== TRACE END\n");
+  fflush(stdout);
+
+  atomic_store(&s_paused, false);
+  return ESP_OK;
+}
+
+#endif /* CONFIG_TRACE_ENABLE */
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: GPLv2
+#
+# Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+#
+# Generate the simulator's sdkconfig.h from the defaults of the project's
+# Kconfig files, then apply sdkconfig.defaults style overrides. Only the
+# Kconfig subset used by this project is understood: bool, int, hex and
+# string options, unconditional defaults, choices and "depends on" symbol
+# expressions.
+#
+# Usage: gen_sdkconfig.py -o sdkconfig.h [--overrides FILE] Kconfig...
+#
+
+"""Generate sdkconfig.h from Kconfig defaults."""
+
+import argparse
+import re
+
+
+class Option:
+    def __init__(self, name):
+        self.name = name
+        self.type = None
+        self.default = None
+        self.depends = []
+        self.choice = None
+
+
+def parse(paths):
+    options = {}
+    choices = {}
+    for path in paths:
+        current = None
+        choice = None
+        choice_depends = []
+        with open(path) as f:
+            for line in f:
+                words = line.split(None, 1)
+                if not words:
+                    continue
+                key, rest = words[0], (words[1].strip() if len(words) > 1 else '')
+                if key in ('config', 'menuconfig'):
+                    current = options.setdefault(rest, Option(rest))
+                    if choice:
+                        current.choice = choice
+                        current.depends += choice_depends
+                elif key == 'choice':
+                    choice = rest or path
+                    choices[choice] = None
+                    choice_depends = []
+                    current = None
+                elif key == 'endchoice':
+                    choice = None
+                elif key in ('bool', 'int', 'hex', 'string') and current:
+                    current.type = key
+                elif key == 'default' and current and current.default is None:
+                    current.default = rest.split(' if ')[0].strip()
+                elif key == 'default' and choice and not current and choices[choice] is None:
+                    choices[choice] = rest.split(' if ')[0].strip()
+                elif key == 'depends' and rest.startswith('on '):
+                    if current:
+                        current.depends.append(rest[3:])
+                    elif choice:
+                        choice_depends.append(rest[3:])
+                elif key in ('menu', 'endmenu', 'if', 'endif', 'comment'):
+                    current = None
+
+    values = {}
+    for option in options.values():
+        if option.choice:
+            values[option.name] = 'y' if choices[option.choice] == option.name else 'n'
+        elif option.type == 'bool':
+            values[option.name] = 'y' if option.default == 'y' else 'n'
+        elif option.default is not None:
+            values[option.name] = option.default
+    return options, values
+
+
+def apply_overrides(path, values):
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            unset = re.match(r'# CONFIG_(\w+) is not set', line)
+            if unset:
+                values[unset.group(1)] = 'n'
+            elif line.startswith('CONFIG_'):
+                name, value = line[len('CONFIG_'):].split('=', 1)
+                values[name] = value
+
+
+def enabled(expr, values):
+    expr = re.sub(r'\b([A-Z][A-Z0-9_]*)\b',
+                  lambda m: 'True' if values.get(m.group(1), 'n') not in ('n', None) else 'False',
+                  expr)
+    expr = expr.replace('&&', ' and ').replace('||', ' or ').replace('!', ' not ')
+    return eval(expr)  # pylint: disable=eval-used
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('kconfig', nargs='+')
+    parser.add_argument('-o', '--output', required=True)
+    parser.add_argument('--overrides')
+    args = parser.parse_args()
+
+    options, values = parse(args.kconfig)
+    if args.overrides:
+        apply_overrides(args.overrides, values)
+
+    # Options whose dependencies are not met are left out, like menuconfig.
+    changed = True
+    while changed:
+        changed = False
+        for option in options.values():
+            if values.get(option.name, 'n') != 'n' and \
+                    not all(enabled(d, values) for d in option.depends):
+                values[option.name] = 'n'
+                changed = True
+
+    lines = ['/* Generated by gen_sdkconfig.py, do not edit. */', '#pragma once']
+    for name in sorted(values):
+        value = values[name]
+        option = options.get(name)
+        if value == 'n':
+            continue
+        if value == 'y' and (not option or option.type == 'bool' or option.choice):
+            value = '1'
+        lines.append('#define CONFIG_%s %s' % (name, value))
+    with open(args.output, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
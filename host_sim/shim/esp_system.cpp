@@ -0,0 +1,462 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file esp_system.cpp
+ *
+ * @brief Logging, error names, NVS, random numbers, CRC, CPU clock and the
+ * network bring up stubs.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <malloc.h>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_cpu.h"
+#include "esp_private/esp_clk.h"
+#include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
+#include "esp_mac.h"
+#include "esp_ota_ops.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "protocol_examples_common.h"
+#include "sdkconfig.h"
+#include "sim.h"
+
+/* Logging */
+
+static std::mutex s_log_lock;
+static bool s_log_enabled = true;
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+static std::map<std::string, esp_log_level_t> s_log_levels;
+
+void sim::SetLogging(bool enabled) {
+
+  std::lock_guard<std::mutex> guard(s_log_lock);
+  s_log_enabled = enabled;
+}
+
+extern "C" void esp_log_level_set(const char *tag, esp_log_level_t level) {
+
+  std::lock_guard<std::mutex> guard(s_log_lock);
+  if (!strcmp(tag, "*"))
+    s_log_level = level;
+  else
+    s_log_levels[tag] = level;
+}
+
+extern "C" void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+
+  std::lock_guard<std::mutex> guard(s_log_lock);
+  auto it = s_log_levels.find(tag);
+  if (!s_log_enabled || level > (it == s_log_levels.end() ? s_log_level : it->second))
+    return;
+  va_list args;
+  va_start(args, format);
+  vfprintf(stdout, format, args);
+  va_end(args);
+}
+
+extern "C" uint32_t esp_log_timestamp(void) {
+
+  return sim::NowUs() / 1000;
+}
+
+extern "C" const char *esp_err_to_name(esp_err_t code) {
+
+  switch (code) {
+  case ESP_OK: return "ESP_OK";
+  case ESP_FAIL: return "ESP_FAIL";
+  case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+  case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+  case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+  case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+  case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+  case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+  case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+  case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+  case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+  case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+  case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+  case ESP_ERR_OTA_VALIDATE_FAILED: return "ESP_ERR_OTA_VALIDATE_FAILED";
+  default: return "UNKNOWN ERROR";
+  }
+}
+
+extern "C" void _esp_error_check_failed(esp_err_t rc, const char *file, int line,
+                                        const char *function, const char *expression) {
+
+  fflush(stdout);
+  fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\n"
+          "file: \"%s\" line %d\nfunc: %s\nexpression: %s\n",
+          rc, esp_err_to_name(rc), file, line, file, line, function, expression);
+  abort();
+}
+
+/* NVS, one in-memory store shared by all handles */
+
+struct nvs_value {
+  nvs_type_t type;
+  std::vector<uint8_t> data;
+};
+
+static std::mutex s_nvs_lock;
+static std::map<std::string, std::map<std::string, nvs_value>> s_nvs;
+static std::vector<std::string> s_nvs_handles;
+
+struct nvs_opaque_iterator_t {
+  std::string namespace_name;
+  nvs_type_t type;
+  std::map<std::string, std::map<std::string, nvs_value>>::iterator ns;
+  std::map<std::string, nvs_value>::iterator entry;
+};
+
+static std::map<std::string, nvs_value> *s_Namespace(nvs_handle_t handle) {
+
+  if (!handle || handle > s_nvs_handles.size())
+    return nullptr;
+  return &s_nvs[s_nvs_handles[handle - 1]];
+}
+
+extern "C" esp_err_t nvs_flash_init(void) {
+
+  return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_flash_erase(void) {
+
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  s_nvs.clear();
+  return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+
+  (void) mode;
+  if (!name || strlen(name) >= NVS_NS_NAME_MAX_SIZE || !handle)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  s_nvs_handles.push_back(name);
+  *handle = s_nvs_handles.size();
+  return ESP_OK;
+}
+
+extern "C" void nvs_close(nvs_handle_t handle) {
+
+  (void) handle;
+}
+
+extern "C" esp_err_t nvs_commit(nvs_handle_t handle) {
+
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  return s_Namespace(handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+extern "C" esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  auto *ns = s_Namespace(handle);
+  if (!ns)
+    return ESP_ERR_INVALID_ARG;
+  return ns->erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+extern "C" esp_err_t nvs_erase_all(nvs_handle_t handle) {
+
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  auto *ns = s_Namespace(handle);
+  if (!ns)
+    return ESP_ERR_INVALID_ARG;
+  ns->clear();
+  return ESP_OK;
+}
+
+static esp_err_t s_Set(nvs_handle_t handle, const char *key, nvs_type_t type, const void *value,
+                       size_t length) {
+
+  if (!key || strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  auto *ns = s_Namespace(handle);
+  if (!ns)
+    return ESP_ERR_INVALID_ARG;
+  const uint8_t *bytes = static_cast<const uint8_t*>(value);
+  (*ns)[key] = nvs_value{type, std::vector<uint8_t>(bytes, bytes + length)};
+  return ESP_OK;
+}
+
+/* Fixed size values need length == size, variable ones report the size
+ * when value is NULL. */
+static esp_err_t s_Get(nvs_handle_t handle, const char *key, nvs_type_t type, void *value,
+                       size_t *length, bool variable) {
+
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  auto *ns = s_Namespace(handle);
+  if (!ns || !key)
+    return ESP_ERR_INVALID_ARG;
+  auto it = ns->find(key);
+  if (it == ns->end() || it->second.type != type)
+    return ESP_ERR_NVS_NOT_FOUND;
+  const std::vector<uint8_t> &data = it->second.data;
+  if (variable) {
+    if (!value) {
+      *length = data.size();
+      return ESP_OK;
+    }
+    if (*length < data.size()) {
+      *length = data.size();
+      return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    *length = data.size();
+  }
+  memcpy(value, data.data(), data.size());
+  return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+
+  return s_Set(handle, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+extern "C" esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *value) {
+
+  return s_Get(handle, key, NVS_TYPE_U8, value, nullptr, false);
+}
+
+extern "C" esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+
+  return s_Set(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+extern "C" esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value) {
+
+  return s_Get(handle, key, NVS_TYPE_U32, value, nullptr, false);
+}
+
+extern "C" esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+
+  return s_Set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+extern "C" esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value,
+                                 size_t *length) {
+
+  return s_Get(handle, key, NVS_TYPE_STR, value, length, true);
+}
+
+extern "C" esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value,
+                                  size_t length) {
+
+  return s_Set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+extern "C" esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value,
+                                  size_t *length) {
+
+  return s_Get(handle, key, NVS_TYPE_BLOB, value, length, true);
+}
+
+static bool s_Matches(nvs_opaque_iterator_t *it) {
+
+  return (it->namespace_name.empty() || it->ns->first == it->namespace_name) &&
+         (it->type == NVS_TYPE_ANY || it->entry->second.type == it->type);
+}
+
+/* Move to the next matching entry, at or after the current one. */
+static esp_err_t s_Seek(nvs_opaque_iterator_t *it) {
+
+  while (it->ns != s_nvs.end()) {
+    for (; it->entry != it->ns->second.end(); ++it->entry) {
+      if (s_Matches(it))
+        return ESP_OK;
+    }
+    if (++it->ns != s_nvs.end())
+      it->entry = it->ns->second.begin();
+  }
+  return ESP_ERR_NVS_NOT_FOUND;
+}
+
+extern "C" esp_err_t nvs_entry_find(const char *part_name, const char *namespace_name,
+                                    nvs_type_t type, nvs_iterator_t *iterator) {
+
+  (void) part_name;
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  nvs_opaque_iterator_t *it = new nvs_opaque_iterator_t;
+  it->namespace_name = namespace_name ? namespace_name : "";
+  it->type = type;
+  it->ns = s_nvs.begin();
+  if (it->ns != s_nvs.end())
+    it->entry = it->ns->second.begin();
+  if (s_Seek(it) != ESP_OK) {
+    delete it;
+    *iterator = nullptr;
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  *iterator = it;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_entry_next(nvs_iterator_t *iterator) {
+
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  nvs_opaque_iterator_t *it = *iterator;
+  if (!it)
+    return ESP_ERR_INVALID_ARG;
+  ++it->entry;
+  if (s_Seek(it) != ESP_OK) {
+    delete it;
+    *iterator = nullptr;
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t *info) {
+
+  if (!iterator || !info)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_nvs_lock);
+  snprintf(info->namespace_name, sizeof(info->namespace_name), "%s", iterator->ns->first.c_str());
+  snprintf(info->key, sizeof(info->key), "%s", iterator->entry->first.c_str());
+  info->type = iterator->entry->second.type;
+  return ESP_OK;
+}
+
+extern "C" void nvs_release_iterator(nvs_iterator_t iterator) {
+
+  delete iterator;
+}
+
+/* ROM and CPU */
+
+extern "C" uint32_t esp_random(void) {
+
+  static std::mutex lock;
+  static std::mt19937 generator {std::random_device {}()};
+  std::lock_guard<std::mutex> guard(lock);
+  return generator();
+}
+
+extern "C" esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+
+  /* A fixed locally administered address, the softAP one is the next. */
+  static const uint8_t base[6] = { 0x02, 0x46, 0x52, 0x5a, 0x00, 0x01 };
+  memcpy(mac, base, sizeof(base));
+  mac[5] += type == ESP_MAC_WIFI_SOFTAP;
+  return ESP_OK;
+}
+
+extern "C" uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+extern "C" int esp_clk_cpu_freq(void) {
+
+  return 240000000;
+}
+
+extern "C" uint32_t esp_cpu_get_cycle_count(void) {
+
+  return sim::NowUs() * (esp_clk_cpu_freq() / 1000000);
+}
+
+/* Heap, a nominal ESP32-S2 DRAM heap less what the host process allocated
+ * since the first query. Fragmentation is not modelled. */
+
+static constexpr size_t c_heap_size {200 * 1024};
+static std::atomic<size_t> s_heap_min_free {c_heap_size};
+
+extern "C" size_t heap_caps_get_free_size(uint32_t caps) {
+
+  static const size_t baseline = mallinfo2().uordblks;
+  size_t used = mallinfo2().uordblks;
+  used = used > baseline ? used - baseline : 0;
+  size_t free_size = used < c_heap_size ? c_heap_size - used : 0;
+
+  size_t min_free = s_heap_min_free;
+  while (free_size < min_free && !s_heap_min_free.compare_exchange_weak(min_free, free_size));
+  return free_size;
+}
+
+extern "C" size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+
+  heap_caps_get_free_size(caps);
+  return s_heap_min_free;
+}
+
+extern "C" size_t heap_caps_get_largest_free_block(uint32_t caps) {
+
+  return heap_caps_get_free_size(caps);
+}
+
+/* Network bring up */
+
+extern "C" esp_err_t esp_netif_init(void) {
+
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_event_loop_create_default(void) {
+
+  return ESP_OK;
+}
+
+extern "C" esp_err_t example_connect(void) {
+
+  /* Roughly a Wi-Fi association and DHCP lease. */
+  vTaskDelay(pdMS_TO_TICKS(300));
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_crt_bundle_attach(void *conf) {
+
+  (void) conf;
+  return ESP_OK;
+}
@@ -0,0 +1,119 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file esp_timer.cpp
+ *
+ * @brief esp_timer shim: callbacks run in an "esp_timer" thread, ISR dispatch
+ * is treated like task dispatch.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include "esp_timer.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+struct esp_timer {
+  sim::TimerService::Timer timer;
+  const char *name;
+};
+
+static sim::TimerService &s_Service() {
+
+  static sim::TimerService service("esp_timer", 22);
+  return service;
+}
+
+extern "C" int64_t esp_timer_get_time(void) {
+
+  return sim::NowUs();
+}
+
+extern "C" esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                                      esp_timer_handle_t *handle) {
+
+  if (!args || !args->callback || !handle)
+    return ESP_ERR_INVALID_ARG;
+  esp_timer *timer = new esp_timer;
+  esp_timer_cb_t callback = args->callback;
+  void *arg = args->arg;
+  timer->timer.callback = [callback, arg] { callback(arg); };
+  timer->name = args->name;
+  *handle = timer;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  if (s_Service().IsActive(&timer->timer))
+    return ESP_ERR_INVALID_STATE;
+  delete timer;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  if (s_Service().IsActive(&timer->timer))
+    return ESP_ERR_INVALID_STATE;
+  s_Service().Start(&timer->timer, timeout_us, 0);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+
+  if (!timer || !period_us)
+    return ESP_ERR_INVALID_ARG;
+  if (s_Service().IsActive(&timer->timer))
+    return ESP_ERR_INVALID_STATE;
+  s_Service().Start(&timer->timer, period_us, period_us);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us) {
+
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  if (!s_Service().IsActive(&timer->timer))
+    return ESP_ERR_INVALID_STATE;
+  s_Service().Start(&timer->timer, timeout_us, timer->timer.period_us ? timeout_us : 0);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+
+  if (!timer)
+    return ESP_ERR_INVALID_ARG;
+  if (!s_Service().IsActive(&timer->timer))
+    return ESP_ERR_INVALID_STATE;
+  s_Service().Stop(&timer->timer);
+  return ESP_OK;
+}
+
+extern "C" bool esp_timer_is_active(esp_timer_handle_t timer) {
+
+  return timer && s_Service().IsActive(&timer->timer);
+}
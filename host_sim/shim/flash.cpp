@@ -0,0 +1,377 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * @file flash.cpp
+ *
+ * @brief Flash layout of partitions.csv in memory: partitions, OTA updates,
+ * and the HTTP client serving local files.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "esp_http_client.h"
+#include "esp_system.h"
+#include "sdkconfig.h"
+#include "sim.h"
+
+/* Partitions */
+
+namespace {
+struct sim_partition {
+  esp_partition_t info;
+  std::vector<uint8_t> data;
+};
+
+sim_partition s_partitions[] = {
+  {{nullptr, ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x20000, 0x180000, 4096,
+    "ota_0", false, false}, {}},
+  {{nullptr, ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x1a0000, 0x180000, 4096,
+    "ota_1", false, false}, {}},
+  {{nullptr, ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t) 0x40, 0x320000, 0x40000, 4096,
+    "", false, false}, {}},
+};
+sim_partition &s_running = s_partitions[0];
+sim_partition &s_assets = s_partitions[2];
+std::mutex s_flash_lock;
+}
+
+static sim_partition *s_Partition(const esp_partition_t *partition) {
+
+  for (sim_partition &p : s_partitions) {
+    if (&p.info == partition)
+      return &p;
+  }
+  return nullptr;
+}
+
+/* App partitions read back as erased flash until something is written. */
+static std::vector<uint8_t> &s_Data(sim_partition &partition) {
+
+  if (partition.data.empty() && partition.info.type == ESP_PARTITION_TYPE_APP)
+    partition.data.assign(partition.info.size, 0xff);
+  return partition.data;
+}
+
+static bool s_LoadFile(const std::string &path, std::vector<uint8_t> &data) {
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+bool sim::LoadAssetPartition(const std::string &path) {
+
+  if (!s_LoadFile(path, s_assets.data))
+    return false;
+  s_assets.info.size = s_assets.data.size();
+  snprintf(s_assets.info.label, sizeof(s_assets.info.label), "%s",
+           CONFIG_ASSET_PACK_PARTITION_LABEL);
+  return true;
+}
+
+bool sim::LoadFirmware(const std::string &path) {
+
+  std::vector<uint8_t> image;
+  if (!s_LoadFile(path, image) || image.size() > s_running.info.size)
+    return false;
+  std::vector<uint8_t> &data = s_Data(s_running);
+  std::copy(image.begin(), image.end(), data.begin());
+  return true;
+}
+
+extern "C" const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                           esp_partition_subtype_t subtype,
+                                                           const char *label) {
+
+  for (sim_partition &p : s_partitions) {
+    /* Without an asset pack the assets partition does not exist. */
+    if (p.info.type == ESP_PARTITION_TYPE_DATA && p.data.empty())
+      continue;
+    if (type != ESP_PARTITION_TYPE_ANY && type != p.info.type)
+      continue;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != p.info.subtype)
+      continue;
+    if (label && strcmp(label, p.info.label))
+      continue;
+    return &p.info;
+  }
+  return nullptr;
+}
+
+extern "C" esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst,
+                                        size_t size) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  sim_partition *p = s_Partition(partition);
+  if (!p || offset + size > partition->size)
+    return ESP_ERR_INVALID_ARG;
+  memcpy(dst, s_Data(*p).data() + offset, size);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset,
+                                         const void *src, size_t size) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  sim_partition *p = s_Partition(partition);
+  if (!p || offset + size > partition->size)
+    return ESP_ERR_INVALID_ARG;
+  memcpy(s_Data(*p).data() + offset, src, size);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset,
+                                               size_t size) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  sim_partition *p = s_Partition(partition);
+  if (!p || offset + size > partition->size)
+    return ESP_ERR_INVALID_ARG;
+  memset(s_Data(*p).data() + offset, 0xff, size);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                                        esp_partition_mmap_memory_t memory, const void **out_ptr,
+                                        esp_partition_mmap_handle_t *out_handle) {
+
+  (void) memory;
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  sim_partition *p = s_Partition(partition);
+  if (!p || offset + size > partition->size)
+    return ESP_ERR_INVALID_ARG;
+  *out_ptr = s_Data(*p).data() + offset;
+  *out_handle = 1;
+  return ESP_OK;
+}
+
+extern "C" void esp_partition_munmap(esp_partition_mmap_handle_t handle) {
+
+  (void) handle;
+}
+
+/* OTA, one update at a time like the bootloader's two slot scheme */
+
+namespace {
+constexpr uint8_t c_image_magic {0xe9};
+
+sim_partition *s_ota_target = nullptr;
+size_t s_ota_written = 0;
+esp_ota_handle_t s_ota_handle = 0;
+sim_partition *s_boot = &s_running;
+size_t s_boot_size = 0;
+std::string s_restart_image;
+}
+
+extern "C" const esp_partition_t *esp_ota_get_running_partition(void) {
+
+  return &s_running.info;
+}
+
+extern "C" const esp_partition_t *esp_ota_get_boot_partition(void) {
+
+  return &s_boot->info;
+}
+
+extern "C" const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from) {
+
+  (void) start_from;
+  return &s_partitions[1].info;
+}
+
+extern "C" esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size,
+                                   esp_ota_handle_t *out_handle) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  sim_partition *p = s_Partition(partition);
+  if (!p || !out_handle || p->info.type != ESP_PARTITION_TYPE_APP)
+    return ESP_ERR_INVALID_ARG;
+  if (p == &s_running)
+    return ESP_ERR_OTA_PARTITION_CONFLICT;
+  if (image_size < OTA_WITH_SEQUENTIAL_WRITES && image_size > p->info.size)
+    return ESP_ERR_INVALID_SIZE;
+  s_Data(*p).assign(p->info.size, 0xff);
+  s_ota_target = p;
+  s_ota_written = 0;
+  *out_handle = ++s_ota_handle;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  if (!s_ota_target || handle != s_ota_handle)
+    return ESP_ERR_INVALID_ARG;
+  if (s_ota_written + size > s_ota_target->info.size)
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(s_ota_target->data.data() + s_ota_written, data, size);
+  s_ota_written += size;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  if (!s_ota_target || handle != s_ota_handle)
+    return ESP_ERR_NOT_FOUND;
+  /* Only the image header magic is checked, not the segments or digest. */
+  bool valid = s_ota_written && s_ota_target->data[0] == c_image_magic;
+  if (!valid) {
+    s_ota_target = nullptr;
+    return ESP_ERR_OTA_VALIDATE_FAILED;
+  }
+  s_boot_size = s_ota_written;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ota_abort(esp_ota_handle_t handle) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  if (!s_ota_target || handle != s_ota_handle)
+    return ESP_ERR_NOT_FOUND;
+  s_ota_target = nullptr;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition) {
+
+  std::lock_guard<std::mutex> guard(s_flash_lock);
+  sim_partition *p = s_Partition(partition);
+  if (!p || p->info.type != ESP_PARTITION_TYPE_APP)
+    return ESP_ERR_INVALID_ARG;
+  if (p != &s_running && p != s_ota_target)
+    return ESP_ERR_OTA_VALIDATE_FAILED;
+  s_boot = p;
+  s_ota_target = nullptr;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ota_mark_app_valid_cancel_rollback(void) {
+
+  return ESP_OK;
+}
+
+void sim::SetRestartImage(const std::string &path) {
+
+  s_restart_image = path;
+}
+
+extern "C" void esp_restart(void) {
+
+  printf("esp_restart(): booting %s\n", s_boot->info.label);
+  if (!s_restart_image.empty() && s_boot != &s_running) {
+    std::ofstream file(s_restart_image, std::ios::binary);
+    file.write((const char*) s_boot->data.data(), s_boot_size);
+    if (!file)
+      fprintf(stderr, "Cannot write %s\n", s_restart_image.c_str());
+  }
+  fflush(stdout);
+  _exit(0);
+}
+
+/* HTTP client, https://HOST/PATH serves the local file /PATH */
+
+struct esp_http_client {
+  std::string path;
+  std::ifstream file;
+  int64_t length;
+  int64_t read;
+  int status;
+};
+
+extern "C" esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+
+  if (!config || !config->url)
+    return nullptr;
+  esp_http_client *client = new esp_http_client {};
+  client->path = config->url;
+  return client;
+}
+
+extern "C" esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len) {
+
+  (void) write_len;
+  static const std::string scheme = "https://";
+  size_t path = client->path.find('/', scheme.size());
+  if (client->path.rfind(scheme, 0) != 0 || path == std::string::npos) {
+    ESP_LOGE("HTTP", "The simulator only serves https://HOST/PATH URLs");
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  client->file.open(client->path.substr(path), std::ios::binary | std::ios::ate);
+  client->status = client->file ? 200 : 404;
+  client->length = client->file ? (int64_t) client->file.tellg() : 0;
+  client->file.seekg(0);
+  return ESP_OK;
+}
+
+extern "C" int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client) {
+
+  return client->length;
+}
+
+extern "C" int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+
+  return client->status;
+}
+
+extern "C" int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len) {
+
+  if (!client->file)
+    return client->status == 200 ? 0 : -1;
+  client->file.read(buffer, len);
+  client->read += client->file.gcount();
+  return client->file.gcount();
+}
+
+extern "C" bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client) {
+
+  return client->read == client->length;
+}
+
+extern "C" esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+
+  client->file.close();
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+
+  delete client;
+  return ESP_OK;
+}
@@ -0,0 +1,832 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file freertos.cpp
+ *
+ * @brief FreeRTOS kernel shim: tasks are host threads, the kernel objects are
+ * built on mutexes and condition variables. Priorities are recorded only, so
+ * the host scheduler decides which ready task runs.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const Clock::time_point s_epoch = Clock::now();
+static std::recursive_mutex s_critical;
+static thread_local bool t_in_isr;
+
+namespace sim {
+
+int64_t NowUs() {
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - s_epoch).count();
+}
+
+void RunIsr(void (*fn)(void *args), void *args) {
+
+  std::lock_guard<std::recursive_mutex> guard(s_critical);
+  t_in_isr = true;
+  fn(args);
+  t_in_isr = false;
+}
+
+} // namespace sim
+
+/* Wait on cv until pred holds or ticks elapse, portMAX_DELAY waits forever. */
+template <typename Pred>
+static bool s_Wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks,
+                   Pred pred) {
+
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, pred);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds((uint64_t) ticks * portTICK_PERIOD_MS), pred);
+}
+
+extern "C" void SimCriticalEnter(void) {
+
+  s_critical.lock();
+}
+
+extern "C" void SimCriticalExit(void) {
+
+  s_critical.unlock();
+}
+
+extern "C" BaseType_t xPortInIsrContext(void) {
+
+  return t_in_isr;
+}
+
+extern "C" void SimYieldFromIsr(BaseType_t woken) {
+
+  (void) woken;
+}
+
+/* Tasks */
+
+struct sim_task {
+  std::string name;
+  UBaseType_t priority;
+  uint32_t stack_depth;
+  UBaseType_t number;
+  TaskFunction_t fn;
+  void *args;
+  pthread_t thread;
+  std::atomic<bool> deleted {false};
+
+  std::mutex lock;
+  std::condition_variable cv;
+  uint32_t value = 0;
+  bool pending = false;
+};
+
+static std::mutex s_tasks_lock;
+static std::vector<sim_task*> s_tasks;
+static thread_local sim_task *t_current;
+
+static sim_task *s_Register(const char *name, uint32_t stack_depth, UBaseType_t priority) {
+
+  sim_task *task = new sim_task;
+  task->name = name ? name : "";
+  task->stack_depth = stack_depth;
+  task->priority = priority;
+  std::lock_guard<std::mutex> guard(s_tasks_lock);
+  task->number = s_tasks.size() + 1;
+  s_tasks.push_back(task);
+  return task;
+}
+
+static sim_task *s_Current() {
+
+  /* Threads not created by xTaskCreate(), e.g. the host main thread. */
+  if (!t_current) {
+    t_current = s_Register("host", 0, 0);
+    t_current->thread = pthread_self();
+  }
+  return t_current;
+}
+
+static void *s_TaskEntry(void *args) {
+
+  sim_task *task = static_cast<sim_task*>(args);
+  t_current = task;
+  pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+  task->fn(task->args);
+  ESP_LOGE("SIM", "Task %s returned from its function", task->name.c_str());
+  task->deleted = true;
+  return nullptr;
+}
+
+extern "C" BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                              uint32_t stack_depth, void *args,
+                                              UBaseType_t priority, TaskHandle_t *handle,
+                                              BaseType_t core) {
+
+  (void) core;
+  sim_task *task = s_Register(name, stack_depth, priority);
+  task->fn = fn;
+  task->args = args;
+
+  /* Host code needs far more stack than the firmware budget. */
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 1024 * 1024);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if (handle)
+    *handle = task;
+  int rc = pthread_create(&task->thread, &attr, s_TaskEntry, task);
+  pthread_attr_destroy(&attr);
+  if (rc) {
+    task->deleted = true;
+    return pdFAIL;
+  }
+  return pdPASS;
+}
+
+extern "C" BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                  void *args, UBaseType_t priority, TaskHandle_t *handle) {
+
+  return xTaskCreatePinnedToCore(fn, name, stack_depth, args, priority, handle, tskNO_AFFINITY);
+}
+
+extern "C" void vTaskDelete(TaskHandle_t task) {
+
+  sim_task *self = s_Current();
+  if (!task || task == self) {
+    self->deleted = true;
+    pthread_exit(nullptr);
+  }
+  /* Host threads cannot be killed safely; the task just stops counting. */
+  ESP_LOGW("SIM", "vTaskDelete(%s) from another task is not simulated", task->name.c_str());
+  task->deleted = true;
+}
+
+extern "C" TickType_t xTaskGetTickCount(void) {
+
+  return sim::NowUs() / 1000 / portTICK_PERIOD_MS;
+}
+
+extern "C" TickType_t xTaskGetTickCountFromISR(void) {
+
+  return xTaskGetTickCount();
+}
+
+static void s_SleepUntilTick(TickType_t tick) {
+
+  std::this_thread::sleep_until(s_epoch + std::chrono::milliseconds((uint64_t) tick * portTICK_PERIOD_MS));
+}
+
+extern "C" void vTaskDelay(TickType_t ticks) {
+
+  /* Like the kernel, wake on a tick boundary. */
+  if (!ticks)
+    std::this_thread::yield();
+  else
+    s_SleepUntilTick(xTaskGetTickCount() + ticks);
+}
+
+extern "C" BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+
+  TickType_t wake = *previous_wake + increment;
+  *previous_wake = wake;
+  if ((int32_t)(wake - xTaskGetTickCount()) <= 0)
+    return pdFALSE;
+  s_SleepUntilTick(wake);
+  return pdTRUE;
+}
+
+extern "C" TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+
+  return s_Current();
+}
+
+extern "C" TaskHandle_t xTaskGetHandle(const char *name) {
+
+  std::lock_guard<std::mutex> guard(s_tasks_lock);
+  for (sim_task *task : s_tasks) {
+    if (!task->deleted && task->name == name)
+      return task;
+  }
+  return nullptr;
+}
+
+extern "C" char *pcTaskGetName(TaskHandle_t task) {
+
+  return (char*) (task ? task : s_Current())->name.c_str();
+}
+
+extern "C" UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+
+  return (task ? task : s_Current())->priority;
+}
+
+extern "C" UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+
+  /* Stack use of host threads says nothing about the target, report the
+   * whole budget as unused. */
+  return (task ? task : s_Current())->stack_depth;
+}
+
+extern "C" UBaseType_t uxTaskGetNumberOfTasks(void) {
+
+  std::lock_guard<std::mutex> guard(s_tasks_lock);
+  UBaseType_t count = 0;
+  for (sim_task *task : s_tasks)
+    count += !task->deleted;
+  return count;
+}
+
+extern "C" UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size,
+                                            uint32_t *total_run_time) {
+
+  std::lock_guard<std::mutex> guard(s_tasks_lock);
+  UBaseType_t count = 0;
+  for (sim_task *task : s_tasks) {
+    if (task->deleted || count == size)
+      continue;
+    /* Run time counters are the host CPU time of each thread, in us. */
+    clockid_t clock;
+    struct timespec ts = {};
+    if (!pthread_getcpuclockid(task->thread, &clock))
+      clock_gettime(clock, &ts);
+    status[count] = {};
+    status[count].xHandle = task;
+    status[count].pcTaskName = task->name.c_str();
+    status[count].xTaskNumber = task->number;
+    status[count].eCurrentState = task == t_current ? eRunning : eBlocked;
+    status[count].uxCurrentPriority = task->priority;
+    status[count].uxBasePriority = task->priority;
+    status[count].ulRunTimeCounter = ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    status[count].usStackHighWaterMark = task->stack_depth;
+    status[count].xCoreID = tskNO_AFFINITY;
+    count++;
+  }
+  if (total_run_time)
+    *total_run_time = sim::NowUs();
+  return count;
+}
+
+extern "C" uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+
+  sim_task *task = s_Current();
+  std::unique_lock<std::mutex> lock(task->lock);
+  if (!s_Wait(task->cv, lock, ticks, [task] { return task->value != 0; }))
+    return 0;
+  uint32_t value = task->value;
+  task->value = clear_on_exit ? 0 : value - 1;
+  task->pending = false;
+  return value;
+}
+
+extern "C" BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit,
+                                      uint32_t *value, TickType_t ticks) {
+
+  sim_task *task = s_Current();
+  std::unique_lock<std::mutex> lock(task->lock);
+  if (!task->pending)
+    task->value &= ~clear_on_entry;
+  bool notified = s_Wait(task->cv, lock, ticks, [task] { return task->pending; });
+  if (value)
+    *value = task->value;
+  if (notified) {
+    task->value &= ~clear_on_exit;
+    task->pending = false;
+  }
+  return notified ? pdTRUE : pdFALSE;
+}
+
+extern "C" BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+
+  std::lock_guard<std::mutex> guard(task->lock);
+  switch (action) {
+  case eSetBits:
+    task->value |= value;
+    break;
+  case eIncrement:
+    task->value++;
+    break;
+  case eSetValueWithOverwrite:
+    task->value = value;
+    break;
+  case eSetValueWithoutOverwrite:
+    if (task->pending)
+      return pdFAIL;
+    task->value = value;
+    break;
+  case eNoAction:
+    break;
+  }
+  task->pending = true;
+  task->cv.notify_all();
+  return pdPASS;
+}
+
+extern "C" BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+                                         BaseType_t *woken) {
+
+  if (woken)
+    *woken = pdTRUE;
+  return xTaskNotify(task, value, action);
+}
+
+extern "C" void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+
+  xTaskNotifyFromISR(task, 0, eIncrement, woken);
+}
+
+/* Queues */
+
+struct sim_queue {
+  std::mutex lock;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t item_size;
+};
+
+extern "C" QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+
+  sim_queue *queue = new sim_queue;
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+
+extern "C" void vQueueDelete(QueueHandle_t queue) {
+
+  delete queue;
+}
+
+static BaseType_t s_QueueSend(QueueHandle_t queue, const void *item, TickType_t ticks, bool front) {
+
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!s_Wait(queue->cv, lock, ticks, [queue] { return queue->items.size() < queue->length; }))
+    return pdFAIL;
+  const uint8_t *bytes = static_cast<const uint8_t*>(item);
+  std::vector<uint8_t> copy(bytes, bytes + queue->item_size);
+  if (front)
+    queue->items.push_front(std::move(copy));
+  else
+    queue->items.push_back(std::move(copy));
+  queue->cv.notify_all();
+  return pdPASS;
+}
+
+extern "C" BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+
+  return s_QueueSend(queue, item, ticks, false);
+}
+
+extern "C" BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks) {
+
+  return s_QueueSend(queue, item, ticks, true);
+}
+
+extern "C" BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken) {
+
+  if (woken)
+    *woken = pdTRUE;
+  return s_QueueSend(queue, item, 0, false);
+}
+
+extern "C" BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+
+  std::lock_guard<std::mutex> guard(queue->lock);
+  const uint8_t *bytes = static_cast<const uint8_t*>(item);
+  queue->items.clear();
+  queue->items.emplace_back(bytes, bytes + queue->item_size);
+  queue->cv.notify_all();
+  return pdPASS;
+}
+
+static BaseType_t s_QueueReceive(QueueHandle_t queue, void *item, TickType_t ticks, bool remove) {
+
+  std::unique_lock<std::mutex> lock(queue->lock);
+  if (!s_Wait(queue->cv, lock, ticks, [queue] { return !queue->items.empty(); }))
+    return pdFAIL;
+  memcpy(item, queue->items.front().data(), queue->item_size);
+  if (remove) {
+    queue->items.pop_front();
+    queue->cv.notify_all();
+  }
+  return pdPASS;
+}
+
+extern "C" BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+
+  return s_QueueReceive(queue, item, ticks, true);
+}
+
+extern "C" BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken) {
+
+  if (woken)
+    *woken = pdTRUE;
+  return s_QueueReceive(queue, item, 0, true);
+}
+
+extern "C" BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks) {
+
+  return s_QueueReceive(queue, item, ticks, false);
+}
+
+extern "C" UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->items.size();
+}
+
+extern "C" UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->length - queue->items.size();
+}
+
+extern "C" BaseType_t xQueueReset(QueueHandle_t queue) {
+
+  std::lock_guard<std::mutex> guard(queue->lock);
+  queue->items.clear();
+  queue->cv.notify_all();
+  return pdPASS;
+}
+
+/* Semaphores and mutexes */
+
+struct sim_semaphore {
+  std::mutex lock;
+  std::condition_variable cv;
+  UBaseType_t count;
+  UBaseType_t max;
+  bool mutex;
+  bool recursive;
+  sim_task *owner = nullptr;
+  unsigned depth = 0;
+};
+
+static SemaphoreHandle_t s_SemaphoreCreate(UBaseType_t max, UBaseType_t initial, bool mutex,
+                                           bool recursive) {
+
+  sim_semaphore *semaphore = new sim_semaphore;
+  semaphore->max = max;
+  semaphore->count = initial;
+  semaphore->mutex = mutex;
+  semaphore->recursive = recursive;
+  return semaphore;
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+
+  return s_SemaphoreCreate(1, 1, true, false);
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+
+  return s_SemaphoreCreate(1, 1, true, true);
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+
+  return s_SemaphoreCreate(1, 0, false, false);
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+
+  return s_SemaphoreCreate(max, initial, false, false);
+}
+
+extern "C" void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+
+  delete semaphore;
+}
+
+extern "C" BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+
+  sim_task *self = s_Current();
+  std::unique_lock<std::mutex> lock(semaphore->lock);
+  if (semaphore->recursive && semaphore->owner == self) {
+    semaphore->depth++;
+    return pdPASS;
+  }
+  if (!s_Wait(semaphore->cv, lock, ticks, [semaphore] { return semaphore->count > 0; }))
+    return pdFAIL;
+  semaphore->count--;
+  if (semaphore->mutex) {
+    semaphore->owner = self;
+    semaphore->depth = 1;
+  }
+  return pdPASS;
+}
+
+extern "C" BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+
+  std::lock_guard<std::mutex> guard(semaphore->lock);
+  if (semaphore->mutex) {
+    if (semaphore->owner != s_Current())
+      return pdFAIL;
+    if (--semaphore->depth)
+      return pdPASS;
+    semaphore->owner = nullptr;
+  }
+  if (semaphore->count >= semaphore->max)
+    return pdFAIL;
+  semaphore->count++;
+  semaphore->cv.notify_all();
+  return pdPASS;
+}
+
+extern "C" BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken) {
+
+  if (woken)
+    *woken = pdTRUE;
+  return xSemaphoreGive(semaphore);
+}
+
+extern "C" BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken) {
+
+  if (woken)
+    *woken = pdFALSE;
+  return xSemaphoreTake(semaphore, 0);
+}
+
+extern "C" UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+
+  std::lock_guard<std::mutex> guard(semaphore->lock);
+  return semaphore->count;
+}
+
+/* Event groups */
+
+struct sim_event_group {
+  std::mutex lock;
+  std::condition_variable cv;
+  EventBits_t bits = 0;
+};
+
+extern "C" EventGroupHandle_t xEventGroupCreate(void) {
+
+  return new sim_event_group;
+}
+
+extern "C" void vEventGroupDelete(EventGroupHandle_t group) {
+
+  delete group;
+}
+
+extern "C" EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+
+  std::lock_guard<std::mutex> guard(group->lock);
+  group->bits |= bits;
+  group->cv.notify_all();
+  return group->bits;
+}
+
+extern "C" BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits,
+                                                BaseType_t *woken) {
+
+  if (woken)
+    *woken = pdTRUE;
+  xEventGroupSetBits(group, bits);
+  return pdPASS;
+}
+
+extern "C" EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+
+  std::lock_guard<std::mutex> guard(group->lock);
+  EventBits_t previous = group->bits;
+  group->bits &= ~bits;
+  return previous;
+}
+
+extern "C" EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+
+  std::lock_guard<std::mutex> guard(group->lock);
+  return group->bits;
+}
+
+extern "C" EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                           BaseType_t clear_on_exit, BaseType_t wait_for_all,
+                                           TickType_t ticks) {
+
+  std::unique_lock<std::mutex> lock(group->lock);
+  auto done = [group, bits, wait_for_all] {
+    return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+  };
+  bool met = s_Wait(group->cv, lock, ticks, done);
+  EventBits_t value = group->bits;
+  if (met && clear_on_exit)
+    group->bits &= ~bits;
+  return value;
+}
+
+/* Timer services */
+
+namespace sim {
+
+TimerService::TimerService(const char *task_name, UBaseType_t priority) :
+    m_task_name(task_name),
+    m_priority(priority) {
+}
+
+void TimerService::mEnsureStarted() {
+
+  if (!m_started) {
+    m_started = true;
+    xTaskCreate(mTask, m_task_name, 4096, this, m_priority, nullptr);
+  }
+}
+
+void TimerService::Start(Timer *timer, int64_t delay_us, int64_t period_us) {
+
+  std::lock_guard<std::mutex> guard(m_lock);
+  mEnsureStarted();
+  timer->active = true;
+  timer->period_us = period_us;
+  timer->generation++;
+  m_queue.emplace(NowUs() + delay_us, std::make_pair(timer, timer->generation));
+  m_cv.notify_all();
+}
+
+void TimerService::Stop(Timer *timer) {
+
+  std::lock_guard<std::mutex> guard(m_lock);
+  timer->active = false;
+  timer->generation++;
+}
+
+bool TimerService::IsActive(Timer *timer) {
+
+  std::lock_guard<std::mutex> guard(m_lock);
+  return timer->active;
+}
+
+void TimerService::Post(int64_t delay_us, std::function<void()> callback) {
+
+  Timer *timer = new Timer;
+  timer->callback = std::move(callback);
+  timer->owned = true;
+  Start(timer, delay_us, 0);
+}
+
+void TimerService::mTask(void *args) {
+
+  TimerService *self = static_cast<TimerService*>(args);
+  std::unique_lock<std::mutex> lock(self->m_lock);
+  while (true) {
+    if (self->m_queue.empty()) {
+      self->m_cv.wait(lock);
+      continue;
+    }
+    auto next = self->m_queue.begin();
+    int64_t due = next->first;
+    if (due > NowUs()) {
+      self->m_cv.wait_until(lock, s_epoch + std::chrono::microseconds(due));
+      continue;
+    }
+    Timer *timer = next->second.first;
+    uint64_t generation = next->second.second;
+    self->m_queue.erase(next);
+    if (!timer->active || timer->generation != generation)
+      continue;
+
+    if (timer->period_us)
+      self->m_queue.emplace(due + timer->period_us, std::make_pair(timer, generation));
+    else
+      timer->active = false;
+
+    std::function<void()> callback = timer->callback;
+    lock.unlock();
+    callback();
+    if (timer->owned)
+      delete timer;
+    lock.lock();
+  }
+}
+
+TimerService &Peripherals() {
+
+  static TimerService service("sim_periph", configMAX_PRIORITIES - 1);
+  return service;
+}
+
+void After(int64_t delay_us, std::function<void()> callback) {
+
+  Peripherals().Post(delay_us, std::move(callback));
+}
+
+} // namespace sim
+
+/* FreeRTOS software timers */
+
+struct sim_timer {
+  sim::TimerService::Timer timer;
+  std::string name;
+  TickType_t period;
+  bool auto_reload;
+  void *id;
+};
+
+static sim::TimerService &s_TimerTask() {
+
+  static sim::TimerService service("Tmr Svc", 1);
+  return service;
+}
+
+extern "C" TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                                      void *id, TimerCallbackFunction_t callback) {
+
+  if (!period)
+    return nullptr;
+  sim_timer *timer = new sim_timer;
+  timer->name = name ? name : "";
+  timer->period = period;
+  timer->auto_reload = auto_reload;
+  timer->id = id;
+  timer->timer.callback = [timer, callback] { callback(timer); };
+  return timer;
+}
+
+extern "C" BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks) {
+
+  (void) ticks;
+  s_TimerTask().Stop(&timer->timer);
+  return pdPASS;
+}
+
+extern "C" BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks) {
+
+  (void) ticks;
+  int64_t period_us = (int64_t) timer->period * portTICK_PERIOD_MS * 1000;
+  s_TimerTask().Start(&timer->timer, period_us, timer->auto_reload ? period_us : 0);
+  return pdPASS;
+}
+
+extern "C" BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks) {
+
+  return xTimerStart(timer, ticks);
+}
+
+extern "C" BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks) {
+
+  (void) ticks;
+  s_TimerTask().Stop(&timer->timer);
+  return pdPASS;
+}
+
+extern "C" BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks) {
+
+  timer->period = period;
+  return xTimerStart(timer, ticks);
+}
+
+extern "C" BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+
+  return s_TimerTask().IsActive(&timer->timer);
+}
+
+extern "C" void *pvTimerGetTimerID(TimerHandle_t timer) {
+
+  return timer->id;
+}
@@ -0,0 +1,340 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file gpio.cpp
+ *
+ * @brief Virtual GPIO block with its interrupt status registers, and the LEDC
+ * PWM channels.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "soc/gpio_reg.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+struct gpio_pin {
+  gpio_mode_t mode = GPIO_MODE_DISABLE;
+  gpio_int_type_t intr_type = GPIO_INTR_DISABLE;
+  int input = 1;
+  int output = 0;
+};
+
+static std::mutex s_gpio_lock;
+static gpio_pin s_pins[GPIO_NUM_MAX];
+static uint64_t s_status;
+static void (*s_isr)(void *args);
+static void *s_isr_args;
+
+static void s_RunIsr(std::function<void()> fn) {
+
+  sim::RunIsr([](void *args) { (*static_cast<std::function<void()>*>(args))(); }, &fn);
+}
+
+extern "C" uint32_t SimRegRead(uint32_t addr) {
+
+  std::lock_guard<std::mutex> guard(s_gpio_lock);
+  switch (addr) {
+  case GPIO_STATUS_REG:
+    return s_status;
+  case GPIO_STATUS1_REG:
+    return s_status >> 32;
+  default:
+    return 0;
+  }
+}
+
+extern "C" void SimRegWrite(uint32_t addr, uint32_t value) {
+
+  std::lock_guard<std::mutex> guard(s_gpio_lock);
+  switch (addr) {
+  case GPIO_STATUS_W1TC_REG:
+    s_status &= ~(uint64_t) value;
+    break;
+  case GPIO_STATUS1_W1TC_REG:
+    s_status &= ~((uint64_t) value << 32);
+    break;
+  default:
+    break;
+  }
+}
+
+extern "C" esp_err_t gpio_config(const gpio_config_t *config) {
+
+  if (!config || config->pin_bit_mask >> GPIO_NUM_MAX)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_gpio_lock);
+  for (int gpio = 0; gpio < GPIO_NUM_MAX; gpio++) {
+    if (config->pin_bit_mask & (1ULL << gpio)) {
+      s_pins[gpio].mode = config->mode;
+      s_pins[gpio].intr_type = config->intr_type;
+    }
+  }
+  return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_isr_register(void (*fn)(void *args), void *args, int intr_alloc_flags,
+                                       gpio_isr_handle_t *handle) {
+
+  (void) intr_alloc_flags;
+  std::lock_guard<std::mutex> guard(s_gpio_lock);
+  if (s_isr)
+    return ESP_ERR_INVALID_STATE;
+  s_isr = fn;
+  s_isr_args = args;
+  if (handle)
+    *handle = nullptr;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) {
+
+  if (gpio < 0 || gpio >= GPIO_NUM_MAX)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_gpio_lock);
+  s_pins[gpio].output = !!level;
+  return ESP_OK;
+}
+
+extern "C" int gpio_get_level(gpio_num_t gpio) {
+
+  if (gpio < 0 || gpio >= GPIO_NUM_MAX)
+    return 0;
+  std::lock_guard<std::mutex> guard(s_gpio_lock);
+  gpio_pin &pin = s_pins[gpio];
+  return pin.mode == GPIO_MODE_OUTPUT ? pin.output : pin.input;
+}
+
+void sim::GpioSetInput(int gpio, int level) {
+
+  if (gpio < 0 || gpio >= GPIO_NUM_MAX)
+    return;
+
+  bool raise;
+  void (*isr)(void *args);
+  void *isr_args;
+  {
+    std::lock_guard<std::mutex> guard(s_gpio_lock);
+    gpio_pin &pin = s_pins[gpio];
+    int previous = pin.input;
+    pin.input = !!level;
+    switch (pin.intr_type) {
+    case GPIO_INTR_POSEDGE:
+      raise = !previous && pin.input;
+      break;
+    case GPIO_INTR_NEGEDGE:
+      raise = previous && !pin.input;
+      break;
+    case GPIO_INTR_ANYEDGE:
+      raise = previous != pin.input;
+      break;
+    case GPIO_INTR_LOW_LEVEL:
+      raise = !pin.input;
+      break;
+    case GPIO_INTR_HIGH_LEVEL:
+      raise = pin.input;
+      break;
+    default:
+      raise = false;
+      break;
+    }
+    if (raise)
+      s_status |= 1ULL << gpio;
+    isr = s_isr;
+    isr_args = s_isr_args;
+  }
+  if (raise && isr)
+    sim::RunIsr(isr, isr_args);
+}
+
+int sim::GpioGetOutput(int gpio) {
+
+  if (gpio < 0 || gpio >= GPIO_NUM_MAX)
+    return 0;
+  std::lock_guard<std::mutex> guard(s_gpio_lock);
+  return s_pins[gpio].output;
+}
+
+/* LEDC */
+
+struct ledc_chan {
+  uint32_t duty = 0;
+  uint32_t from = 0;
+  uint32_t target = 0;
+  int fade_ms = 0;
+  int64_t fade_start_us = 0;
+  bool fading = false;
+  uint64_t generation = 0;
+  ledc_cb_t fade_cb = nullptr;
+  void *user_arg = nullptr;
+};
+
+static std::mutex s_ledc_lock;
+static ledc_chan s_channels[LEDC_CHANNEL_MAX];
+static bool s_fade_installed;
+
+/* Duty of a channel now, interpolating a running fade. */
+static uint32_t s_Duty(const ledc_chan &chan) {
+
+  if (!chan.fading || !chan.fade_ms)
+    return chan.duty;
+  int64_t elapsed = sim::NowUs() - chan.fade_start_us;
+  int64_t span = (int64_t) chan.fade_ms * 1000;
+  if (elapsed >= span)
+    return chan.target;
+  return chan.from + ((int64_t) chan.target - chan.from) * elapsed / span;
+}
+
+extern "C" esp_err_t ledc_timer_config(const ledc_timer_config_t *config) {
+
+  return config && config->freq_hz ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+extern "C" esp_err_t ledc_channel_config(const ledc_channel_config_t *config) {
+
+  if (!config || config->channel >= LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_ledc_lock);
+  ledc_chan &chan = s_channels[config->channel];
+  chan.duty = config->duty;
+  chan.fading = false;
+  chan.generation++;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_fade_func_install(int intr_alloc_flags) {
+
+  (void) intr_alloc_flags;
+  if (s_fade_installed)
+    return ESP_ERR_INVALID_STATE;
+  s_fade_installed = true;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t channel,
+                                             uint32_t target_duty, int max_fade_time_ms) {
+
+  if (mode != LEDC_LOW_SPEED_MODE || channel >= LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+  if (!s_fade_installed)
+    return ESP_ERR_INVALID_STATE;
+  std::lock_guard<std::mutex> guard(s_ledc_lock);
+  ledc_chan &chan = s_channels[channel];
+  if (chan.fading)
+    return ESP_ERR_INVALID_STATE;
+  chan.target = target_duty;
+  chan.fade_ms = max_fade_time_ms;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t channel,
+                                     ledc_fade_mode_t fade_mode) {
+
+  if (mode != LEDC_LOW_SPEED_MODE || channel >= LEDC_CHANNEL_MAX || fade_mode != LEDC_FADE_NO_WAIT)
+    return ESP_ERR_INVALID_ARG;
+
+  uint64_t generation;
+  int fade_ms;
+  {
+    std::lock_guard<std::mutex> guard(s_ledc_lock);
+    ledc_chan &chan = s_channels[channel];
+    chan.from = chan.duty;
+    chan.fade_start_us = sim::NowUs();
+    chan.fading = true;
+    generation = ++chan.generation;
+    fade_ms = chan.fade_ms;
+  }
+
+  sim::After((int64_t) fade_ms * 1000, [channel, generation] {
+    ledc_cb_t callback;
+    void *user_arg;
+    ledc_cb_param_t param = {};
+    {
+      std::lock_guard<std::mutex> guard(s_ledc_lock);
+      ledc_chan &chan = s_channels[channel];
+      if (chan.generation != generation)
+        return;
+      chan.fading = false;
+      chan.duty = chan.target;
+      callback = chan.fade_cb;
+      user_arg = chan.user_arg;
+      param.event = LEDC_FADE_END_EVT;
+      param.speed_mode = LEDC_LOW_SPEED_MODE;
+      param.channel = channel;
+      param.duty = chan.duty;
+    }
+    if (callback)
+      s_RunIsr([&] { callback(&param, user_arg); });
+  });
+  return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t channel) {
+
+  if (mode != LEDC_LOW_SPEED_MODE || channel >= LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_ledc_lock);
+  ledc_chan &chan = s_channels[channel];
+  chan.duty = s_Duty(chan);
+  chan.fading = false;
+  chan.generation++;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_set_duty_and_update(ledc_mode_t mode, ledc_channel_t channel,
+                                              uint32_t duty, uint32_t hpoint) {
+
+  (void) hpoint;
+  if (mode != LEDC_LOW_SPEED_MODE || channel >= LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_ledc_lock);
+  ledc_chan &chan = s_channels[channel];
+  chan.duty = duty;
+  chan.fading = false;
+  chan.generation++;
+  return ESP_OK;
+}
+
+extern "C" uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel) {
+
+  if (mode != LEDC_LOW_SPEED_MODE || channel >= LEDC_CHANNEL_MAX)
+    return 0;
+  std::lock_guard<std::mutex> guard(s_ledc_lock);
+  return s_Duty(s_channels[channel]);
+}
+
+extern "C" esp_err_t ledc_cb_register(ledc_mode_t mode, ledc_channel_t channel, ledc_cbs_t *cbs,
+                                      void *user_arg) {
+
+  if (mode != LEDC_LOW_SPEED_MODE || channel >= LEDC_CHANNEL_MAX || !cbs)
+    return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> guard(s_ledc_lock);
+  s_channels[channel].fade_cb = cbs->fade_cb;
+  s_channels[channel].user_arg = user_arg;
+  return ESP_OK;
+}
@@ -0,0 +1,10 @@
+/* Host simulator shim, interrupt flags are accepted and ignored. */
+#pragma once
+
+#define ESP_INTR_FLAG_LEVEL1   (1 << 1)
+#define ESP_INTR_FLAG_SHARED   (1 << 8)
+#define ESP_INTR_FLAG_EDGE     (1 << 9)
+#define ESP_INTR_FLAG_IRAM     (1 << 10)
+#define ESP_INTR_FLAG_LOWMED   (ESP_INTR_FLAG_LEVEL1 | (1 << 2) | (1 << 3))
+
+typedef struct intr_handle_data_t *intr_handle_t;
@@ -0,0 +1,43 @@
+/* Host simulator shim of the ESP-IDF logging macros. */
+#pragma once
+
+#include <stdint.h>
+#include <inttypes.h>
+#include "esp_err.h"
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+uint32_t esp_log_timestamp(void);
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define ESP_LOG_LEVEL_LETTER_(level)                                         \
+  ((level) == ESP_LOG_ERROR ? 'E' : (level) == ESP_LOG_WARN ? 'W' :          \
+   (level) == ESP_LOG_INFO ? 'I' : (level) == ESP_LOG_DEBUG ? 'D' : 'V')
+
+#define ESP_LOG_LEVEL(level, tag, format, ...)                               \
+  esp_log_write(level, tag, "%c (%" PRIu32 ") %s: " format "\n",             \
+                ESP_LOG_LEVEL_LETTER_(level), esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...) ESP_LOG_LEVEL(level, tag, format, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,14 @@
+/* Host simulator shim, the network is always up. */
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_netif_init(void);
+
+#ifdef __cplusplus
+}
+#endif
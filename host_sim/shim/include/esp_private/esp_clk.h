@@ -0,0 +1,12 @@
+/* Host simulator shim, reports the ESP32-S2 default CPU clock. */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int esp_clk_cpu_freq(void);
+
+#ifdef __cplusplus
+}
+#endif
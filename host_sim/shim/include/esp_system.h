@@ -0,0 +1,12 @@
+/* Host simulator shim, esp_restart() ends the simulation. */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_restart(void) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/* Host simulator shim of the FreeRTOS kernel API used by the firmware. Tasks
+ * are host threads; priorities are recorded but not enforced. */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE                  ((BaseType_t) 1)
+#define pdFALSE                 ((BaseType_t) 0)
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t) 0xffffffffUL)
+#define configTICK_RATE_HZ      (100)
+#define portTICK_PERIOD_MS      ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((TickType_t)(ms) * (TickType_t) configTICK_RATE_HZ) / (TickType_t) 1000U))
+#define pdTICKS_TO_MS(ticks)    ((TickType_t)(((uint64_t)(ticks) * (TickType_t) 1000U) / (TickType_t) configTICK_RATE_HZ))
+#define configMAX_PRIORITIES    (25)
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#define tskNO_AFFINITY          (0x7fffffff)
+
+#define BIT0  (1 << 0)
+#define BIT1  (1 << 1)
+#define BIT2  (1 << 2)
+#define BIT3  (1 << 3)
+
+/* Critical sections and ISRs share one recursive lock, so an ISR never runs
+ * inside a critical section, as on the single core ESP32-S2. */
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void SimCriticalEnter(void);
+void SimCriticalExit(void);
+BaseType_t xPortInIsrContext(void);
+void SimYieldFromIsr(BaseType_t woken);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define portENTER_CRITICAL(mux)       SimCriticalEnter()
+#define portEXIT_CRITICAL(mux)        SimCriticalExit()
+#define portENTER_CRITICAL_ISR(mux)   SimCriticalEnter()
+#define portEXIT_CRITICAL_ISR(mux)    SimCriticalExit()
+#define portENTER_CRITICAL_SAFE(mux)  SimCriticalEnter()
+#define portEXIT_CRITICAL_SAFE(mux)   SimCriticalExit()
+#define taskENTER_CRITICAL(mux)       SimCriticalEnter()
+#define taskEXIT_CRITICAL(mux)        SimCriticalExit()
+#define portYIELD_FROM_ISR(woken)     SimYieldFromIsr(woken)
@@ -0,0 +1,14 @@
+/* Host simulator shim, connects after the simulated Wi-Fi association time. */
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t example_connect(void);
+
+#ifdef __cplusplus
+}
+#endif
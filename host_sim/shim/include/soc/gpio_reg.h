@@ -0,0 +1,26 @@
+/* Host simulator shim of the GPIO interrupt status registers, backed by the
+ * virtual GPIO block. */
+#pragma once
+
+#include <stdint.h>
+
+#define GPIO_STATUS_REG        (0x3f40404cu)
+#define GPIO_STATUS_W1TC_REG   (0x3f404054u)
+#define GPIO_STATUS1_REG       (0x3f404058u)
+#define GPIO_STATUS1_W1TC_REG  (0x3f404060u)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t SimRegRead(uint32_t addr);
+void SimRegWrite(uint32_t addr, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define READ_PERI_REG(addr)             SimRegRead(addr)
+#define WRITE_PERI_REG(addr, value)     SimRegWrite((addr), (value))
+#define SET_PERI_REG_MASK(addr, mask)   SimRegWrite((addr), SimRegRead(addr) | (mask))
+#define CLEAR_PERI_REG_MASK(addr, mask) SimRegWrite((addr), SimRegRead(addr) & ~(mask))
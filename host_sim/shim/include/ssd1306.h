@@ -0,0 +1,49 @@
+/* Host simulator shim of the nopnop2002 ssd1306 component. Drawing goes to an
+ * in-memory framebuffer; the I2C traffic the real driver would generate is
+ * counted for each call. */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+  bool _valid;
+  int _segLen;
+  uint8_t _segs[128];
+} PAGE_t;
+
+typedef struct {
+  int _address;
+  int _width;
+  int _height;
+  int _pages;
+  int _dc;
+  bool _scEnable;
+  int _scStart;
+  int _scEnd;
+  int _scDirection;
+  PAGE_t _page[8];
+  bool _flip;
+} SSD1306_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void i2c_master_init(SSD1306_t *dev, int16_t sda, int16_t scl, int16_t reset);
+void ssd1306_init(SSD1306_t *dev, int width, int height);
+int ssd1306_get_width(SSD1306_t *dev);
+int ssd1306_get_height(SSD1306_t *dev);
+int ssd1306_get_pages(SSD1306_t *dev);
+void ssd1306_show_buffer(SSD1306_t *dev);
+void ssd1306_display_image(SSD1306_t *dev, int page, int seg, const uint8_t *images, int width);
+void ssd1306_display_text(SSD1306_t *dev, int page, const char *text, int text_len, bool invert);
+void ssd1306_clear_screen(SSD1306_t *dev, bool invert);
+void ssd1306_clear_line(SSD1306_t *dev, int page, bool invert);
+void ssd1306_contrast(SSD1306_t *dev, int contrast);
+void ssd1306_bitmaps(SSD1306_t *dev, int xpos, int ypos, const uint8_t *bitmap, int width,
+                     int height, bool invert);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,572 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file mqtt_client.cpp
+ *
+ * @brief esp-mqtt shim connected to an in-process broker: retained messages,
+ * +/# routing, QoS acknowledgements and MQTT 5 topic aliases, with a one way
+ * network delay on every packet. A stalled connection loses every packet
+ * without either end noticing, like a half-open TCP connection.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "mqtt_client.h"
+#include "sim.h"
+#include "sim_internal.h"
+
+static const char *s_TAG = "SIM_BROKER";
+
+struct mqtt5_user_property_list_t {
+  std::vector<std::pair<std::string, std::string>> items;
+};
+
+struct subscription {
+  std::string filter;
+  int qos;
+  bool no_local;
+};
+
+struct esp_mqtt_client {
+  std::string uri;
+  esp_mqtt_protocol_ver_t protocol;
+  int task_priority;
+  int reconnect_ms;
+  size_t buffer_size;
+  struct {
+    std::string topic;
+    std::string msg;
+    int qos;
+    int retain;
+  } last_will;
+
+  esp_event_handler_t handler = nullptr;
+  void *handler_arg = nullptr;
+
+  /* Event queue drained by the client's mqtt_task. */
+  std::mutex events_lock;
+  std::condition_variable events_cv;
+  std::deque<std::function<void()>> events;
+  bool task_running = false;
+
+  /* Connection state, guarded by s_lock. */
+  bool started = false;
+  bool connected = false;
+  bool stalled = false;
+  uint64_t connection = 0;
+  uint16_t next_msg_id = 0;
+  uint16_t publish_alias = 0;
+  bool subscribe_no_local = false;
+  std::map<uint16_t, std::string> aliases;
+  std::vector<subscription> subscriptions;
+};
+
+static std::mutex s_lock;
+static std::vector<esp_mqtt_client*> s_clients;
+static std::map<std::string, std::string> s_retained;
+static std::vector<sim::Message> s_log;
+static int64_t s_delay_us = 5000;
+
+static void s_Post(esp_mqtt_client *client, std::function<void()> fn) {
+
+  std::lock_guard<std::mutex> guard(client->events_lock);
+  client->events.push_back(std::move(fn));
+  client->events_cv.notify_one();
+}
+
+static void s_EventTask(void *args) {
+
+  esp_mqtt_client *client = static_cast<esp_mqtt_client*>(args);
+  while (true) {
+    std::function<void()> fn;
+    {
+      std::unique_lock<std::mutex> lock(client->events_lock);
+      client->events_cv.wait(lock, [client] { return !client->events.empty(); });
+      fn = std::move(client->events.front());
+      client->events.pop_front();
+    }
+    fn();
+  }
+}
+
+/* Forward declared for s_Data(). */
+static void s_Event(esp_mqtt_client *client, esp_mqtt_event_id_t id, int msg_id,
+                    std::string topic, std::string data, int qos, bool retain,
+                    int session_present, int offset, int total_len);
+
+/* Deliver a message as ESP-MQTT does: one larger than the receive buffer
+ * arrives in parts, and only the first part has the topic. */
+static void s_Data(esp_mqtt_client *client, const std::string &topic, const std::string &payload,
+                   int qos, bool retain) {
+
+  size_t part = client->buffer_size;
+  if (payload.size() <= part) {
+    s_Event(client, MQTT_EVENT_DATA, 0, topic, payload, qos, retain, 0, 0, -1);
+    return;
+  }
+  for (size_t offset = 0; offset < payload.size(); offset += part)
+    s_Event(client, MQTT_EVENT_DATA, 0, offset ? "" : topic, payload.substr(offset, part), qos,
+            retain, 0, offset, payload.size());
+}
+
+/* Queue an event for the client's handler. Strings are copied, the event
+ * structure points into the copies while the handler runs. */
+static void s_Event(esp_mqtt_client *client, esp_mqtt_event_id_t id, int msg_id,
+                    std::string topic = "", std::string data = "", int qos = 0,
+                    bool retain = false, int session_present = 0, int offset = 0,
+                    int total_len = -1) {
+
+  s_Post(client, [=]() mutable {
+    esp_mqtt_error_codes_t error = {};
+    esp_mqtt5_event_property_t property = {};
+    esp_mqtt_event_t event = {};
+    event.event_id = id;
+    event.client = client;
+    event.msg_id = msg_id;
+    event.topic = topic.empty() ? nullptr : &topic[0];
+    event.topic_len = topic.size();
+    event.data = data.empty() ? nullptr : &data[0];
+    event.data_len = data.size();
+    event.total_data_len = total_len < 0 ? data.size() : total_len;
+    event.current_data_offset = offset;
+    event.qos = qos;
+    event.retain = retain;
+    event.session_present = session_present;
+    event.error_handle = &error;
+    event.protocol_ver = client->protocol;
+    event.property = &property;
+    if (client->handler)
+      client->handler(client->handler_arg, "MQTT_EVENTS", id, &event);
+  });
+}
+
+/* Run fn after delay_us if the connection it was scheduled on still exists. */
+static void s_OnConnection(esp_mqtt_client *client, int64_t delay_us, std::function<void()> fn) {
+
+  uint64_t connection = client->connection;
+  sim::After(delay_us, [client, connection, fn] {
+    {
+      std::lock_guard<std::mutex> guard(s_lock);
+      if (!client->connected || client->stalled || client->connection != connection)
+        return;
+    }
+    fn();
+  });
+}
+
+static bool s_TopicMatches(const std::string &filter, const std::string &topic) {
+
+  size_t f = 0, t = 0;
+  while (f < filter.size()) {
+    size_t f_end = filter.find('/', f);
+    std::string level = filter.substr(f, f_end == std::string::npos ? std::string::npos : f_end - f);
+    if (level == "#")
+      return true;
+    if (t > topic.size())
+      return false;
+    size_t t_end = topic.find('/', t);
+    if (level != "+" &&
+        level != topic.substr(t, t_end == std::string::npos ? std::string::npos : t_end - t))
+      return false;
+    f = f_end == std::string::npos ? filter.size() + 1 : f_end + 1;
+    t = t_end == std::string::npos ? topic.size() + 1 : t_end + 1;
+  }
+  return t > topic.size();
+}
+
+static uint16_t s_NextMsgId(esp_mqtt_client *client) {
+
+  if (!++client->next_msg_id)
+    ++client->next_msg_id;
+  return client->next_msg_id;
+}
+
+/* Broker side handling of a publish, s_lock held. */
+static void s_Route(const std::string &topic, const std::string &payload, int qos, bool retain,
+                    const esp_mqtt_client *sender) {
+
+  if (retain) {
+    if (payload.empty())
+      s_retained.erase(topic);
+    else
+      s_retained[topic] = payload;
+  }
+  for (esp_mqtt_client *client : s_clients) {
+    if (!client->connected)
+      continue;
+    for (const subscription &sub : client->subscriptions) {
+      if ((sub.no_local && client == sender) || !s_TopicMatches(sub.filter, topic))
+        continue;
+      int delivered_qos = std::min(qos, sub.qos);
+      s_OnConnection(client, s_delay_us, [client, topic, payload, delivered_qos] {
+        s_Data(client, topic, payload, delivered_qos, false);
+      });
+      break;
+    }
+  }
+}
+
+static void s_Connect(esp_mqtt_client *client) {
+
+  s_Event(client, MQTT_EVENT_BEFORE_CONNECT, 0);
+  /* TCP handshake, TLS handshake for mqtts://, then CONNECT/CONNACK. */
+  int round_trips = 2 + (client->uri.rfind("mqtts", 0) == 0 ? 2 : 0);
+  sim::After(round_trips * 2 * s_delay_us, [client] {
+    {
+      std::lock_guard<std::mutex> guard(s_lock);
+      if (!client->started || client->connected)
+        return;
+      client->connected = true;
+      client->stalled = false;
+      client->connection++;
+      client->aliases.clear();
+      client->subscriptions.clear();
+    }
+    s_Event(client, MQTT_EVENT_CONNECTED, 0);
+  });
+}
+
+static void s_Disconnect(esp_mqtt_client *client, bool graceful) {
+
+  {
+    std::lock_guard<std::mutex> guard(s_lock);
+    if (!client->connected)
+      return;
+    client->connected = false;
+    if (!graceful && !client->last_will.topic.empty())
+      s_Route(client->last_will.topic, client->last_will.msg, client->last_will.qos,
+              client->last_will.retain, client);
+  }
+  s_Event(client, MQTT_EVENT_DISCONNECTED, 0);
+}
+
+extern "C" esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config) {
+
+  esp_mqtt_client *client = new esp_mqtt_client;
+  esp_mqtt_set_config(client, config);
+  std::lock_guard<std::mutex> guard(s_lock);
+  s_clients.push_back(client);
+  return client;
+}
+
+extern "C" esp_err_t esp_mqtt_set_config(esp_mqtt_client_handle_t client,
+                                         const esp_mqtt_client_config_t *config) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  if (config->broker.address.uri)
+    client->uri = config->broker.address.uri;
+  client->protocol = config->session.protocol_ver ? config->session.protocol_ver
+                                                  : MQTT_PROTOCOL_V_3_1_1;
+  client->task_priority = config->task.priority ? config->task.priority : 5;
+  client->reconnect_ms = config->network.reconnect_timeout_ms ? config->network.reconnect_timeout_ms
+                                                              : 10000;
+  client->buffer_size = config->buffer.size > 0 ? config->buffer.size : 1024;
+  const auto &will = config->session.last_will;
+  client->last_will.topic = will.topic ? will.topic : "";
+  client->last_will.msg = will.msg ? std::string(will.msg, will.msg_len ? will.msg_len : strlen(will.msg)) : "";
+  client->last_will.qos = will.qos;
+  client->last_will.retain = will.retain;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt_client_set_uri(esp_mqtt_client_handle_t client, const char *uri) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  client->uri = uri;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client,
+                                                    esp_mqtt_event_id_t event,
+                                                    esp_event_handler_t event_handler,
+                                                    void *event_handler_arg) {
+
+  (void) event;
+  client->handler = event_handler;
+  client->handler_arg = event_handler_arg;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+
+  {
+    std::lock_guard<std::mutex> guard(s_lock);
+    if (client->started)
+      return ESP_FAIL;
+    client->started = true;
+  }
+  if (!client->task_running) {
+    client->task_running = true;
+    xTaskCreate(s_EventTask, "mqtt_task", 6144, client, client->task_priority, nullptr);
+  }
+  s_Connect(client);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client) {
+
+  {
+    std::lock_guard<std::mutex> guard(s_lock);
+    if (!client->started || client->connected)
+      return ESP_FAIL;
+  }
+  s_Connect(client);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client) {
+
+  s_Disconnect(client, true);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client) {
+
+  s_Disconnect(client, true);
+  std::lock_guard<std::mutex> guard(s_lock);
+  client->started = false;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client) {
+
+  /* The event task may still reference the client, it is never freed. */
+  esp_mqtt_client_stop(client);
+  client->handler = nullptr;
+  return ESP_OK;
+}
+
+extern "C" int esp_mqtt_client_subscribe_single(esp_mqtt_client_handle_t client, const char *topic,
+                                                int qos) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  if (!client->connected)
+    return -1;
+  int msg_id = s_NextMsgId(client);
+  bool no_local = client->subscribe_no_local;
+  client->subscribe_no_local = false;
+  std::string filter = topic;
+  s_OnConnection(client, s_delay_us, [client, filter, qos, no_local, msg_id] {
+    std::vector<std::pair<std::string, std::string>> retained;
+    {
+      std::lock_guard<std::mutex> guard(s_lock);
+      bool replaced = false;
+      for (subscription &sub : client->subscriptions) {
+        if (sub.filter == filter) {
+          sub = {filter, qos, no_local};
+          replaced = true;
+        }
+      }
+      if (!replaced)
+        client->subscriptions.push_back({filter, qos, no_local});
+      for (const auto &message : s_retained) {
+        if (s_TopicMatches(filter, message.first))
+          retained.push_back(message);
+      }
+    }
+    s_OnConnection(client, s_delay_us, [client, msg_id, qos, retained] {
+      s_Event(client, MQTT_EVENT_SUBSCRIBED, msg_id, "", std::string(1, (char) qos));
+      for (const auto &message : retained)
+        s_Data(client, message.first, message.second, qos, true);
+    });
+  });
+  return msg_id;
+}
+
+extern "C" int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t client, const char *topic) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  if (!client->connected)
+    return -1;
+  int msg_id = s_NextMsgId(client);
+  std::string filter = topic;
+  s_OnConnection(client, s_delay_us, [client, filter, msg_id] {
+    {
+      std::lock_guard<std::mutex> guard(s_lock);
+      auto &subs = client->subscriptions;
+      for (auto it = subs.begin(); it != subs.end(); ) {
+        it = it->filter == filter ? subs.erase(it) : it + 1;
+      }
+    }
+    s_OnConnection(client, s_delay_us, [client, msg_id] {
+      s_Event(client, MQTT_EVENT_UNSUBSCRIBED, msg_id);
+    });
+  });
+  return msg_id;
+}
+
+extern "C" int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic,
+                                       const char *data, int len, int qos, int retain) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  uint16_t alias = client->publish_alias;
+  client->publish_alias = 0;
+  if (!client->connected)
+    return -1;
+
+  std::string resolved = topic ? topic : "";
+  if (alias) {
+    if (resolved.empty()) {
+      auto it = client->aliases.find(alias);
+      if (it == client->aliases.end()) {
+        ESP_LOGE(s_TAG, "Unknown topic alias %u", alias);
+        return -1;
+      }
+      resolved = it->second;
+    } else {
+      client->aliases[alias] = resolved;
+    }
+  } else if (resolved.empty()) {
+    return -1;
+  }
+
+  std::string payload = data ? std::string(data, len ? len : strlen(data)) : "";
+  int msg_id = qos ? s_NextMsgId(client) : 0;
+  s_log.push_back({sim::NowUs(), resolved, payload, qos, (bool) retain, true});
+
+  s_OnConnection(client, s_delay_us, [client, resolved, payload, qos, retain, msg_id] {
+    {
+      std::lock_guard<std::mutex> guard(s_lock);
+      s_Route(resolved, payload, qos, retain, client);
+    }
+    if (qos)
+      s_OnConnection(client, s_delay_us, [client, msg_id] {
+        s_Event(client, MQTT_EVENT_PUBLISHED, msg_id);
+      });
+  });
+  return msg_id;
+}
+
+extern "C" int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char *topic,
+                                       const char *data, int len, int qos, int retain, bool store) {
+
+  (void) store;
+  return esp_mqtt_client_publish(client, topic, data, len, qos, retain);
+}
+
+extern "C" int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client) {
+
+  (void) client;
+  return 0;
+}
+
+extern "C" esp_err_t esp_mqtt5_client_set_publish_property(
+    esp_mqtt_client_handle_t client, const esp_mqtt5_publish_property_config_t *property) {
+
+  if (client->protocol != MQTT_PROTOCOL_V_5)
+    return ESP_FAIL;
+  std::lock_guard<std::mutex> guard(s_lock);
+  client->publish_alias = property->topic_alias;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt5_client_set_subscribe_property(
+    esp_mqtt_client_handle_t client, const esp_mqtt5_subscribe_property_config_t *property) {
+
+  if (client->protocol != MQTT_PROTOCOL_V_5)
+    return ESP_FAIL;
+  std::lock_guard<std::mutex> guard(s_lock);
+  client->subscribe_no_local = property->no_local_flag;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_mqtt5_client_set_connect_property(
+    esp_mqtt_client_handle_t client, const esp_mqtt5_connection_property_config_t *property) {
+
+  (void) property;
+  return client->protocol == MQTT_PROTOCOL_V_5 ? ESP_OK : ESP_FAIL;
+}
+
+extern "C" esp_err_t esp_mqtt5_client_set_user_property(mqtt5_user_property_handle_t *user_property,
+                                                        esp_mqtt5_user_property_item_t item[],
+                                                        uint8_t item_num) {
+
+  if (!*user_property)
+    *user_property = new mqtt5_user_property_list_t;
+  for (uint8_t i = 0; i < item_num; i++)
+    (*user_property)->items.emplace_back(item[i].key, item[i].value);
+  return ESP_OK;
+}
+
+extern "C" void esp_mqtt5_client_delete_user_property(mqtt5_user_property_handle_t user_property) {
+
+  delete user_property;
+}
+
+namespace sim {
+
+std::vector<Message> BrokerLog() {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  return s_log;
+}
+
+void BrokerPublish(const std::string &topic, const std::string &payload, bool retain) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  s_log.push_back({NowUs(), topic, payload, 0, retain, false});
+  s_Route(topic, payload, 0, retain, nullptr);
+}
+
+void SetNetworkDelayUs(int64_t delay_us) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  s_delay_us = delay_us;
+}
+
+void BrokerStallAll() {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  for (esp_mqtt_client *client : s_clients)
+    client->stalled = client->connected;
+}
+
+void BrokerDisconnectAll() {
+
+  std::vector<esp_mqtt_client*> clients;
+  {
+    std::lock_guard<std::mutex> guard(s_lock);
+    clients = s_clients;
+  }
+  for (esp_mqtt_client *client : clients) {
+    /* As in ESP-MQTT, the delay is set before the event is dispatched. */
+    int64_t delay_us = (int64_t) client->reconnect_ms * 1000;
+    s_Disconnect(client, false);
+    After(delay_us, [client] { esp_mqtt_client_reconnect(client); });
+  }
+}
+
+} // namespace sim
@@ -0,0 +1,77 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file sim_internal.h
+ *
+ * @brief Internals shared by the simulator shims.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include "freertos/FreeRTOS.h"
+
+namespace sim {
+
+int64_t NowUs();
+
+/* A thread running timer callbacks in deadline order, like the FreeRTOS
+ * timer task or the esp_timer task. */
+class TimerService {
+public:
+  struct Timer {
+    std::function<void()> callback;
+    int64_t period_us = 0;
+    bool active = false;
+    bool owned = false;       /* one shot posted with After(), freed once run */
+    uint64_t generation = 0;
+  };
+
+  explicit TimerService(const char *task_name, UBaseType_t priority);
+  void Start(Timer *timer, int64_t delay_us, int64_t period_us);
+  void Stop(Timer *timer);
+  bool IsActive(Timer *timer);
+  void Post(int64_t delay_us, std::function<void()> callback);
+
+private:
+  const char *m_task_name;
+  UBaseType_t m_priority;
+  bool m_started = false;
+  std::mutex m_lock;
+  std::condition_variable m_cv;
+  std::multimap<int64_t, std::pair<Timer*, uint64_t>> m_queue;
+
+  void mEnsureStarted();
+  static void mTask(void *args);
+};
+
+/* Timer service shared by the simulated peripherals and network. */
+TimerService &Peripherals();
+
+} // namespace sim
@@ -0,0 +1,443 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file ssd1306.cpp
+ *
+ * @brief SSD1306 shim: a 128x64 framebuffer fed by the same calls the
+ * nopnop2002 driver exposes, with the I2C traffic each call would generate
+ * counted.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ssd1306.h"
+#include "sim.h"
+
+/* Byte counts of the driver's I2C transactions, address byte included. */
+#define I2C_CMD_HEADER   (2)   /* address, command stream control byte */
+#define I2C_DATA_HEADER  (2)   /* address, data stream control byte */
+#define I2C_INIT_CMDS    (26)
+#define I2C_CLOCK_HZ     (400000)
+
+/* Classic 5x7 glyphs stand in for the driver's font8x8: columns top bit
+ * first, padded to 8 columns. */
+extern "C" {
+uint8_t font8x8_basic_tr[128][8] = {
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x5f, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x07, 0x00, 0x07, 0x00, 0x00, 0x00},
+  {0x00, 0x14, 0x7f, 0x14, 0x7f, 0x14, 0x00, 0x00},
+  {0x00, 0x24, 0x2a, 0x7f, 0x2a, 0x12, 0x00, 0x00},
+  {0x00, 0x23, 0x13, 0x08, 0x64, 0x62, 0x00, 0x00},
+  {0x00, 0x36, 0x49, 0x55, 0x22, 0x50, 0x00, 0x00},
+  {0x00, 0x00, 0x05, 0x03, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x1c, 0x22, 0x41, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x41, 0x22, 0x1c, 0x00, 0x00, 0x00},
+  {0x00, 0x08, 0x2a, 0x1c, 0x2a, 0x08, 0x00, 0x00},
+  {0x00, 0x08, 0x08, 0x3e, 0x08, 0x08, 0x00, 0x00},
+  {0x00, 0x00, 0x50, 0x30, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00},
+  {0x00, 0x00, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x20, 0x10, 0x08, 0x04, 0x02, 0x00, 0x00},
+  {0x00, 0x3e, 0x51, 0x49, 0x45, 0x3e, 0x00, 0x00},
+  {0x00, 0x00, 0x42, 0x7f, 0x40, 0x00, 0x00, 0x00},
+  {0x00, 0x42, 0x61, 0x51, 0x49, 0x46, 0x00, 0x00},
+  {0x00, 0x21, 0x41, 0x45, 0x4b, 0x31, 0x00, 0x00},
+  {0x00, 0x18, 0x14, 0x12, 0x7f, 0x10, 0x00, 0x00},
+  {0x00, 0x27, 0x45, 0x45, 0x45, 0x39, 0x00, 0x00},
+  {0x00, 0x3c, 0x4a, 0x49, 0x49, 0x30, 0x00, 0x00},
+  {0x00, 0x01, 0x71, 0x09, 0x05, 0x03, 0x00, 0x00},
+  {0x00, 0x36, 0x49, 0x49, 0x49, 0x36, 0x00, 0x00},
+  {0x00, 0x06, 0x49, 0x49, 0x29, 0x1e, 0x00, 0x00},
+  {0x00, 0x00, 0x36, 0x36, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x56, 0x36, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x08, 0x14, 0x22, 0x41, 0x00, 0x00},
+  {0x00, 0x14, 0x14, 0x14, 0x14, 0x14, 0x00, 0x00},
+  {0x00, 0x41, 0x22, 0x14, 0x08, 0x00, 0x00, 0x00},
+  {0x00, 0x02, 0x01, 0x51, 0x09, 0x06, 0x00, 0x00},
+  {0x00, 0x32, 0x49, 0x79, 0x41, 0x3e, 0x00, 0x00},
+  {0x00, 0x7e, 0x11, 0x11, 0x11, 0x7e, 0x00, 0x00},
+  {0x00, 0x7f, 0x49, 0x49, 0x49, 0x36, 0x00, 0x00},
+  {0x00, 0x3e, 0x41, 0x41, 0x41, 0x22, 0x00, 0x00},
+  {0x00, 0x7f, 0x41, 0x41, 0x22, 0x1c, 0x00, 0x00},
+  {0x00, 0x7f, 0x49, 0x49, 0x49, 0x41, 0x00, 0x00},
+  {0x00, 0x7f, 0x09, 0x09, 0x01, 0x01, 0x00, 0x00},
+  {0x00, 0x3e, 0x41, 0x41, 0x51, 0x32, 0x00, 0x00},
+  {0x00, 0x7f, 0x08, 0x08, 0x08, 0x7f, 0x00, 0x00},
+  {0x00, 0x00, 0x41, 0x7f, 0x41, 0x00, 0x00, 0x00},
+  {0x00, 0x20, 0x40, 0x41, 0x3f, 0x01, 0x00, 0x00},
+  {0x00, 0x7f, 0x08, 0x14, 0x22, 0x41, 0x00, 0x00},
+  {0x00, 0x7f, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00},
+  {0x00, 0x7f, 0x02, 0x04, 0x02, 0x7f, 0x00, 0x00},
+  {0x00, 0x7f, 0x04, 0x08, 0x10, 0x7f, 0x00, 0x00},
+  {0x00, 0x3e, 0x41, 0x41, 0x41, 0x3e, 0x00, 0x00},
+  {0x00, 0x7f, 0x09, 0x09, 0x09, 0x06, 0x00, 0x00},
+  {0x00, 0x3e, 0x41, 0x51, 0x21, 0x5e, 0x00, 0x00},
+  {0x00, 0x7f, 0x09, 0x19, 0x29, 0x46, 0x00, 0x00},
+  {0x00, 0x46, 0x49, 0x49, 0x49, 0x31, 0x00, 0x00},
+  {0x00, 0x01, 0x01, 0x7f, 0x01, 0x01, 0x00, 0x00},
+  {0x00, 0x3f, 0x40, 0x40, 0x40, 0x3f, 0x00, 0x00},
+  {0x00, 0x1f, 0x20, 0x40, 0x20, 0x1f, 0x00, 0x00},
+  {0x00, 0x7f, 0x20, 0x18, 0x20, 0x7f, 0x00, 0x00},
+  {0x00, 0x63, 0x14, 0x08, 0x14, 0x63, 0x00, 0x00},
+  {0x00, 0x03, 0x04, 0x78, 0x04, 0x03, 0x00, 0x00},
+  {0x00, 0x61, 0x51, 0x49, 0x45, 0x43, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x7f, 0x41, 0x41, 0x00, 0x00},
+  {0x00, 0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x00},
+  {0x00, 0x41, 0x41, 0x7f, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x04, 0x02, 0x01, 0x02, 0x04, 0x00, 0x00},
+  {0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00},
+  {0x00, 0x00, 0x01, 0x02, 0x04, 0x00, 0x00, 0x00},
+  {0x00, 0x20, 0x54, 0x54, 0x54, 0x78, 0x00, 0x00},
+  {0x00, 0x7f, 0x48, 0x44, 0x44, 0x38, 0x00, 0x00},
+  {0x00, 0x38, 0x44, 0x44, 0x44, 0x20, 0x00, 0x00},
+  {0x00, 0x38, 0x44, 0x44, 0x48, 0x7f, 0x00, 0x00},
+  {0x00, 0x38, 0x54, 0x54, 0x54, 0x18, 0x00, 0x00},
+  {0x00, 0x08, 0x7e, 0x09, 0x01, 0x02, 0x00, 0x00},
+  {0x00, 0x08, 0x14, 0x54, 0x54, 0x3c, 0x00, 0x00},
+  {0x00, 0x7f, 0x08, 0x04, 0x04, 0x78, 0x00, 0x00},
+  {0x00, 0x00, 0x44, 0x7d, 0x40, 0x00, 0x00, 0x00},
+  {0x00, 0x20, 0x40, 0x44, 0x3d, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x7f, 0x10, 0x28, 0x44, 0x00, 0x00},
+  {0x00, 0x00, 0x41, 0x7f, 0x40, 0x00, 0x00, 0x00},
+  {0x00, 0x7c, 0x04, 0x18, 0x04, 0x78, 0x00, 0x00},
+  {0x00, 0x7c, 0x08, 0x04, 0x04, 0x78, 0x00, 0x00},
+  {0x00, 0x38, 0x44, 0x44, 0x44, 0x38, 0x00, 0x00},
+  {0x00, 0x7c, 0x14, 0x14, 0x14, 0x08, 0x00, 0x00},
+  {0x00, 0x08, 0x14, 0x14, 0x18, 0x7c, 0x00, 0x00},
+  {0x00, 0x7c, 0x08, 0x04, 0x04, 0x08, 0x00, 0x00},
+  {0x00, 0x48, 0x54, 0x54, 0x54, 0x20, 0x00, 0x00},
+  {0x00, 0x04, 0x3f, 0x44, 0x40, 0x20, 0x00, 0x00},
+  {0x00, 0x3c, 0x40, 0x40, 0x20, 0x7c, 0x00, 0x00},
+  {0x00, 0x1c, 0x20, 0x40, 0x20, 0x1c, 0x00, 0x00},
+  {0x00, 0x3c, 0x40, 0x30, 0x40, 0x3c, 0x00, 0x00},
+  {0x00, 0x44, 0x28, 0x10, 0x28, 0x44, 0x00, 0x00},
+  {0x00, 0x0c, 0x50, 0x50, 0x50, 0x3c, 0x00, 0x00},
+  {0x00, 0x44, 0x64, 0x54, 0x4c, 0x44, 0x00, 0x00},
+  {0x00, 0x00, 0x08, 0x36, 0x41, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x41, 0x36, 0x08, 0x00, 0x00, 0x00},
+  {0x00, 0x08, 0x04, 0x08, 0x10, 0x08, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+}
+
+static std::mutex s_lock;
+static SSD1306_t *s_dev;
+static sim::DisplayStats s_stats;
+
+static void s_Account(uint64_t bytes, uint64_t transactions) {
+
+  s_stats.i2c_bytes += bytes;
+  s_stats.transactions += transactions;
+  s_stats.last_write_us = sim::NowUs();
+}
+
+/* Column address and page commands, then the data itself. */
+static void s_WriteSegs(SSD1306_t *dev, int page, int seg, const uint8_t *data, int width) {
+
+  if (page < 0 || page >= dev->_pages || seg < 0 || seg >= dev->_width)
+    return;
+  if (seg + width > dev->_width)
+    width = dev->_width - seg;
+  memcpy(&dev->_page[page]._segs[seg], data, width);
+  s_Account(I2C_CMD_HEADER + 3 + I2C_DATA_HEADER + width, 2);
+}
+
+extern "C" void i2c_master_init(SSD1306_t *dev, int16_t sda, int16_t scl, int16_t reset) {
+
+  (void) sda;
+  (void) scl;
+  (void) reset;
+  std::lock_guard<std::mutex> guard(s_lock);
+  dev->_address = 0x3c;
+  dev->_flip = false;
+}
+
+extern "C" void ssd1306_init(SSD1306_t *dev, int width, int height) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  dev->_width = width;
+  dev->_height = height;
+  dev->_pages = height / 8;
+  for (int page = 0; page < dev->_pages; page++) {
+    memset(dev->_page[page]._segs, 0, sizeof(dev->_page[page]._segs));
+    dev->_page[page]._valid = true;
+    dev->_page[page]._segLen = width;
+  }
+  s_dev = dev;
+  s_Account(I2C_CMD_HEADER + I2C_INIT_CMDS, 1);
+}
+
+extern "C" int ssd1306_get_width(SSD1306_t *dev) {
+
+  return dev->_width;
+}
+
+extern "C" int ssd1306_get_height(SSD1306_t *dev) {
+
+  return dev->_height;
+}
+
+extern "C" int ssd1306_get_pages(SSD1306_t *dev) {
+
+  return dev->_pages;
+}
+
+extern "C" void ssd1306_show_buffer(SSD1306_t *dev) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  for (int page = 0; page < dev->_pages; page++)
+    s_WriteSegs(dev, page, 0, dev->_page[page]._segs, dev->_width);
+}
+
+extern "C" void ssd1306_display_image(SSD1306_t *dev, int page, int seg, const uint8_t *images,
+                                      int width) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  s_WriteSegs(dev, page, seg, images, width);
+}
+
+static uint8_t s_RotateByte(uint8_t value) {
+
+  uint8_t rotated = 0;
+  for (int bit = 0; bit < 8; bit++) {
+    if (value & (1 << bit))
+      rotated |= 0x80 >> bit;
+  }
+  return rotated;
+}
+
+extern "C" void ssd1306_display_text(SSD1306_t *dev, int page, const char *text, int text_len,
+                                     bool invert) {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  if (page >= dev->_pages)
+    return;
+  if (text_len > 16)
+    text_len = 16;
+  for (int i = 0; i < text_len; i++) {
+    uint8_t image[8];
+    memcpy(image, font8x8_basic_tr[(uint8_t) text[i] & 0x7f], sizeof(image));
+    for (uint8_t &column : image) {
+      if (invert)
+        column = ~column;
+      if (dev->_flip)
+        column = s_RotateByte(column);
+    }
+    s_WriteSegs(dev, page, i * 8, image, sizeof(image));
+  }
+}
+
+extern "C" void ssd1306_clear_line(SSD1306_t *dev, int page, bool invert) {
+
+  char space[16];
+  memset(space, 0x00, sizeof(space));
+  ssd1306_display_text(dev, page, space, sizeof(space), invert);
+}
+
+extern "C" void ssd1306_clear_screen(SSD1306_t *dev, bool invert) {
+
+  for (int page = 0; page < dev->_pages; page++)
+    ssd1306_clear_line(dev, page, invert);
+}
+
+extern "C" void ssd1306_contrast(SSD1306_t *dev, int contrast) {
+
+  (void) dev;
+  (void) contrast;
+  std::lock_guard<std::mutex> guard(s_lock);
+  s_Account(I2C_CMD_HEADER + 2, 1);
+}
+
+extern "C" void ssd1306_bitmaps(SSD1306_t *dev, int xpos, int ypos, const uint8_t *bitmap, int width,
+                                int height, bool invert) {
+
+  {
+    std::lock_guard<std::mutex> guard(s_lock);
+    const int stride = (width + 7) / 8;
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        int px = xpos + x, py = ypos + y;
+        if (px < 0 || px >= dev->_width || py < 0 || py >= dev->_height)
+          continue;
+        bool on = (bitmap[y * stride + x / 8] >> (7 - x % 8)) & 1;
+        uint8_t &seg = dev->_page[py / 8]._segs[px];
+        if (on != invert)
+          seg |= 1 << (py % 8);
+        else
+          seg &= ~(1 << (py % 8));
+      }
+    }
+  }
+  ssd1306_show_buffer(dev);
+}
+
+namespace sim {
+
+DisplayStats GetDisplayStats() {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  return s_stats;
+}
+
+int64_t I2cBusTimeUs(uint64_t bytes) {
+
+  /* Eight data bits and an acknowledge per byte. */
+  return bytes * 9 * 1000000 / I2C_CLOCK_HZ;
+}
+
+static bool s_Pixel(int x, int y) {
+
+  return (s_dev->_page[y / 8]._segs[x] >> (y % 8)) & 1;
+}
+
+std::string DisplayText() {
+
+  std::lock_guard<std::mutex> guard(s_lock);
+  if (!s_dev)
+    return "";
+  /* Two pixel rows per text row. */
+  static const char c_cells[] = " '.:";
+  std::string text;
+  for (int y = 0; y < s_dev->_height; y += 2) {
+    for (int x = 0; x < s_dev->_width; x++)
+      text += c_cells[s_Pixel(x, y) | s_Pixel(x, y + 1) << 1];
+    text += '\n';
+  }
+  return text;
+}
+
+static uint32_t s_Crc32(const uint8_t *data, size_t len, uint32_t crc = 0) {
+
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static void s_Be32(std::vector<uint8_t> &out, uint32_t value) {
+
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out.push_back(value >> shift);
+}
+
+static void s_Chunk(std::vector<uint8_t> &png, const char *type, const std::vector<uint8_t> &data) {
+
+  std::vector<uint8_t> body(type, type + 4);
+  body.insert(body.end(), data.begin(), data.end());
+  s_Be32(png, data.size());
+  png.insert(png.end(), body.begin(), body.end());
+  s_Be32(png, s_Crc32(body.data(), body.size()));
+}
+
+/* Grayscale PNG with the image data in stored (uncompressed) deflate
+ * blocks, so no zlib is needed. */
+bool SavePng(const std::string &path, int scale) {
+
+  std::vector<uint8_t> raw;
+  int width, height;
+  {
+    std::lock_guard<std::mutex> guard(s_lock);
+    if (!s_dev || scale < 1)
+      return false;
+    width = s_dev->_width * scale;
+    height = s_dev->_height * scale;
+    for (int y = 0; y < height; y++) {
+      raw.push_back(0);  /* no filter */
+      for (int x = 0; x < width; x++)
+        raw.push_back(s_Pixel(x / scale, y / scale) ? 0xff : 0x00);
+    }
+  }
+
+  std::vector<uint8_t> ihdr;
+  s_Be32(ihdr, width);
+  s_Be32(ihdr, height);
+  ihdr.insert(ihdr.end(), {8, 0, 0, 0, 0});  /* 8 bit grayscale */
+
+  std::vector<uint8_t> zlib = {0x78, 0x01};
+  for (size_t offset = 0; offset < raw.size(); offset += 0xffff) {
+    size_t len = std::min<size_t>(0xffff, raw.size() - offset);
+    zlib.push_back(offset + len == raw.size());
+    zlib.insert(zlib.end(), {uint8_t(len), uint8_t(len >> 8), uint8_t(~len), uint8_t(~len >> 8)});
+    zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + len);
+  }
+  uint32_t a = 1, b = 0;
+  for (uint8_t byte : raw) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  s_Be32(zlib, b << 16 | a);
+
+  std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  s_Chunk(png, "IHDR", ihdr);
+  s_Chunk(png, "IDAT", zlib);
+  s_Chunk(png, "IEND", {});
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(png.data()), png.size());
+  return bool(file);
+}
+
+} // namespace sim
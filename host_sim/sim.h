@@ -0,0 +1,101 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file sim.h
+ *
+ * @brief Host simulator controls: virtual inputs, display and broker probes.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+/* Microseconds since the simulator started, the esp_timer_get_time() clock. */
+int64_t NowUs();
+
+/* Run fn as an interrupt handler: no critical section is held meanwhile and
+ * xPortInIsrContext() is true inside. */
+void RunIsr(void (*fn)(void *args), void *args);
+
+/* Run callback in the timer service thread after delay_us. */
+void After(int64_t delay_us, std::function<void()> callback);
+
+/* Virtual GPIO. Inputs idle high (pull ups); edges raise the configured
+ * interrupts. */
+void GpioSetInput(int gpio, int level);
+int GpioGetOutput(int gpio);
+
+/* Display: I2C traffic generated by the driver calls so far. */
+struct DisplayStats {
+  uint64_t i2c_bytes;
+  uint64_t transactions;
+  int64_t last_write_us;
+};
+DisplayStats GetDisplayStats();
+/* I2C bus time the traffic would take at the driver's 400 kHz clock. */
+int64_t I2cBusTimeUs(uint64_t bytes);
+bool SavePng(const std::string &path, int scale);
+/* The framebuffer as text, one character per two pixel rows. */
+std::string DisplayText();
+
+/* Broker stand-in. */
+struct Message {
+  int64_t time_us;
+  std::string topic;
+  std::string payload;
+  int qos;
+  bool retain;
+  bool from_device;
+};
+std::vector<Message> BrokerLog();
+/* Publish as another client, e.g. Home Assistant sending a command. */
+void BrokerPublish(const std::string &topic, const std::string &payload, bool retain);
+/* One way network delay between the device and the broker. */
+void SetNetworkDelayUs(int64_t delay_us);
+/* Drop every device connection; clients reconnect after their configured
+ * reconnect timeout. */
+void BrokerDisconnectAll();
+/* Silently lose every packet of the current device connections, until the
+ * device notices and reconnects. */
+void BrokerStallAll();
+
+/* Asset pack image exposed as the "assets" partition. */
+bool LoadAssetPartition(const std::string &path);
+/* Firmware image in the running "ota_0" partition, the source of delta
+ * updates. */
+bool LoadFirmware(const std::string &path);
+/* esp_restart() ends the simulation; after an update it first writes the
+ * image the device would boot to path. */
+void SetRestartImage(const std::string &path);
+
+/* Log output of the firmware, on by default. */
+void SetLogging(bool enabled);
+
+} // namespace sim
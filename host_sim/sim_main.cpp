@@ -0,0 +1,393 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file sim_main.cpp
+ *
+ * @brief Host simulator entry point: boots the firmware, replays a script of
+ * button presses and Home Assistant commands and reports per step metrics.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "sim.h"
+
+extern "C" void app_main();
+
+/* Buttons as wired on the board, see c_buttons_gpios in app_main.cpp. */
+constexpr int c_gpio_up {7};
+constexpr int c_gpio_down {4};
+constexpr int c_gpio_enter {2};
+constexpr int c_press_ms {50};
+constexpr int c_quiet_ms {400};
+constexpr int c_settle_max_ms {10000};
+constexpr int c_boot_max_ms {20000};
+constexpr size_t c_ota_chunk {896};
+constexpr size_t c_ota_window {8};
+constexpr int c_ota_resend_ms {5000};
+constexpr int c_ota_resends {3};
+
+struct options {
+  std::string script {"down down enter up enter"};
+  std::string snapshots;
+  std::string assets;
+  std::string firmware;
+  std::string ota_out;
+  std::vector<std::string> retained;
+  int64_t delay_us {5000};
+  int scale {4};
+  bool quiet {false};
+  bool messages {false};
+};
+
+struct step_result {
+  std::string action;
+  sim::DisplayStats display;
+  int64_t frame_us;
+  int64_t publish_us;
+  size_t messages;
+};
+
+static void s_Usage(const char *argv0) {
+
+  printf("Usage: %s [options]\n"
+         "  --script \"STEPS\"    space separated steps, default \"down down enter up enter\":\n"
+         "                      up, down, enter   press a menu button\n"
+         "                      gpioN             press the button on GPIO N\n"
+         "                      hold:MS           hold enter for MS milliseconds\n"
+         "                      wait:MS           let MS milliseconds pass\n"
+         "                      ha:TOPIC=PAYLOAD  publish as Home Assistant\n"
+         "                      ota:FILE          send the delta patch FILE over MQTT\n"
+         "                      drop              drop the broker connection\n"
+         "                      stall             lose all traffic, as a half-open connection\n"
+         "                      delay:MS          set the one way network delay to MS\n"
+         "  --snapshots DIR     save the display after each step as DIR/stepNN.png\n"
+         "  --scale N           snapshot pixel scale, default 4\n"
+         "  --delay-ms MS       one way network delay, default 5\n"
+         "  --assets FILE       asset pack image to expose as the assets partition\n"
+         "  --firmware FILE     image of the running app, the source of delta updates\n"
+         "  --ota-out FILE      write the updated image here when the firmware restarts\n"
+         "  --retain TOPIC=PAYLOAD  retained message on the broker before boot, repeatable\n"
+         "  --quiet             hide the firmware log\n"
+         "  --messages          list the device publishes after the steps\n", argv0);
+}
+
+static bool s_IsProbe(const std::string &topic) {
+
+#ifdef CONFIG_MQTT_LINK_PROBE
+  /* franzininho-wifi/<MAC>/probe */
+  static const std::string prefix = "franzininho-wifi/", suffix = "/probe";
+  return topic.size() == prefix.size() + 12 + suffix.size() &&
+         !topic.compare(0, prefix.size(), prefix) &&
+         !topic.compare(topic.size() - suffix.size(), suffix.size(), suffix);
+#else
+  (void) topic;
+  return false;
+#endif
+}
+
+static int64_t s_Ms(int64_t us) {
+
+  return us / 1000;
+}
+
+/* Wait until neither the display nor the broker saw traffic for quiet_ms. */
+static void s_Settle(int quiet_ms, int max_ms) {
+
+  int64_t start = sim::NowUs();
+  size_t messages = sim::BrokerLog().size();
+  int64_t last_activity = start;
+  while (sim::NowUs() - start < (int64_t) max_ms * 1000) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    size_t now_messages = sim::BrokerLog().size();
+    if (now_messages != messages) {
+      messages = now_messages;
+      last_activity = sim::NowUs();
+    }
+    if (sim::GetDisplayStats().last_write_us > last_activity)
+      last_activity = sim::GetDisplayStats().last_write_us;
+    if (sim::NowUs() - last_activity >= (int64_t) quiet_ms * 1000)
+      return;
+  }
+}
+
+static bool s_WaitOnline(int max_ms) {
+
+  int64_t start = sim::NowUs();
+  while (sim::NowUs() - start < (int64_t) max_ms * 1000) {
+    for (const sim::Message &message : sim::BrokerLog()) {
+      if (message.from_device && message.topic.find("/status") != std::string::npos &&
+          message.payload == "online")
+        return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+static void s_Press(int gpio, int press_ms = c_press_ms) {
+
+  sim::GpioSetInput(gpio, 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(press_ms));
+  sim::GpioSetInput(gpio, 1);
+}
+
+/* The state and offset of an OTA status message. */
+static void s_ParseOtaStatus(const std::string &payload, std::string &state, size_t &offset) {
+
+  size_t at = payload.find("\"state\":\"");
+  if (at != std::string::npos) {
+    at += 9;
+    state = payload.substr(at, payload.find('"', at) - at);
+  }
+  at = payload.find("\"offset\":");
+  if (at != std::string::npos && state == "receiving")
+    offset = strtoul(payload.c_str() + at + 9, nullptr, 10);
+}
+
+/* Send a delta patch over MQTT as tools/mkdelta.py send does: a window of
+ * chunks in flight, resending from the offset the device acknowledges. */
+static bool s_SendPatch(const std::string &path) {
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  std::string patch((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  size_t seen = sim::BrokerLog().size();
+  sim::BrokerPublish("franzininho-wifi/ota/begin", std::to_string(patch.size()), false);
+
+  std::string state;
+  size_t sent = 0, offset = 0;
+  int idle_ms = 0, resends = 0;
+  while (state != "done" && state != "error" && state != "aborted") {
+    std::vector<sim::Message> log = sim::BrokerLog();
+    for (; seen < log.size(); seen++) {
+      if (log[seen].from_device && log[seen].topic == "franzininho-wifi/ota/status") {
+        s_ParseOtaStatus(log[seen].payload, state, offset);
+        idle_ms = resends = 0;
+      }
+    }
+    if (sent - offset >= c_ota_chunk * c_ota_window || sent >= patch.size()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      if ((idle_ms += 10) < c_ota_resend_ms)
+        continue;
+      if (++resends > c_ota_resends) {
+        fprintf(stderr, "No OTA status from the firmware\n");
+        break;
+      }
+      sent = offset;
+      idle_ms = 0;
+      continue;
+    }
+    sent = std::max(sent, offset);
+    std::string chunk(4, '\0');
+    for (int i = 0; i < 4; i++)
+      chunk[i] = (char) (sent >> (8 * i));
+    chunk += patch.substr(sent, c_ota_chunk);
+    sim::BrokerPublish("franzininho-wifi/ota/chunk", chunk, false);
+    sent = std::min(sent + c_ota_chunk, patch.size());
+  }
+  return true;
+}
+
+/* Run one script step, false if it is not understood. */
+static bool s_RunStep(const std::string &step) {
+
+  if (step == "up") {
+    s_Press(c_gpio_up);
+  } else if (step == "down") {
+    s_Press(c_gpio_down);
+  } else if (step == "enter") {
+    s_Press(c_gpio_enter);
+  } else if (step.rfind("gpio", 0) == 0) {
+    s_Press(atoi(step.c_str() + 4));
+  } else if (step.rfind("hold:", 0) == 0) {
+    s_Press(c_gpio_enter, atoi(step.c_str() + 5));
+  } else if (step.rfind("wait:", 0) == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(atoi(step.c_str() + 5)));
+  } else if (step.rfind("ha:", 0) == 0 && step.find('=') != std::string::npos) {
+    size_t eq = step.find('=');
+    sim::BrokerPublish(step.substr(3, eq - 3), step.substr(eq + 1), false);
+  } else if (step.rfind("ota:", 0) == 0) {
+    return s_SendPatch(step.substr(4));
+  } else if (step == "drop") {
+    sim::BrokerDisconnectAll();
+  } else if (step == "stall") {
+    sim::BrokerStallAll();
+  } else if (step.rfind("delay:", 0) == 0) {
+    sim::SetNetworkDelayUs(atoi(step.c_str() + 6) * 1000LL);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void s_MainTask(void *args) {
+
+  app_main();
+  vTaskDelete(NULL);
+}
+
+int main(int argc, char **argv) {
+
+  options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--script" && has_value) {
+      opts.script = argv[++i];
+    } else if (arg == "--snapshots" && has_value) {
+      opts.snapshots = argv[++i];
+    } else if (arg == "--scale" && has_value) {
+      opts.scale = atoi(argv[++i]);
+    } else if (arg == "--delay-ms" && has_value) {
+      opts.delay_us = atoi(argv[++i]) * 1000LL;
+    } else if (arg == "--assets" && has_value) {
+      opts.assets = argv[++i];
+    } else if (arg == "--firmware" && has_value) {
+      opts.firmware = argv[++i];
+    } else if (arg == "--ota-out" && has_value) {
+      opts.ota_out = argv[++i];
+    } else if (arg == "--retain" && has_value && strchr(argv[i + 1], '=')) {
+      opts.retained.push_back(argv[++i]);
+    } else if (arg == "--quiet") {
+      opts.quiet = true;
+    } else if (arg == "--messages") {
+      opts.messages = true;
+    } else {
+      s_Usage(argv[0]);
+      return arg == "--help" ? 0 : 2;
+    }
+  }
+
+  sim::SetLogging(!opts.quiet);
+  sim::SetNetworkDelayUs(opts.delay_us);
+  if (!opts.assets.empty() && !sim::LoadAssetPartition(opts.assets)) {
+    fprintf(stderr, "Cannot read %s\n", opts.assets.c_str());
+    return 1;
+  }
+  if (!opts.firmware.empty() && !sim::LoadFirmware(opts.firmware)) {
+    fprintf(stderr, "Cannot read %s\n", opts.firmware.c_str());
+    return 1;
+  }
+  sim::SetRestartImage(opts.ota_out);
+  for (const std::string &message : opts.retained) {
+    size_t eq = message.find('=');
+    sim::BrokerPublish(message.substr(0, eq), message.substr(eq + 1), true);
+  }
+
+  /* app_main() runs in the "main" task, as started by ESP-IDF. */
+  xTaskCreate(s_MainTask, "main", 3584, nullptr, 1, nullptr);
+  if (!s_WaitOnline(c_boot_max_ms)) {
+    fprintf(stderr, "The firmware did not come online\n");
+    fflush(stdout);
+    _exit(1);
+  }
+  int64_t online_us = sim::NowUs();
+  s_Settle(c_quiet_ms, c_settle_max_ms);
+
+  std::vector<step_result> results;
+  std::istringstream script(opts.script);
+  std::string step;
+  while (script >> step) {
+    sim::DisplayStats before = sim::GetDisplayStats();
+    size_t logged = sim::BrokerLog().size();
+    int64_t t0 = sim::NowUs();
+    if (!s_RunStep(step)) {
+      fprintf(stderr, "Unknown step \"%s\"\n", step.c_str());
+      fflush(stdout);
+      _exit(2);
+    }
+    s_Settle(c_quiet_ms, c_settle_max_ms);
+
+    step_result result {step, sim::GetDisplayStats(), -1, -1, 0};
+    result.display.i2c_bytes -= before.i2c_bytes;
+    result.display.transactions -= before.transactions;
+    if (result.display.i2c_bytes)
+      result.frame_us = result.display.last_write_us - t0;
+
+    /* Latency to the first state change; discovery configs and link probes
+     * do not count. */
+    std::vector<sim::Message> log = sim::BrokerLog();
+    for (size_t i = logged; i < log.size(); i++) {
+      if (!log[i].from_device)
+        continue;
+      result.messages++;
+      if (result.publish_us < 0 && log[i].topic.rfind("homeassistant/", 0) != 0 &&
+          !s_IsProbe(log[i].topic))
+        result.publish_us = log[i].time_us - t0;
+    }
+    results.push_back(result);
+
+    if (!opts.snapshots.empty()) {
+      char path[512];
+      snprintf(path, sizeof(path), "%s/step%02zu.png", opts.snapshots.c_str(), results.size());
+      if (!sim::SavePng(path, opts.scale))
+        fprintf(stderr, "Cannot write %s\n", path);
+    }
+  }
+
+  sim::SetLogging(false);
+  printf("\nOnline after %" PRIi64 " ms\n\n", s_Ms(online_us));
+  printf("%-4s %-24s %9s %6s %9s %9s %10s %5s\n", "step", "action", "i2c_bytes", "xfers",
+         "frame_ms", "bus_ms", "publish_ms", "msgs");
+  for (size_t i = 0; i < results.size(); i++) {
+    const step_result &r = results[i];
+    char frame[16] = "-", publish[16] = "-";
+    if (r.frame_us >= 0)
+      snprintf(frame, sizeof(frame), "%.1f", r.frame_us / 1000.0);
+    if (r.publish_us >= 0)
+      snprintf(publish, sizeof(publish), "%.1f", r.publish_us / 1000.0);
+    printf("%-4zu %-24.24s %9" PRIu64 " %6" PRIu64 " %9s %9.1f %10s %5zu\n", i + 1,
+           r.action.c_str(), r.display.i2c_bytes, r.display.transactions, frame,
+           sim::I2cBusTimeUs(r.display.i2c_bytes) / 1000.0, publish, r.messages);
+  }
+  printf("\nDisplay:\n%s", sim::DisplayText().c_str());
+
+  if (opts.messages) {
+    printf("\nDevice publishes:\n");
+    for (const sim::Message &message : sim::BrokerLog()) {
+      if (message.from_device)
+        printf("%8.1f %s%s %s\n", message.time_us / 1000.0, message.topic.c_str(),
+               message.retain ? " (retained)" : "", message.payload.c_str());
+    }
+  }
+
+  /* The firmware tasks never return, leave without unwinding them. */
+  fflush(stdout);
+  _exit(0);
+}
@@ -0,0 +1,289 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * @file delta_patch_test.cpp
+ *
+ * @brief Host test of the delta patch engine.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Applies a patch generated by tools/mkdelta.py diff (its command line is
+ * passed as the arguments) in pieces of several sizes, then hand built
+ * patches which must be refused: truncated, against another source and
+ * copying outside the source.
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "mbedtls/sha256.h"
+#include "delta_patch.h"
+
+typedef std::vector<uint8_t> bytes;
+
+struct images {
+  const bytes &source;
+  bytes target;
+};
+
+static int s_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      s_failures++; \
+    } \
+  } while (0)
+
+static esp_err_t s_Read(uint32_t offset, void *buffer, size_t len, void *user_ctx) {
+
+  const bytes &source = ((images*) user_ctx)->source;
+  if (offset > source.size() || len > source.size() - offset)
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(buffer, source.data() + offset, len);
+  return ESP_OK;
+}
+
+static esp_err_t s_Write(const void *data, size_t len, void *user_ctx) {
+
+  bytes &target = ((images*) user_ctx)->target;
+  target.insert(target.end(), (const uint8_t*) data, (const uint8_t*) data + len);
+  return ESP_OK;
+}
+
+/*
+ * @brief Feed patch in pieces of piece bytes, then finish it.
+ *
+ * @return the first error, target holds what was written.
+ */
+static esp_err_t s_Apply(const bytes &source, const bytes &patch, size_t piece, bytes &target) {
+
+  images io {source, {}};
+  delta_patch *state = new delta_patch;
+  esp_err_t rc = ESP_OK;
+
+  DeltaPatchInit(state, s_Read, s_Write, &io);
+  for (size_t at = 0; at < patch.size() && !rc; at += piece)
+    rc = DeltaPatchFeed(state, patch.data() + at, std::min(piece, patch.size() - at));
+  if (!rc)
+    rc = DeltaPatchFinish(state);
+  DeltaPatchFree(state);
+  delete state;
+  target = io.target;
+  return rc;
+}
+
+/* Deterministic pseudo-random bytes. */
+static bytes s_Random(size_t len, uint32_t seed) {
+
+  bytes data(len);
+  for (uint8_t &byte : data) {
+    seed = seed * 1103515245 + 12345;
+    byte = seed >> 16;
+  }
+  return data;
+}
+
+static bytes s_Sha256(const bytes &data) {
+
+  bytes digest(32);
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  mbedtls_sha256_update(&sha, data.data(), data.size());
+  mbedtls_sha256_finish(&sha, digest.data());
+  mbedtls_sha256_free(&sha);
+  return digest;
+}
+
+static void s_U32(bytes &out, uint32_t value) {
+
+  for (int i = 0; i < 4; i++)
+    out.push_back(value >> (8 * i));
+}
+
+/* A patch in the delta_patch.h format, ops appended by Copy() and Insert(). */
+struct patch_builder {
+  bytes ops;
+
+  void Copy(uint32_t offset, uint32_t len) {
+    ops.push_back('C');
+    s_U32(ops, offset);
+    s_U32(ops, len);
+  }
+
+  void Insert(const bytes &data) {
+    ops.push_back('I');
+    s_U32(ops, data.size());
+    ops.insert(ops.end(), data.begin(), data.end());
+  }
+
+  bytes Build(const bytes &source, const bytes &target) const {
+    bytes patch(DELTA_PATCH_MAGIC, DELTA_PATCH_MAGIC + 4);
+    s_U32(patch, source.size());
+    s_U32(patch, target.size());
+    bytes sha = s_Sha256(source);
+    patch.insert(patch.end(), sha.begin(), sha.end());
+    sha = s_Sha256(target);
+    patch.insert(patch.end(), sha.begin(), sha.end());
+    patch.insert(patch.end(), ops.begin(), ops.end());
+    patch.push_back('E');
+    return patch;
+  }
+};
+
+static bool s_WriteFile(const std::string &path, const bytes &data) {
+
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char*) data.data(), data.size());
+  return (bool) file;
+}
+
+static bool s_ReadFile(const std::string &path, bytes &data) {
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+/* A new build of source: edited, grown, shrunk and with code moved around. */
+static bytes s_NewImage(const bytes &source) {
+
+  bytes target(source.begin(), source.begin() + 12000);
+  target[100] ^= 0xff;
+  target[7000] ^= 0x55;
+  bytes added = s_Random(700, 7);
+  target.insert(target.begin() + 5000, added.begin(), added.end());
+  target.insert(target.end(), source.begin() + 15000, source.end());
+  target.insert(target.end(), source.begin() + 2000, source.begin() + 6000);
+  return target;
+}
+
+static void s_TestGenerated(const std::string &command, const bytes &source) {
+
+  const bytes target = s_NewImage(source);
+  bytes patch, out;
+
+  CHECK(s_WriteFile("delta_patch_test.old", source));
+  CHECK(s_WriteFile("delta_patch_test.new", target));
+  std::string diff = command + " diff -o delta_patch_test.patch delta_patch_test.old delta_patch_test.new";
+  CHECK(system(diff.c_str()) == 0);
+  if (!s_ReadFile("delta_patch_test.patch", patch)) {
+    CHECK(!"mkdelta.py diff wrote a patch");
+    return;
+  }
+  /* Mostly COPY ops, else the case tests little. */
+  CHECK(patch.size() < target.size() / 4);
+
+  for (size_t piece : {patch.size(), (size_t) 1, (size_t) 7, (size_t) 896}) {
+    CHECK(s_Apply(source, patch, piece, out) == ESP_OK);
+    CHECK(out == target);
+  }
+
+  /* A chunk lost on the way: the patch ends early or goes out of step. */
+  bytes truncated(patch.begin(), patch.end() - 1);
+  CHECK(s_Apply(source, truncated, 896, out) == ESP_ERR_INVALID_SIZE);
+  truncated.assign(patch.begin(), patch.begin() + patch.size() / 2);
+  CHECK(s_Apply(source, truncated, 896, out) == ESP_ERR_INVALID_SIZE);
+  CHECK(out.size() < target.size());
+  truncated = patch;
+  truncated.erase(truncated.begin() + DELTA_PATCH_HEADER_SIZE + 20,
+                  truncated.begin() + DELTA_PATCH_HEADER_SIZE + 30);
+  CHECK(s_Apply(source, truncated, 896, out) != ESP_OK);
+
+  /* Built against another image: refused before anything is written. */
+  bytes other = source;
+  other[source.size() / 2] ^= 1;
+  CHECK(s_Apply(other, patch, 896, out) == ESP_ERR_INVALID_VERSION);
+  CHECK(out.empty());
+}
+
+static void s_TestBuilt(const bytes &source) {
+
+  bytes target(source.begin() + 1000, source.begin() + 11000);
+  bytes added = s_Random(300, 3);
+  target.insert(target.end(), added.begin(), added.end());
+  bytes out;
+
+  /* The copy spans several CONFIG_OTA_DELTA_BUFFER_SIZE reads. */
+  patch_builder good;
+  good.Copy(1000, 10000);
+  good.Insert(added);
+  bytes patch = good.Build(source, target);
+  CHECK(s_Apply(source, patch, 5, out) == ESP_OK);
+  CHECK(out == target);
+
+  /* Nothing may follow the end marker. */
+  bytes trailing = patch;
+  trailing.push_back('E');
+  CHECK(s_Apply(source, trailing, 896, out) == ESP_ERR_INVALID_ARG);
+
+  /* A target hash that does not match what was written. */
+  bytes wrong = patch;
+  wrong[DELTA_PATCH_HEADER_SIZE - 1] ^= 1;
+  CHECK(s_Apply(source, wrong, 896, out) == ESP_ERR_INVALID_CRC);
+
+  /* COPY ranges outside the source, the last one wrapping around 2^32. */
+  const uint32_t size = source.size();
+  const uint32_t ranges[][2] = {{size - 10, 20}, {size + 1, 0}, {0, size + 1}, {0xfffffff0, 0x20}};
+  for (const auto &range : ranges) {
+    patch_builder bad;
+    bad.Copy(range[0], range[1]);
+    bytes target_bad(20);
+    CHECK(s_Apply(source, bad.Build(source, target_bad), 896, out) == ESP_ERR_INVALID_ARG);
+    CHECK(out.empty());
+  }
+
+  /* A COPY past the announced target size. */
+  patch_builder over;
+  over.Copy(0, target.size() + 1);
+  CHECK(s_Apply(source, over.Build(source, target), 896, out) == ESP_ERR_INVALID_ARG);
+  CHECK(out.empty());
+}
+
+int main(int argc, char **argv) {
+
+  const bytes source = s_Random(20000, 1);
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s MKDELTA_COMMAND...\n", argv[0]);
+    return 2;
+  }
+  std::string command;
+  for (int i = 1; i < argc; i++)
+    command += std::string(i > 1 ? " " : "") + "'" + argv[i] + "'";
+
+  s_TestGenerated(command, source);
+  s_TestBuilt(source);
+  if (s_failures)
+    fprintf(stderr, "%d checks failed\n", s_failures);
+  return s_failures ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/**
+ * @file light_fade_test.cpp
+ *
+ * @brief Host test of the HaLight brightness curve and fade math.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Runs the fades the way HaLight does, with the configured resolution and
+ * PWM frequency: duty along the fade, where it ends and a new command
+ * retargeting a fade halfway.
+ *
+ */
+
+#include <cstdio>
+#include "sdkconfig.h"
+#include "light_fade.h"
+
+using namespace light_fade;
+
+constexpr unsigned c_bits {CONFIG_HA_LIGHT_DUTY_RESOLUTION};
+constexpr uint32_t c_step_ms {10};
+
+static int s_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      s_failures++; \
+    } \
+  } while (0)
+
+static uint32_t s_Fade(uint32_t from, uint8_t brightness, uint32_t transition_ms, uint32_t &to) {
+
+  to = BrightnessToDuty(brightness, c_bits);
+  return FadeTime(from, to, transition_ms, CONFIG_HA_LIGHT_PWM_FREQ_HZ,
+                  CONFIG_HA_LIGHT_MAX_TRANSITION_MS);
+}
+
+/* Every duty up to elapsed_ms stays between from and to, moving one way only. */
+static void s_CheckFade(uint32_t from, uint32_t to, uint32_t total_ms, uint32_t elapsed_ms) {
+
+  uint32_t last = from;
+  const uint32_t low = from < to ? from : to, high = from < to ? to : from;
+
+  CHECK(FadeDuty(from, to, 0, total_ms) == from);
+  for (uint32_t ms = c_step_ms; ms <= elapsed_ms; ms += c_step_ms) {
+    uint32_t duty = FadeDuty(from, to, ms, total_ms);
+    CHECK(duty >= low && duty <= high);
+    CHECK(from < to ? duty >= last : duty <= last);
+    last = duty;
+  }
+}
+
+static void s_TestCurve(void) {
+
+  for (unsigned bits = 8; bits <= 14; bits++) {
+    uint32_t last = 0;
+    CHECK(BrightnessToDuty(0, bits) == 0);
+    CHECK(BrightnessToDuty(c_brightness_max, bits) == DutyMax(bits));
+    for (unsigned b = 1; b <= c_brightness_max; b++) {
+      uint32_t duty = BrightnessToDuty(b, bits);
+      CHECK(duty >= 1 && duty >= last);
+      /* Reporting a duty never claims more than it shows. */
+      uint8_t reported = DutyToBrightness(duty, bits);
+      CHECK(reported >= b && BrightnessToDuty(reported, bits) == duty);
+      last = duty;
+    }
+  }
+  /* The curve is perceptual: half brightness is well below half duty. */
+  CHECK(BrightnessToDuty(128, c_bits) < DutyMax(c_bits) / 4);
+}
+
+static void s_TestFade(void) {
+
+  uint32_t to;
+  const uint32_t from = BrightnessToDuty(20, c_bits);
+  const uint32_t total_ms = s_Fade(from, 200, 1000, to);
+
+  CHECK(total_ms == 1000);
+  s_CheckFade(from, to, total_ms, total_ms);
+  CHECK(FadeDuty(from, to, total_ms / 2, total_ms) == from + (to - from) / 2);
+  CHECK(FadeDuty(from, to, total_ms, total_ms) == to);
+  CHECK(FadeDuty(from, to, total_ms + 500, total_ms) == to);
+
+  /* And back down, to off. */
+  const uint32_t down_ms = s_Fade(to, 0, 1000, to);
+  CHECK(to == 0);
+  s_CheckFade(BrightnessToDuty(200, c_bits), 0, down_ms, down_ms);
+  CHECK(FadeDuty(BrightnessToDuty(200, c_bits), 0, down_ms, down_ms) == 0);
+}
+
+static void s_TestRetarget(void) {
+
+  /* Full on over a second, stopped at 400 ms by a command for 25%. */
+  uint32_t to;
+  const uint32_t total_ms = s_Fade(0, c_brightness_max, 1000, to);
+  s_CheckFade(0, to, total_ms, 400);
+  const uint32_t stopped = FadeDuty(0, to, 400, total_ms);
+  CHECK(stopped == DutyMax(c_bits) * 400 / 1000);
+
+  uint32_t to2;
+  const uint32_t total2_ms = s_Fade(stopped, 64, 1000, to2);
+  CHECK(total2_ms == 1000);
+  CHECK(to2 < stopped);
+  /* The new fade starts where the old one stopped, without a jump. */
+  s_CheckFade(stopped, to2, total2_ms, total2_ms);
+  CHECK(FadeDuty(stopped, to2, total2_ms, total2_ms) == to2);
+
+  /* A brightness read while stopped is where the light is. */
+  uint8_t reported = DutyToBrightness(stopped, c_bits);
+  CHECK(BrightnessToDuty(reported, c_bits) <= stopped);
+  CHECK(reported == c_brightness_max || BrightnessToDuty(reported + 1, c_bits) > stopped);
+
+  /* Retargeted to where it already is, nothing is left to fade. */
+  CHECK(s_Fade(to2, 64, 1000, to2) == 0);
+}
+
+static void s_TestFadeTime(void) {
+
+  uint32_t to;
+  CHECK(s_Fade(0, 100, 0, to) == 0);
+  CHECK(s_Fade(0, 100, CONFIG_HA_LIGHT_MAX_TRANSITION_MS + 1000, to) ==
+        CONFIG_HA_LIGHT_MAX_TRANSITION_MS);
+  /* One duty step is held at most c_max_cycles_per_step PWM periods. */
+  CHECK(FadeTime(0, 1, 5000, 5000, 10000) == c_max_cycles_per_step * 1000 / 5000);
+  CHECK(FadeTime(10, 10, 5000, 5000, 10000) == 0);
+}
+
+int main() {
+
+  s_TestCurve();
+  s_TestFade();
+  s_TestRetarget();
+  s_TestFadeTime();
+  if (s_failures)
+    fprintf(stderr, "%d checks failed\n", s_failures);
+  return s_failures ? 1 : 0;
+}
@@ -29,6 +29,7 @@
  */
 
 #include <cstdint>
+#include <cstdio>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
@@ -40,27 +41,51 @@
 #include "esp_intr_alloc.h"
 #include "mqtt_manager.h"
 #include "ha_switch.h"
+#include "ha_sensor.h"
+#include "ha_light.h"
+#include "discovery_cache.h"
+#include "ha_rediscovery.h"
+#include "ha_rules.h"
+#include "trace.h"
+#include "dlog.h"
+#include "boot_orchestrator.h"
+#include "timer_wheel.h"
+#include "telemetry.h"
+#include "ota_delta.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "ssd1306.h"
+#include "asset_pack.h"
+#ifdef CONFIG_APP_BUILTIN_ASSETS
 #include "images.h"
+#endif
+#include "menu.h"
 
 constexpr gpio_num_t c_led_gpio {GPIO_NUM_14};
+constexpr gpio_num_t c_enter_gpio {GPIO_NUM_2};
 constexpr uint64_t   c_buttons_gpios { 1LLU << 7 | 1LLU << 6 | 1LLU << 5 | \
                                        1LLU << 4 | 1LLU << 3 | 1LLU << 2 };
+constexpr uint32_t   c_mqtt_connect_timeout_ms {10000};
 
 struct app_ctx {
   TaskHandle_t main_task;
   SSD1306_t *ssd1306;
+  asset_t logo;
+  asset_t light_on;
+  asset_t light_off;
 };
 
 static const char *s_TAG = "main_app";
 static app_ctx DRAM_ATTR s_app_cfg;
 
 static esp_err_t s_BoardInit();
-static void s_DrawBaseGui();
+static void s_LoadAssets();
+static void s_DrawAsset(const asset_t &asset, unsigned frame);
 static void s_PlayAnimation(bool state);
+static bool s_HeldFor(gpio_num_t gpio, uint32_t hold_ms);
 static void s_led_cb(HaSwitch *switch_p);
+static void s_MqttConnected(void *user_ctx);
+static void s_MenuLabel(unsigned item, char *label, size_t len, void *user_ctx);
 
 extern "C" void app_main() {
 
@@ -83,40 +108,57 @@ extern "C" void app_main() {
   for (auto &my_switch : switches) {
     ESP_ERROR_CHECK(my_switch.Connect());
   }
+  ESP_ERROR_CHECK_WITHOUT_ABORT(TelemetryInit());
+  ESP_ERROR_CHECK_WITHOUT_ABORT(OtaDeltaInit());
+  /* Entities removed since the last boot disappear from Home Assistant. */
+  ESP_ERROR_CHECK_WITHOUT_ABORT(DiscoverySweep());
+  /* Home Assistant restarts are answered with a paced republish. */
+  ESP_ERROR_CHECK_WITHOUT_ABORT(HaRediscoveryInit([](void*) { TelemetryRepublish(true); }, nullptr));
+  ESP_ERROR_CHECK(HaRulesInit());
 
+#ifdef CONFIG_HA_SWITCH_RESTORE_STATE
+  /* Resume the state retained on the broker, which the LED follows. */
+  ESP_ERROR_CHECK_WITHOUT_ABORT(HaSwitch::RestoreAll(CONFIG_HA_SWITCH_RESTORE_TIMEOUT_MS));
+#else
   /* We call reset() to synchronize the state of the physical
    * LED with the application and MQTT integration */
   ESP_ERROR_CHECK(switches[5].reset());
+#endif
 
-  int selection = 0;
-  s_DrawBaseGui();
-  ssd1306_display_text(s_app_cfg.ssd1306, selection + 1, " -> ", 4, false);
+  /* Entities are listed on pages 1 to 6, scrolling when there are more. */
+  Menu menu(s_app_cfg.ssd1306, 1, 6, s_MenuLabel, switches);
+  menu.setCount(num_switches);
+  ssd1306_clear_screen(s_app_cfg.ssd1306, false);
+  menu.cleared();
+  menu.render();
   while(true) {
     uint32_t input = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     /* If input, process it. */
     if (input) {
-      ESP_LOGI(s_TAG, "Received notification. Processing GPIO mask %#.8x.", input);
-      ssd1306_display_text(s_app_cfg.ssd1306, selection + 1, "    ", 4, false);
+      TRACE_BEGIN(MAIN_LOOP, input);
+      DLOGI(s_TAG, "Received notification. Processing GPIO mask %#.8" PRIx32 ".", input);
       switch (input) {
         case (1LLU << 7) : //Button UP
-          if (selection == 0)
-            selection = (num_switches - 1);
-          else
-            --selection;
+          menu.up();
           break;
         case (1LLU << 4) : //Button DOWN
-          ++selection;
-          selection %= (num_switches);
+          menu.down();
           break;
         case (1LLU << 2) : //Button ENTER
-          switches[selection].toggle();
-          s_PlayAnimation(switches[selection].get());
-          s_DrawBaseGui();
+          if (s_HeldFor(c_enter_gpio, CONFIG_APP_LONG_PRESS_MS)) {
+            switches[menu.selection()].longPress();
+            break;
+          }
+          switches[menu.selection()].toggle();
+          s_PlayAnimation(switches[menu.selection()].get());
+          ssd1306_clear_screen(s_app_cfg.ssd1306, false);
+          menu.cleared();
           break;
         default :
-        ESP_LOGI(s_TAG, "Unknown function for GPIO mask: %#.8x", input);
+        DLOGI(s_TAG, "Unknown function for GPIO mask: %#.8" PRIx32, input);
       }
-      ssd1306_display_text(s_app_cfg.ssd1306, selection + 1, " -> ", 4, false);
+      menu.render();
+      TRACE_END(MAIN_LOOP, input);
       //deboucing....
       vTaskDelay(180 / portTICK_PERIOD_MS);
       ulTaskNotifyTake(pdTRUE, 0);
@@ -131,6 +173,7 @@ static void IRAM_ATTR s_GpioIsr(void *args) {
   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
   uint32_t gpio_intr_status = READ_PERI_REG(GPIO_STATUS_REG);  //read status to get interrupt status for GPIO0-31
   gpio_intr_status &= c_buttons_gpios;
+  TRACE_INSTANT(GPIO_ISR, gpio_intr_status);
   if (gpio_intr_status) //If Button UP, DOWN or ENTER, wake main app task.
     xTaskNotifyFromISR(s_app_cfg.main_task, gpio_intr_status, 
                        eSetValueWithOverwrite, &xHigherPriorityTaskWoken);
@@ -177,60 +220,134 @@ static void s_InitSsd1306() {
   ssd1306_init(s_app_cfg.ssd1306, 128, 64);
   ssd1306_clear_screen(s_app_cfg.ssd1306, false);
   ssd1306_contrast(s_app_cfg.ssd1306, 0x7f);
-  ssd1306_bitmaps(s_app_cfg.ssd1306, 0, 0, franzininho_logo, 128, 64, false);
+  s_DrawAsset(s_app_cfg.logo, 0);
 }
 
-void s_DrawBaseGui() {
+void s_LoadAssets() {
 
-  ssd1306_clear_screen(s_app_cfg.ssd1306, false);
-  ssd1306_display_text(s_app_cfg.ssd1306, 1, "    Switch 1", 12, false);
-  ssd1306_display_text(s_app_cfg.ssd1306, 2, "    Switch 2", 12, false);
-  ssd1306_display_text(s_app_cfg.ssd1306, 3, "    Switch 3", 12, false);
-  ssd1306_display_text(s_app_cfg.ssd1306, 4, "    Switch 4", 12, false);
-  ssd1306_display_text(s_app_cfg.ssd1306, 5, "    Switch 5", 12, false);
-  ssd1306_display_text(s_app_cfg.ssd1306, 6, "    Red LED ", 12, false);
+  if (AssetPackInit() != ESP_OK)
+    ESP_LOGW(s_TAG, "Asset pack unavailable");
+
+  struct {
+    const char *name;
+    asset_t *asset;
+    asset_t builtin;
+  } assets[] = {
+#ifdef CONFIG_APP_BUILTIN_ASSETS
+    { "logo", &s_app_cfg.logo, { "logo", 128, 64, 1, 0, franzininho_logo } },
+    { "light_on", &s_app_cfg.light_on,
+      { "light_on", FRAME_WIDTH, FRAME_HEIGHT, FRAME_COUNT, FRAME_DELAY, light_on[0] } },
+    { "light_off", &s_app_cfg.light_off,
+      { "light_off", FRAME_WIDTH, FRAME_HEIGHT, FRAME_COUNT, FRAME_DELAY, light_off[0] } },
+#else
+    { "logo", &s_app_cfg.logo, {} },
+    { "light_on", &s_app_cfg.light_on, {} },
+    { "light_off", &s_app_cfg.light_off, {} },
+#endif
+  };
+
+  for (auto &a : assets) {
+    if (AssetFind(a.name, a.asset) != ESP_OK)
+      *a.asset = a.builtin;
+  }
+}
+
+void s_DrawAsset(const asset_t &asset, unsigned frame) {
+
+  /* Frames are drawn centred, straight from the mapped flash. */
+  if (!asset.frames)
+    return;
+  ssd1306_bitmaps(s_app_cfg.ssd1306, (128 - asset.width) / 2, (64 - asset.height) / 2,
+                  AssetFrame(&asset, frame), asset.width, asset.height, false);
 }
 
 void s_PlayAnimation(bool state) {
 
   ssd1306_clear_screen(s_app_cfg.ssd1306, false);
   if (state) {
-    for (int i = 0; i < 2 * FRAME_COUNT - 10; i++) {
-      ssd1306_bitmaps(s_app_cfg.ssd1306, FRAME_START_X, FRAME_START_Y, light_on[i % FRAME_COUNT],
-                       FRAME_WIDTH, FRAME_HEIGHT, false);
-      vTaskDelay(pdMS_TO_TICKS(FRAME_DELAY));
+    const asset_t &frames = s_app_cfg.light_on;
+    for (int i = 0; i < 2 * frames.frames - 10; i++) {
+      s_DrawAsset(frames, i);
+      vTaskDelay(pdMS_TO_TICKS(frames.frame_delay_ms));
     }
   }
   else {
-    for (int i = 0; i < 3 * FRAME_COUNT / 2; i++) {
-      ssd1306_bitmaps(s_app_cfg.ssd1306, FRAME_START_X, FRAME_START_Y, light_off[i % FRAME_COUNT],
-                       FRAME_WIDTH, FRAME_HEIGHT, false);
-      vTaskDelay(pdMS_TO_TICKS(FRAME_DELAY));
+    const asset_t &frames = s_app_cfg.light_off;
+    for (int i = 0; i < 3 * frames.frames / 2; i++) {
+      s_DrawAsset(frames, i);
+      vTaskDelay(pdMS_TO_TICKS(frames.frame_delay_ms));
     }
   }
 }
 
+bool s_HeldFor(gpio_num_t gpio, uint32_t hold_ms) {
+
+  /* Buttons are active low; returns early once released. */
+  constexpr uint32_t poll_ms {20};
+  for (uint32_t held_ms = 0; held_ms < hold_ms; held_ms += poll_ms) {
+    if (gpio_get_level(gpio))
+      return false;
+    vTaskDelay(pdMS_TO_TICKS(poll_ms));
+  }
+  return !gpio_get_level(gpio);
+}
+
 esp_err_t s_BoardInit() {
 
+  /* Init stages and their dependencies. Display and NVS work overlap with
+   * the Wi-Fi association, which dominates the boot time. */
+  enum { ASSETS, DISPLAY, NVS, NETIF, GPIO, EVENT_LOOP, TIMERS, WIFI, MQTT, MQTT_ONLINE, NUM_STAGES };
+  static boot_stage_t stages[NUM_STAGES] = {};
+  stages[ASSETS]      = { "assets", [](void*) { s_LoadAssets(); return ESP_OK; } };
+  stages[DISPLAY]     = { "display", [](void*) { s_InitSsd1306(); return ESP_OK; }, nullptr,
+                          BOOT_DEP(ASSETS) };
+  stages[NVS]         = { "nvs", [](void*) { return nvs_flash_init(); } };
+  stages[NETIF]       = { "netif", [](void*) { return esp_netif_init(); } };
+  stages[GPIO]        = { "gpio", s_InitGpio };
+  stages[EVENT_LOOP]  = { "event_loop", [](void*) { return esp_event_loop_create_default(); } };
+  stages[TIMERS]      = { "timers", [](void*) { return TimerWheelInit(); } };
+  stages[WIFI]        = { "wifi", [](void*) { return example_connect(); }, nullptr,
+                          BOOT_DEP(NVS) | BOOT_DEP(NETIF) | BOOT_DEP(EVENT_LOOP) };
+  stages[MQTT]        = { "mqtt", [](void*) {
+                            MqttSetConnectedCallback(s_MqttConnected, nullptr);
+                            return MqttInit();
+                          }, nullptr, BOOT_DEP(WIFI) };
+  /* Bounded wait so the state can be restored from the broker; without one
+   * the device boots offline and the connected callback catches up later. */
+  stages[MQTT_ONLINE] = { "mqtt_online", [](void*) {
+                            if (MqttWaitConnected(c_mqtt_connect_timeout_ms) == ESP_ERR_TIMEOUT)
+                              ESP_LOGW(s_TAG, "Broker not reached, starting offline");
+                            return ESP_OK;
+                          }, nullptr, BOOT_DEP(MQTT) };
+
   esp_err_t rc;
-  s_InitSsd1306();
-  if ((rc = nvs_flash_init()))
-    return rc;
-  if ((rc = esp_netif_init()))
-    return rc;
-  if ((rc = s_InitGpio(NULL)))
-    return rc;
-  if ((rc = esp_event_loop_create_default()))
-    return rc;
-  if ((rc = example_connect()))
+  if ((rc = TraceInit()))
     return rc;
-  if ((rc = MqttInit()))
+  if ((rc = DlogInit()))
     return rc;
-  vTaskDelay(3000 / portTICK_PERIOD_MS);
-  return rc = MqttPublish("franzininho-wifi/status", "online", 0, 0, 1);
+  return rc = BootRun(stages, NUM_STAGES);
+}
+
+void s_MqttConnected(void *user_ctx) {
+
+  /* Runs on every (re)connection. States changed while offline were never
+   * published; configs are only sent when the discovery cache does not hold
+   * them for this broker, i.e. after failover to another one. */
+  OtaDeltaConfirm();
+  MqttPublish("franzininho-wifi/status", "online", 0, 0, 1);
+  HaSwitch::RepublishAll(false);
+  HaSensor::RepublishAll(false);
+  HaLight::RepublishAll(false);
+  TelemetryRepublish(false);
 }
 
 void s_led_cb(HaSwitch *switch_p) {
 
   gpio_set_level(c_led_gpio, switch_p->get());
 }
+
+void s_MenuLabel(unsigned item, char *label, size_t len, void *user_ctx) {
+
+  HaSwitch &my_switch = static_cast<HaSwitch*>(user_ctx)[item];
+  snprintf(label, len, "Switch %-3u%s", my_switch.index(), my_switch.get() ? " *" : "");
+}
@@ -0,0 +1,153 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file menu.cpp
+ *
+ * @brief Scrolling entity menu implementation.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "menu.h"
+
+/* Font used by ssd1306_display_text(), defined in the ssd1306 component. */
+extern "C" uint8_t font8x8_basic_tr[128][8];
+
+static constexpr char c_cursor[] {" -> "};
+static constexpr int c_label_col {sizeof(c_cursor) - 1};
+
+Menu::Menu(SSD1306_t *dev, int first_page, int rows, menu_label_cb label_cb, void *user_ctx) :
+    m_dev(dev),
+    m_first_page(first_page),
+    m_rows(std::clamp(rows, 1, c_max_rows - first_page)),
+    m_label_cb(label_cb),
+    m_user_ctx(user_ctx),
+    m_count(0),
+    m_selection(0),
+    m_top(0),
+    m_glyphs(0) {
+
+  cleared();
+}
+
+void Menu::setCount(unsigned count) {
+
+  m_count = count;
+  if (m_selection >= count)
+    m_selection = count ? count - 1 : 0;
+  if (m_top > m_selection)
+    m_top = m_selection;
+  if (count > (unsigned) m_rows && m_top > count - m_rows)
+    m_top = count - m_rows;
+}
+
+unsigned Menu::count() const {
+
+  return m_count;
+}
+
+unsigned Menu::selection() const {
+
+  return m_selection;
+}
+
+void Menu::up() {
+
+  if (!m_count)
+    return;
+  if (m_selection == 0) {
+    m_selection = m_count - 1;
+    m_top = m_count > (unsigned) m_rows ? m_count - m_rows : 0;
+  } else if (--m_selection < m_top) {
+    m_top = m_selection;
+  }
+}
+
+void Menu::down() {
+
+  if (!m_count)
+    return;
+  if (++m_selection >= m_count) {
+    m_selection = 0;
+    m_top = 0;
+  } else if (m_selection >= m_top + m_rows) {
+    m_top = m_selection - m_rows + 1;
+  }
+}
+
+void Menu::cleared() {
+
+  memset(m_shown, ' ', sizeof(m_shown));
+}
+
+unsigned Menu::glyphsWritten() const {
+
+  return m_glyphs;
+}
+
+void Menu::mCompose(unsigned item, char *row) {
+
+  memset(row, ' ', c_cols);
+  if (item >= m_count)
+    return;
+
+  char label[c_cols - c_label_col + 1] = "";
+  if (m_label_cb)
+    m_label_cb(item, label, sizeof(label), m_user_ctx);
+  if (item == m_selection)
+    memcpy(row, c_cursor, c_label_col);
+  memcpy(row + c_label_col, label, strnlen(label, sizeof(label) - 1));
+}
+
+void Menu::mWriteGlyph(int page, int col, char c) {
+
+  uint8_t glyph[8];
+  memcpy(glyph, font8x8_basic_tr[(uint8_t) c & 0x7f], sizeof(glyph));
+  if (m_dev->_flip) {
+    /* Same bit order reversal ssd1306_display_text() does when flipped. */
+    for (auto &b : glyph) {
+      b = ((b & 0xf0) >> 4) | ((b & 0x0f) << 4);
+      b = ((b & 0xcc) >> 2) | ((b & 0x33) << 2);
+      b = ((b & 0xaa) >> 1) | ((b & 0x55) << 1);
+    }
+  }
+  ssd1306_display_image(m_dev, page, col * 8, glyph, sizeof(glyph));
+  m_glyphs++;
+}
+
+void Menu::render() {
+
+  for (int row = 0; row < m_rows; row++) {
+    char text[c_cols];
+    mCompose(m_top + row, text);
+    for (int col = 0; col < c_cols; col++) {
+      if (text[col] == m_shown[row][col])
+        continue;
+      mWriteGlyph(m_first_page + row, col, text[col]);
+      m_shown[row][col] = text[col];
+    }
+  }
+}
@@ -0,0 +1,75 @@
+/**
+ * SPDX-License-Identifier: GPLv2
+ *
+ * Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file menu.h
+ *
+ * @brief Scrolling entity menu for the SSD1306 display.
+ *
+ * @author Vinicius Silva <silva.viniciusr@gmail.com>
+ *
+ * @date October 19th 2026
+ *
+ * Only the rows in the visible window are rendered, so the number of items
+ * is not limited by the display. The menu remembers the text on every row
+ * and each render only writes the 8x8 glyph cells that changed; scrolling by
+ * one item usually rewrites a few digits per row instead of the whole page.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "ssd1306.h"
+
+/* Writes the label of item, at most len - 1 characters, into label. */
+typedef void (*menu_label_cb)(unsigned item, char *label, size_t len, void *user_ctx);
+
+class Menu {
+public:
+  static constexpr int c_cols {16};
+  static constexpr int c_max_rows {8};
+
+  Menu(SSD1306_t *dev, int first_page, int rows, menu_label_cb label_cb, void *user_ctx = nullptr);
+  void setCount(unsigned count);
+  unsigned count() const;
+  unsigned selection() const;
+  void up();
+  void down();
+  /* The screen was cleared by someone else, the next render draws all rows. */
+  void cleared();
+  /* Bring the display up to date, labels of the visible items are refreshed. */
+  void render();
+  /* Glyph cells written to the display since boot. */
+  unsigned glyphsWritten() const;
+
+private:
+  SSD1306_t *m_dev;
+  const int m_first_page;
+  const int m_rows;
+  const menu_label_cb m_label_cb;
+  void *m_user_ctx;
+  unsigned m_count;
+  unsigned m_selection;
+  unsigned m_top;
+  unsigned m_glyphs;
+  char m_shown[c_max_rows][c_cols];
+  void mCompose(unsigned item, char *row);
+  void mWriteGlyph(int page, int col, char c);
+};
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: GPLv2
+#
+# Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+#
+# Format raw deferred log records (CONFIG_DLOG_OUTPUT_BINARY) captured from
+# the device console. Format strings, tags and %s arguments are read from the
+# application ELF, at the addresses stored in the records. Other console
+# lines are passed through unchanged.
+#
+# Usage: dlog_decode.py build/mqtt_ssl.elf monitor.log
+#
+# Requires pyelftools, which is part of the ESP-IDF Python environment.
+#
+
+"""Format raw deferred log records using the application ELF."""
+
+import argparse
+import re
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+SPEC = re.compile(r'%([-+ #0]*)(\d*|\*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcspn%])')
+
+
+class Strings:
+    """Reads NUL terminated strings from the loadable sections of an ELF."""
+
+    def __init__(self, elf_file):
+        elf = ELFFile(elf_file)
+        self.sections = []
+        for section in elf.iter_sections():
+            if section['sh_addr'] and section['sh_type'] == 'SHT_PROGBITS':
+                self.sections.append((section['sh_addr'], section.data()))
+
+    def get(self, address):
+        for start, data in self.sections:
+            if start <= address < start + len(data):
+                end = data.find(b'\0', address - start)
+                return data[address - start:end].decode('utf-8', 'replace')
+        return None
+
+
+def signed(value):
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def format_record(strings, fmt, args):
+    """printf() with 32 bit arguments, as done by the device in text mode."""
+    args = iter(args)
+
+    def replace(match):
+        flags, width, precision, _, conv = match.groups()
+        if conv == '%':
+            return '%'
+        value = next(args, 0)
+        if conv == 's':
+            text = strings.get(value)
+            value = text if text is not None else '<0x%08x>' % value
+        elif conv == 'p':
+            conv, flags = 'x', flags + '#'
+        elif conv in 'di':
+            value = signed(value)
+        elif conv == 'c':
+            value = chr(value & 0xff)
+        elif conv == 'u':
+            conv = 'd'
+        spec = '%' + flags + width + ('.' + precision if precision else '') + conv
+        return spec % value
+
+    return SPEC.sub(replace, fmt)
+
+
+def decode(strings, line):
+    fields = line.split()
+    timestamp, fmt, tag = (int(f, 16) for f in fields[1:4])
+    level = fields[4]
+    args = [int(f, 16) for f in fields[5:]]
+    fmt_text = strings.get(fmt)
+    if fmt_text is None:
+        return '%s (%d) dlog: unknown format 0x%08x %s' % (level, timestamp, fmt, fields[5:])
+    tag_text = strings.get(tag) or '0x%08x' % tag
+    return '%s (%d) %s: %s' % (level, timestamp, tag_text, format_record(strings, fmt_text, args))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('elf', type=argparse.FileType('rb'), help='application ELF file')
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r', errors='replace'),
+                        default=sys.stdin, help='captured console output')
+    args = parser.parse_args()
+
+    strings = Strings(args.elf)
+    for line in args.log:
+        start = line.find('DLOG ')
+        if start < 0:
+            sys.stdout.write(line)
+            continue
+        try:
+            print(decode(strings, line[start:]))
+        except (ValueError, IndexError):
+            sys.stdout.write(line)
+
+
+if __name__ == '__main__':
+    main()
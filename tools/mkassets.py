@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: GPLv2
+#
+# Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+#
+# Build the asset pack read by the asset_pack component from a manifest of
+# PBM images, see assets/manifest.txt. Flash it on its own with
+#   parttool.py write_partition --partition-name assets --input assets.bin
+#
+# Usage: mkassets.py assets/manifest.txt -o assets.bin
+#
+
+"""Build a display asset pack from a manifest of PBM images."""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+# Keep in sync with components/asset_pack/include/asset_pack.h
+MAGIC = 0x4b505341  # "ASPK"
+VERSION = 1
+HEADER = struct.Struct('<IHHII')
+ENTRY = struct.Struct('<16sIIHHHH')
+NAME_MAX = 15
+ALIGN = 4
+
+
+def read_pbm(path):
+    """Return (width, height, rows) of a binary PBM file."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    while len(fields) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            pos = data.index(b'\n', pos)
+            continue
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    if fields[0] != b'P4':
+        raise ValueError('%s: only binary PBM (P4) is supported' % path)
+    width, height = int(fields[1]), int(fields[2])
+    pixels = data[pos + 1:]
+    if len(pixels) < (width + 7) // 8 * height:
+        raise ValueError('%s: truncated' % path)
+    return width, height, pixels[:(width + 7) // 8 * height]
+
+
+def read_manifest(path):
+    base = os.path.dirname(path)
+    assets = []
+    with open(path) as f:
+        for num, line in enumerate(f, 1):
+            line = line.split('#', 1)[0].split()
+            if not line:
+                continue
+            if len(line) != 5:
+                raise ValueError('%s:%d: expected name file width height delay' % (path, num))
+            name, file, width, height, delay = line
+            if len(name) > NAME_MAX:
+                raise ValueError('%s:%d: name longer than %d' % (path, num, NAME_MAX))
+            assets.append((name, os.path.join(base, file), int(width), int(height), int(delay)))
+    return assets
+
+
+def build(assets):
+    entries = []
+    blobs = []
+    offset = HEADER.size + ENTRY.size * len(assets)
+    for name, file, width, height, delay in assets:
+        sheet_width, sheet_height, pixels = read_pbm(file)
+        if sheet_width != width or sheet_height % height:
+            raise ValueError('%s: %dx%d is not a sheet of %dx%d frames' %
+                             (file, sheet_width, sheet_height, width, height))
+        offset = (offset + ALIGN - 1) // ALIGN * ALIGN
+        entries.append(ENTRY.pack(name.encode(), offset, len(pixels), width, height,
+                                  sheet_height // height, delay))
+        blobs.append((offset, pixels))
+        offset += len(pixels)
+
+    body = bytearray(offset - HEADER.size)
+    index = b''.join(entries)
+    body[:len(index)] = index
+    for blob_offset, pixels in blobs:
+        start = blob_offset - HEADER.size
+        body[start:start + len(pixels)] = pixels
+    header = HEADER.pack(MAGIC, VERSION, len(assets), offset, zlib.crc32(body))
+    return header + bytes(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('manifest')
+    parser.add_argument('-o', '--output', required=True)
+    parser.add_argument('--max-size', type=lambda v: int(v, 0),
+                        help='fail if the pack exceeds this size, e.g. the partition size')
+    args = parser.parse_args()
+
+    try:
+        assets = read_manifest(args.manifest)
+        pack = build(assets)
+    except (OSError, ValueError) as e:
+        sys.exit('mkassets: %s' % e)
+    if args.max_size and len(pack) > args.max_size:
+        sys.exit('mkassets: pack is %d bytes, larger than %d' % (len(pack), args.max_size))
+    with open(args.output, 'wb') as f:
+        f.write(pack)
+    print('%s: %d assets, %d bytes' % (args.output, len(assets), len(pack)))
+
+
+if __name__ == '__main__':
+    main()
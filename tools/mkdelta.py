@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: GPLv2
+#
+# Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+#
+# Build, check and send delta patches for the ota_delta component. A patch
+# rebuilds the new image from ranges of the image the board runs and literal
+# bytes, see components/ota_delta/include/delta_patch.h.
+#
+# Usage: mkdelta.py diff old.bin new.bin -o update.fdp
+#        mkdelta.py apply old.bin update.fdp -o check.bin
+#        mkdelta.py send update.fdp --host broker.local
+#
+# send requires paho-mqtt; a patch can also be served over HTTP(S) and its
+# URL published to franzininho-wifi/ota/url.
+#
+
+"""Build, check and send delta OTA patches."""
+
+import argparse
+import hashlib
+import struct
+import sys
+import threading
+
+# Keep in sync with components/ota_delta/include/delta_patch.h
+MAGIC = b'FDP1'
+HEADER = struct.Struct('<4sII32s32s')
+COPY = struct.Struct('<cII')
+INSERT = struct.Struct('<cI')
+END = b'E'
+
+# Matches are looked up by BLOCK bytes hashed every STRIDE bytes of the old
+# image; shorter copies cost more than the literal bytes they replace.
+BLOCK = 16
+STRIDE = 4
+MIN_COPY = 24
+
+TOPIC = 'franzininho-wifi/ota/'
+# Chunks must fit the device MQTT buffer (CONFIG_MQTT_BUFFER_SIZE) with the
+# topic, or they arrive truncated.
+CHUNK = 896
+WINDOW = 8
+
+
+def match_length(old, o, new, n):
+    """Length of the common run of old[o:] and new[n:]."""
+    length = 0
+    step = 256
+    while step:
+        while old[o + length:o + length + step] == new[n + length:n + length + step] and \
+                o + length + step <= len(old) and n + length + step <= len(new):
+            length += step
+        step //= 4
+    while o + length < len(old) and n + length < len(new) and old[o + length] == new[n + length]:
+        length += 1
+    return length
+
+
+def diff(old, new):
+    """Greedy COPY/INSERT patch rebuilding new from old."""
+    index = {}
+    for o in range(0, len(old) - BLOCK + 1, STRIDE):
+        index.setdefault(old[o:o + BLOCK], o)
+
+    ops = []
+    literal = 0
+    n = 0
+    while n + BLOCK <= len(new):
+        o = index.get(new[n:n + BLOCK])
+        length = match_length(old, o, new, n) if o is not None else 0
+        if length < MIN_COPY:
+            n += 1
+            continue
+        # Grow the match backwards over the literal bytes before it.
+        while literal < n and o and old[o - 1] == new[n - 1]:
+            o, n, length = o - 1, n - 1, length + 1
+        if literal < n:
+            ops.append(INSERT.pack(b'I', n - literal) + new[literal:n])
+        ops.append(COPY.pack(b'C', o, length))
+        n += length
+        literal = n
+    if literal < len(new):
+        ops.append(INSERT.pack(b'I', len(new) - literal) + new[literal:])
+
+    header = HEADER.pack(MAGIC, len(old), len(new), hashlib.sha256(old).digest(),
+                         hashlib.sha256(new).digest())
+    return header + b''.join(ops) + END
+
+
+def apply(old, patch):
+    """Rebuild the new image, checking the patch as the device does."""
+    magic, old_size, new_size, old_sha, new_sha = HEADER.unpack_from(patch)
+    if magic != MAGIC:
+        raise ValueError('not a delta patch')
+    if old_size > len(old) or hashlib.sha256(old[:old_size]).digest() != old_sha:
+        raise ValueError('patch was built for another image')
+    old = old[:old_size]
+
+    new = bytearray()
+    pos = HEADER.size
+    while True:
+        op = patch[pos:pos + 1]
+        if op == b'C':
+            _, offset, length = COPY.unpack_from(patch, pos)
+            if offset + length > old_size:
+                raise ValueError('copy past the end of the image at %d' % pos)
+            new += old[offset:offset + length]
+            pos += COPY.size
+        elif op == b'I':
+            _, length = INSERT.unpack_from(patch, pos)
+            pos += INSERT.size
+            new += patch[pos:pos + length]
+            pos += length
+        elif op == END:
+            break
+        else:
+            raise ValueError('bad op at %d' % pos)
+        if len(new) > new_size:
+            raise ValueError('patch writes past the image size')
+    if pos + 1 != len(patch):
+        raise ValueError('data after the end of the patch')
+    if hashlib.sha256(new).digest() != new_sha:
+        raise ValueError('rebuilt image does not match the patch hash')
+    return bytes(new)
+
+
+def send(patch, host, port, chunk, window):
+    """Send patch over MQTT, resending from the offset the device expects."""
+    import json
+    import paho.mqtt.client as mqtt
+
+    state = {'offset': 0, 'status': None}
+    changed = threading.Condition()
+
+    def on_message(client, userdata, message):
+        status = json.loads(message.payload)
+        with changed:
+            state['status'] = status
+            if status['state'] == 'receiving':
+                state['offset'] = status['offset']
+            changed.notify()
+
+    client = mqtt.Client()
+    client.on_message = on_message
+    client.connect(host, port)
+    client.subscribe(TOPIC + 'status', 1)
+    client.loop_start()
+    client.publish(TOPIC + 'begin', str(len(patch)), 1)
+
+    sent = 0
+    with changed:
+        while True:
+            status = state['status']
+            if status and status['state'] in ('done', 'error', 'aborted'):
+                break
+            # Rewind to the device's offset when acks fall a window behind.
+            if sent - state['offset'] >= chunk * window or sent >= len(patch):
+                if not changed.wait(5):
+                    sent = state['offset']
+                continue
+            if sent < state['offset']:
+                sent = state['offset']
+            client.publish(TOPIC + 'chunk', struct.pack('<I', sent) + patch[sent:sent + chunk], 1)
+            sent = min(sent + chunk, len(patch))
+            print('\r%d / %d' % (state['offset'], len(patch)), end='', file=sys.stderr)
+    client.loop_stop()
+    print(file=sys.stderr)
+    if status['state'] != 'done':
+        raise ValueError('device reported %s %s' % (status['state'], status['error']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    commands = parser.add_subparsers(dest='command', required=True)
+    p = commands.add_parser('diff', help='build a patch from old to new')
+    p.add_argument('old')
+    p.add_argument('new')
+    p.add_argument('-o', '--output', required=True)
+    p = commands.add_parser('apply', help='rebuild and check the new image')
+    p.add_argument('old')
+    p.add_argument('patch')
+    p.add_argument('-o', '--output')
+    p = commands.add_parser('send', help='send a patch over MQTT')
+    p.add_argument('patch')
+    p.add_argument('--host', required=True)
+    p.add_argument('--port', type=int, default=1883)
+    p.add_argument('--chunk', type=int, default=CHUNK, help='patch bytes per message')
+    p.add_argument('--window', type=int, default=WINDOW, help='messages in flight')
+    args = parser.parse_args()
+
+    try:
+        if args.command == 'diff':
+            with open(args.old, 'rb') as f:
+                old = f.read()
+            with open(args.new, 'rb') as f:
+                new = f.read()
+            patch = diff(old, new)
+            apply(old, patch)
+            with open(args.output, 'wb') as f:
+                f.write(patch)
+            print('%s: %d byte patch for a %d byte image (%.1f%%)' %
+                  (args.output, len(patch), len(new), 100.0 * len(patch) / max(len(new), 1)))
+        elif args.command == 'apply':
+            with open(args.old, 'rb') as f:
+                old = f.read()
+            with open(args.patch, 'rb') as f:
+                new = apply(old, f.read())
+            if args.output:
+                with open(args.output, 'wb') as f:
+                    f.write(new)
+            print('%s: %d byte image, hash verified' % (args.output or args.patch, len(new)))
+        else:
+            with open(args.patch, 'rb') as f:
+                send(f.read(), args.host, args.port, args.chunk, args.window)
+            print('%s: applied, the device is rebooting' % args.patch)
+    except (OSError, ValueError, struct.error) as e:
+        sys.exit('mkdelta: %s' % e)
+
+
+if __name__ == '__main__':
+    main()
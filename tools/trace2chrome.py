@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+#
+# SPDX-License-Identifier: GPLv2
+#
+# Copyright (C) 2025  Vinicius Silva <silva.viniciusr@gmail.com>
+#
+# Convert a trace ring dump captured from the device console into
+# Chrome/Perfetto trace JSON (load it in ui.perfetto.dev or chrome://tracing).
+#
+# Usage: trace2chrome.py monitor.log > trace.json
+#
+
+"""Convert a trace ring dump into Chrome/Perfetto trace JSON."""
+
+import argparse
+import json
+import struct
+import sys
+
+RECORD = struct.Struct('<IIIHBB')
+TYPE_BEGIN, TYPE_END, TYPE_INSTANT, TYPE_COUNTER = 1, 2, 3, 4
+FLAG_ISR = 1
+ISR_TID = 0
+
+
+def parse_dumps(lines):
+    """Yield (header, names, tasks, records) for every dump found in lines."""
+    dump = None
+    for line in lines:
+        line = line.strip()
+        start = line.find('=== TRACE ')
+        if start >= 0:
+            line = line[start:]
+        if line.startswith('=== TRACE BEGIN'):
+            header = dict(f.split('=', 1) for f in line.split()[4:])
+            dump = (header, {}, {}, [])
+        elif dump is None:
+            continue
+        elif line.startswith('=== TRACE END'):
+            yield dump
+            dump = None
+        elif line.startswith('N '):
+            _, idx, name = line.split(maxsplit=2)
+            dump[1][int(idx)] = name
+        elif line.startswith('T '):
+            _, handle, name = line.split(maxsplit=2)
+            dump[2][int(handle, 16)] = name
+        elif line.startswith('R '):
+            dump[3].append(RECORD.unpack(bytes.fromhex(line[2:])))
+
+
+def to_events(header, names, tasks, records):
+    cpu_hz = int(header['cpu_hz'])
+    events = []
+    tids = {ISR_TID: ISR_TID}
+    base = None
+    last = None
+    epoch = 0
+
+    for cycles, arg, task, rid, rtype, flags in records:
+        # The cycle counter is 32 bits wide; records are in ring order, so a
+        # decrease means it wrapped.
+        if last is not None and cycles < last:
+            epoch += 1 << 32
+        last = cycles
+        stamp = epoch + cycles
+        if base is None:
+            base = stamp
+        ts = (stamp - base) * 1e6 / cpu_hz
+
+        tid = ISR_TID if flags & FLAG_ISR else tids.setdefault(task, len(tids))
+        event = {'name': names.get(rid, 'id_%d' % rid), 'ts': ts, 'pid': 1, 'tid': tid}
+        if rtype == TYPE_BEGIN:
+            event.update(ph='B', args={'arg': arg})
+        elif rtype == TYPE_END:
+            event.update(ph='E', args={'arg': arg})
+        elif rtype == TYPE_INSTANT:
+            event.update(ph='i', s='t', args={'arg': arg})
+        elif rtype == TYPE_COUNTER:
+            event.update(ph='C', args={'value': arg})
+        else:
+            continue
+        events.append(event)
+
+    for task, tid in tids.items():
+        name = 'ISR' if tid == ISR_TID else tasks.get(task, '%08x' % task)
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': tid,
+                       'args': {'name': name}})
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r', errors='replace'),
+                        default=sys.stdin, help='captured console output')
+    parser.add_argument('-n', '--dump', type=int, default=-1,
+                        help='which dump to convert when the log has several (default: last)')
+    args = parser.parse_args()
+
+    dumps = list(parse_dumps(args.log))
+    if not dumps:
+        sys.exit('no trace dump found')
+    events = to_events(*dumps[args.dump])
+    json.dump({'traceEvents': events, 'displayTimeUnit': 'ns'}, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()